@@ -0,0 +1,79 @@
+/*
+ This file belongs to the OCFWebServer project. OCFWebServer is a fork of GCDWebServer (originally developed by
+ Pierre-Olivier Latour). We have forked GCDWebServer because we made extensive and incompatible changes to it.
+ To find out more have a look at README.md.
+ 
+ Copyright (c) 2013, Christian Kienle / chris@objective-cloud.com
+ All rights reserved.
+ 
+ Original Copyright Statement:
+ Copyright (c) 2012-2013, Pierre-Olivier Latour
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ * Neither the name of the <organization> nor the
+ names of its contributors may be used to endorse or promote products
+ derived from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Server the benchmark suite runs against (see run-benchmarks.sh):
+//   GET  /tiny                           11 byte data response
+//   GET  /files/...                      files of the directory passed as second argument
+//   POST /upload                         multipart form parsed by OCFWebServerMultiPartFormRequest
+//   GET  /routes/0 ... /routes/999       one path handler each
+//   GET  /metrics                        built-in Prometheus metrics
+//
+//   ocfwebserver-benchmark-server [port] [directory]
+
+#import <Foundation/Foundation.h>
+#import "OCFWebServer.h"
+#import "OCFWebServerRequest.h"
+#import "OCFWebServerResponse.h"
+
+#define kRouteCount 1000
+
+int main(int argc, const char* argv[]) {
+  @autoreleasepool {
+    NSUInteger port = (argc > 1 ? (NSUInteger)atoi(argv[1]) : 8080);
+    NSString* directory = (argc > 2 ? @(argv[2]) : [[NSFileManager defaultManager] currentDirectoryPath]);
+    OCFWebServer* server = [[OCFWebServer alloc] init];
+    
+    NSData* tinyData = [@"Hello World" dataUsingEncoding:NSUTF8StringEncoding];
+    [server addHandlerForMethod:@"GET" path:@"/tiny" requestClass:[OCFWebServerRequest class] processBlock:^(OCFWebServerRequest* request) {
+      [request respondWith:[OCFWebServerDataResponse responseWithData:tinyData contentType:@"text/plain"]];
+    }];
+    [server addHandlerForBasePath:@"/files/" localPath:directory indexFilename:nil cacheAge:0];
+    [server addHandlerForMethod:@"POST" path:@"/upload" requestClass:[OCFWebServerMultiPartFormRequest class] processBlock:^(OCFWebServerRequest* request) {
+      OCFWebServerMultiPartFormRequest* form = (OCFWebServerMultiPartFormRequest*)request;
+      NSString* summary = [NSString stringWithFormat:@"%lu argument(s), %lu file(s)", (unsigned long)form.arguments.count, (unsigned long)form.files.count];
+      [request respondWith:[OCFWebServerDataResponse responseWithText:summary]];
+    }];
+    for (NSUInteger i = 0; i < kRouteCount; ++i) {
+      NSData* data = [[NSString stringWithFormat:@"Route %lu", (unsigned long)i] dataUsingEncoding:NSUTF8StringEncoding];
+      [server addHandlerForMethod:@"GET" path:[NSString stringWithFormat:@"/routes/%lu", (unsigned long)i] requestClass:[OCFWebServerRequest class] processBlock:^(OCFWebServerRequest* request) {
+        [request respondWith:[OCFWebServerDataResponse responseWithData:data contentType:@"text/plain"]];
+      }];
+    }
+    [server addMetricsHandlerForPath:@"/metrics"];
+    
+    fprintf(stderr, "Benchmark server %i serving %s on port %lu\n", (int)getpid(), [directory fileSystemRepresentation], (unsigned long)port);
+    return ([server runWithPort:port] ? EXIT_SUCCESS : EXIT_FAILURE);
+  }
+}
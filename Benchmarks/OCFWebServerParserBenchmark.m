@@ -0,0 +1,119 @@
+/*
+ This file belongs to the OCFWebServer project. OCFWebServer is a fork of GCDWebServer (originally developed by
+ Pierre-Olivier Latour). We have forked GCDWebServer because we made extensive and incompatible changes to it.
+ To find out more have a look at README.md.
+ 
+ Copyright (c) 2013, Christian Kienle / chris@objective-cloud.com
+ All rights reserved.
+ 
+ Original Copyright Statement:
+ Copyright (c) 2012-2013, Pierre-Olivier Latour
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ * Neither the name of the <organization> nor the
+ names of its contributors may be used to endorse or promote products
+ derived from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Compares parsing request headers with CFHTTPMessage against OCFWebServerHeaderParser.
+//
+// Build and run from the repository root:
+//   clang -O2 -fobjc-arc -framework Foundation -framework CoreServices -IClasses \
+//     Benchmarks/OCFWebServerParserBenchmark.m Classes/OCFWebServerHeaderParser.m -o /tmp/parser-benchmark
+//   /tmp/parser-benchmark [iterations]
+
+#import <Foundation/Foundation.h>
+#if TARGET_OS_IPHONE
+#import <CFNetwork/CFNetwork.h>
+#else
+#import <CoreServices/CoreServices.h>
+#endif
+#import "OCFWebServerHeaderParser.h"
+
+static const char* kRequest =
+  "GET /assets/images/logo%20large.png?size=2x&theme=dark HTTP/1.1\r\n"
+  "Host: localhost:8080\r\n"
+  "User-Agent: Mozilla/5.0 (Macintosh; Intel Mac OS X 10_9) AppleWebKit/537.36 (KHTML, like Gecko)\r\n"
+  "Accept: image/webp,*/*;q=0.8\r\n"
+  "Accept-Encoding: gzip,deflate,sdch\r\n"
+  "Accept-Language: en-US,en;q=0.8\r\n"
+  "Cache-Control: max-age=0\r\n"
+  "Connection: keep-alive\r\n"
+  "Referer: http://localhost:8080/index.html\r\n"
+  "\r\n";
+
+static NSUInteger _ParseWithCFHTTPMessage(const UInt8* bytes, CFIndex length) {
+  CFHTTPMessageRef message = CFHTTPMessageCreateEmpty(kCFAllocatorDefault, true);
+  CFHTTPMessageAppendBytes(message, bytes, length);
+  NSUInteger count = 0;
+  if (CFHTTPMessageIsHeaderComplete(message)) {
+    NSString* method = CFBridgingRelease(CFHTTPMessageCopyRequestMethod(message));
+    NSDictionary* headers = CFBridgingRelease(CFHTTPMessageCopyAllHeaderFields(message));
+    NSURL* url = CFBridgingRelease(CFHTTPMessageCopyRequestURL(message));
+    NSString* path = CFBridgingRelease(CFURLCopyPath((CFURLRef)url));
+    path = [path stringByReplacingPercentEscapesUsingEncoding:NSUTF8StringEncoding];
+    NSString* query = CFBridgingRelease(CFURLCopyQueryString((CFURLRef)url, NULL));
+    count = method.length + headers.count + path.length + query.length;
+  }
+  CFRelease(message);
+  return count;
+}
+
+static NSUInteger _ParseWithHeaderParser(OCFWebServerHeaderParser* parser, const UInt8* bytes, NSUInteger length) {
+  NSUInteger consumedLength = 0;
+  NSUInteger count = 0;
+  if ([parser parseBytes:bytes length:length consumedLength:&consumedLength] == OCFWebServerHeaderParserResultComplete) {
+    count = parser.method.length + parser.headers.count + parser.path.length + parser.query.length;
+  }
+  [parser reset];
+  return count;
+}
+
+int main(int argc, const char* argv[]) {
+  @autoreleasepool {
+    NSUInteger iterations = (argc > 1 ? (NSUInteger)strtoul(argv[1], NULL, 10) : 200000);
+    const UInt8* bytes = (const UInt8*)kRequest;
+    NSUInteger length = strlen(kRequest);
+    NSUInteger checksum = 0;
+    
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    for (NSUInteger i = 0; i < iterations; ++i) {
+      @autoreleasepool {
+        checksum += _ParseWithCFHTTPMessage(bytes, length);
+      }
+    }
+    CFAbsoluteTime cfTime = CFAbsoluteTimeGetCurrent() - start;
+    
+    OCFWebServerHeaderParser* parser = [[OCFWebServerHeaderParser alloc] initWithMaximumHeaderSize:16 * 1024];
+    start = CFAbsoluteTimeGetCurrent();
+    for (NSUInteger i = 0; i < iterations; ++i) {
+      @autoreleasepool {
+        checksum += _ParseWithHeaderParser(parser, bytes, length);
+      }
+    }
+    CFAbsoluteTime parserTime = CFAbsoluteTimeGetCurrent() - start;
+    
+    printf("CFHTTPMessage:            %8.0f requests/s (%.3f us/request)\n", iterations / cfTime, cfTime * 1e6 / iterations);
+    printf("OCFWebServerHeaderParser: %8.0f requests/s (%.3f us/request)\n", iterations / parserTime, parserTime * 1e6 / iterations);
+    printf("Speedup: %.2fx (checksum %lu)\n", cfTime / parserTime, (unsigned long)checksum);
+  }
+  return 0;
+}
@@ -0,0 +1,577 @@
+/*
+ This file belongs to the OCFWebServer project. OCFWebServer is a fork of GCDWebServer (originally developed by
+ Pierre-Olivier Latour). We have forked GCDWebServer because we made extensive and incompatible changes to it.
+ To find out more have a look at README.md.
+
+ Copyright (c) 2013, Christian Kienle / chris@objective-cloud.com
+ All rights reserved.
+
+ Original Copyright Statement:
+ Copyright (c) 2012-2013, Pierre-Olivier Latour
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ * Neither the name of the <organization> nor the
+ names of its contributors may be used to endorse or promote products
+ derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Closed-loop HTTP/1.1 load generator for the benchmark suite. Every connection runs on its own thread and sends its
+// next request as soon as the previous response is complete (keep-alive). Optional slow clients trickle request headers
+// one byte at a time next to the measured connections. Prints one JSON object per run so results can be diffed release
+// to release. Plain C on purpose so it measures the server and not itself.
+//
+//   ocfwebserver-load --port 8080 --path /tiny --connections 64 --duration 10 [--pid SERVER_PID]
+//   ocfwebserver-load --path /routes/{i} --routes 1000 ...   ({i} cycles through 0 ... routes - 1)
+//   ocfwebserver-load --path /upload --multipart 1048576 ...   (POSTs a multipart form with a file of that size)
+//   ocfwebserver-load --slow-clients 500 ...
+
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <errno.h>
+#include <getopt.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define kSubBucketBits 4
+#define kSubBucketCount (1 << kSubBucketBits)
+#define kMaxExponent 40
+#define kBucketCount ((kMaxExponent - kSubBucketBits + 2) * kSubBucketCount)
+#define kReadBufferSize (64 * 1024)
+#define kMultipartBoundary "ocfwebserver-benchmark-boundary"
+
+typedef struct {
+  const char* scenario;
+  const char* host;
+  int port;
+  const char* path;
+  unsigned int routes;
+  size_t multipartSize;
+  unsigned int connections;
+  unsigned int slowClients;
+  double warmup;
+  double duration;
+  int pid;
+} Options;
+
+// Same log-linear buckets as OCFWebServerHistogram (microseconds)
+typedef struct {
+  uint64_t buckets[kBucketCount];
+  uint64_t count;
+  uint64_t sum;
+  uint64_t max;
+} Histogram;
+
+typedef struct {
+  pthread_t thread;
+  unsigned int index;
+  Histogram histogram;
+  uint64_t requests;
+  uint64_t errors;
+  uint64_t bytesReceived;
+  uint64_t statusErrors;  // Responses other than 2xx / 3xx
+} Worker;
+
+static Options _options;
+static struct sockaddr_in _address;
+static volatile int _measuring = 0;
+static volatile int _stopping = 0;
+static char* _uploadBody = NULL;
+static size_t _uploadBodyLength = 0;
+static uint64_t _slowClientDisconnects = 0;
+
+static uint64_t _Now(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000 + (uint64_t)now.tv_nsec / 1000;
+}
+
+static size_t _BucketIndex(uint64_t value) {
+  if (value < kSubBucketCount) {
+    return (size_t)value;
+  }
+  unsigned int exponent = 63 - __builtin_clzll(value);
+  if (exponent > kMaxExponent) {
+    return kBucketCount - 1;
+  }
+  return (exponent - kSubBucketBits + 1) * kSubBucketCount + ((value >> (exponent - kSubBucketBits)) & (kSubBucketCount - 1));
+}
+
+static uint64_t _BucketUpperBound(size_t index) {
+  if (index < kSubBucketCount) {
+    return index;
+  }
+  unsigned int exponent = (unsigned int)(index / kSubBucketCount) + kSubBucketBits - 1;
+  uint64_t lowerBound = (uint64_t)(kSubBucketCount + (index % kSubBucketCount)) << (exponent - kSubBucketBits);
+  return lowerBound + ((uint64_t)1 << (exponent - kSubBucketBits)) - 1;
+}
+
+static void _RecordValue(Histogram* histogram, uint64_t value) {
+  histogram->buckets[_BucketIndex(value)] += 1;
+  histogram->count += 1;
+  histogram->sum += value;
+  if (value > histogram->max) {
+    histogram->max = value;
+  }
+}
+
+static uint64_t _ValueAtPercentile(const Histogram* histogram, double percentile) {
+  if (histogram->count == 0) {
+    return 0;
+  }
+  uint64_t rank = (uint64_t)(percentile / 100.0 * histogram->count + 0.5);
+  if (rank == 0) {
+    rank = 1;
+  }
+  uint64_t cumulative = 0;
+  for (size_t i = 0; i < kBucketCount; ++i) {
+    cumulative += histogram->buckets[i];
+    if (cumulative >= rank) {
+      uint64_t bound = _BucketUpperBound(i);
+      return (bound < histogram->max ? bound : histogram->max);
+    }
+  }
+  return histogram->max;
+}
+
+static int _Connect(void) {
+  int fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (fd < 0) {
+    return -1;
+  }
+  int yes = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+  if (connect(fd, (struct sockaddr*)&_address, sizeof(_address)) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+static int _WriteAll(int fd, const char* bytes, size_t length) {
+  while (length > 0) {
+    ssize_t result = write(fd, bytes, length);
+    if (result < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+    bytes += result;
+    length -= (size_t)result;
+  }
+  return 0;
+}
+
+static size_t _FormatRequest(char* buffer, size_t size, uint64_t sequence) {
+  char path[1024];
+  const char* placeholder = strstr(_options.path, "{i}");
+  if (placeholder && _options.routes) {
+    snprintf(path, sizeof(path), "%.*s%u%s", (int)(placeholder - _options.path), _options.path, (unsigned int)(sequence % _options.routes), placeholder + 3);
+  } else {
+    snprintf(path, sizeof(path), "%s", _options.path);
+  }
+  if (_uploadBody) {
+    return (size_t)snprintf(buffer, size, "POST %s HTTP/1.1\r\nHost: %s:%i\r\nContent-Type: multipart/form-data; boundary=" kMultipartBoundary "\r\nContent-Length: %zu\r\n\r\n",
+                            path, _options.host, _options.port, _uploadBodyLength);
+  }
+  return (size_t)snprintf(buffer, size, "GET %s HTTP/1.1\r\nHost: %s:%i\r\n\r\n", path, _options.host, _options.port);
+}
+
+// Reads one response and returns its status code (or -1 on error). Handles Content-Length and chunked bodies and sets
+// *keepAlive to 0 if the server closes the connection afterwards.
+static int _ReadResponse(int fd, char* buffer, size_t* buffered, uint64_t* bytesReceived, int* keepAlive) {
+  size_t length = *buffered;
+  char* headerEnd = NULL;
+  while ((headerEnd = memmem(buffer, length, "\r\n\r\n", 4)) == NULL) {
+    if (length == kReadBufferSize) {
+      return -1;
+    }
+    ssize_t result = read(fd, buffer + length, kReadBufferSize - length);
+    if (result <= 0) {
+      return -1;
+    }
+    length += (size_t)result;
+    *bytesReceived += (uint64_t)result;
+  }
+  size_t headerLength = (size_t)(headerEnd - buffer) + 4;
+  buffer[length] = '\0';  // For the string functions below (the buffer has room for it)
+  int status = 0;
+  if (sscanf(buffer, "HTTP/1.%*d %d", &status) != 1) {
+    return -1;
+  }
+  *keepAlive = 1;
+  long long contentLength = -1;
+  int chunked = 0;
+  for (char* line = strstr(buffer, "\r\n") + 2; line < headerEnd; line = strstr(line, "\r\n") + 2) {
+    if (strncasecmp(line, "Content-Length:", 15) == 0) {
+      contentLength = atoll(line + 15);
+    } else if ((strncasecmp(line, "Transfer-Encoding:", 18) == 0) && strstr(line, "chunked") && (strstr(line, "chunked") < strstr(line, "\r\n"))) {
+      chunked = 1;
+    } else if ((strncasecmp(line, "Connection:", 11) == 0) && (strncasecmp(line + 11 + strspn(line + 11, " "), "close", 5) == 0)) {
+      *keepAlive = 0;
+    }
+  }
+  memmove(buffer, buffer + headerLength, length - headerLength);
+  length -= headerLength;
+
+  if (chunked) {
+    while (1) {  // Skips chunks in place: only the current chunk line needs to be buffered
+      char* lineEnd;
+      while ((lineEnd = memmem(buffer, length, "\r\n", 2)) == NULL) {
+        ssize_t result = read(fd, buffer + length, kReadBufferSize - length);
+        if (result <= 0) {
+          return -1;
+        }
+        length += (size_t)result;
+        *bytesReceived += (uint64_t)result;
+      }
+      unsigned long long size = strtoull(buffer, NULL, 16);
+      size_t skip = (size_t)(lineEnd - buffer) + 2;
+      unsigned long long remaining = size + 2;  // Data and its CRLF, or the empty line ending the trailer
+      memmove(buffer, buffer + skip, length - skip);
+      length -= skip;
+      while (remaining > 0) {
+        if (length == 0) {
+          ssize_t result = read(fd, buffer, kReadBufferSize);
+          if (result <= 0) {
+            return -1;
+          }
+          length = (size_t)result;
+          *bytesReceived += (uint64_t)result;
+        }
+        size_t consumed = (remaining < length ? (size_t)remaining : length);
+        memmove(buffer, buffer + consumed, length - consumed);
+        length -= consumed;
+        remaining -= consumed;
+      }
+      if (size == 0) {
+        break;
+      }
+    }
+  } else if (contentLength >= 0) {
+    unsigned long long remaining = (unsigned long long)contentLength;
+    size_t consumed = (remaining < length ? (size_t)remaining : length);
+    memmove(buffer, buffer + consumed, length - consumed);
+    length -= consumed;
+    remaining -= consumed;
+    while (remaining > 0) {
+      ssize_t result = read(fd, buffer, (remaining < kReadBufferSize ? (size_t)remaining : kReadBufferSize));
+      if (result <= 0) {
+        return -1;
+      }
+      *bytesReceived += (uint64_t)result;
+      remaining -= (unsigned long long)result;
+    }
+  } else if ((status >= 200) && (status != 204) && (status != 304)) {  // Body delimited by the end of the connection
+    while (read(fd, buffer, kReadBufferSize) > 0) {
+    }
+    *keepAlive = 0;
+    length = 0;
+  }
+  *buffered = length;
+  return status;
+}
+
+static void* _RunWorker(void* context) {
+  Worker* worker = context;
+  char* buffer = malloc(kReadBufferSize + 1);
+  char request[2048];
+  uint64_t sequence = worker->index;
+  int fd = -1;
+  size_t buffered = 0;
+  while (!_stopping) {
+    if (fd < 0) {
+      fd = _Connect();
+      buffered = 0;
+      if (fd < 0) {
+        if (_measuring) {
+          worker->errors += 1;
+        }
+        usleep(10000);
+        continue;
+      }
+    }
+    size_t requestLength = _FormatRequest(request, sizeof(request), sequence);
+    sequence += _options.connections;
+    uint64_t start = _Now();
+    uint64_t bytesReceived = 0;
+    int keepAlive = 0;
+    int status = -1;
+    if ((_WriteAll(fd, request, requestLength) == 0) && (!_uploadBody || (_WriteAll(fd, _uploadBody, _uploadBodyLength) == 0))) {
+      status = _ReadResponse(fd, buffer, &buffered, &bytesReceived, &keepAlive);
+    }
+    if (_measuring) {
+      if (status < 0) {
+        worker->errors += 1;
+      } else {
+        _RecordValue(&worker->histogram, _Now() - start);
+        worker->requests += 1;
+        worker->bytesReceived += bytesReceived;
+        if (status >= 400) {
+          worker->statusErrors += 1;
+        }
+      }
+    }
+    if ((status < 0) || !keepAlive) {
+      close(fd);
+      fd = -1;
+    }
+  }
+  if (fd >= 0) {
+    close(fd);
+  }
+  free(buffer);
+  return NULL;
+}
+
+// Keeps slowClients connections open by sending one more byte of an endless request header every second
+static void* _RunSlowClients(void* context) {
+  static const char kHeader[] = "GET / HTTP/1.1\r\nHost: localhost\r\nX-Slow: ";
+  (void)context;
+  unsigned int count = _options.slowClients;
+  int* fds = calloc(count, sizeof(int));
+  size_t* offsets = calloc(count, sizeof(size_t));
+  for (unsigned int i = 0; i < count; ++i) {
+    fds[i] = -1;
+  }
+  while (!_stopping) {
+    for (unsigned int i = 0; (i < count) && !_stopping; ++i) {
+      if (fds[i] < 0) {
+        fds[i] = _Connect();
+        offsets[i] = 0;
+        if (fds[i] < 0) {
+          continue;
+        }
+      }
+      char byte = (offsets[i] < sizeof(kHeader) - 1 ? kHeader[offsets[i]] : 'x');
+      if (send(fds[i], &byte, 1, MSG_NOSIGNAL | MSG_DONTWAIT) != 1) {
+        close(fds[i]);
+        fds[i] = -1;
+        __sync_fetch_and_add(&_slowClientDisconnects, 1);
+        continue;
+      }
+      offsets[i] += 1;
+      struct pollfd pfd = {fds[i], POLLIN, 0};
+      if (poll(&pfd, 1, 0) > 0) {  // The server answered (408) or closed the connection
+        close(fds[i]);
+        fds[i] = -1;
+        __sync_fetch_and_add(&_slowClientDisconnects, 1);
+      }
+    }
+    usleep(1000000);
+  }
+  for (unsigned int i = 0; i < count; ++i) {
+    if (fds[i] >= 0) {
+      close(fds[i]);
+    }
+  }
+  free(fds);
+  free(offsets);
+  return NULL;
+}
+
+// Returns the user + system CPU time of the process in seconds (or -1 if unavailable)
+static double _ProcessCPUTime(int pid) {
+  char path[64];
+  snprintf(path, sizeof(path), "/proc/%i/stat", pid);
+  FILE* file = fopen(path, "r");
+  if (file == NULL) {
+    return -1.0;
+  }
+  char line[1024];
+  double seconds = -1.0;
+  if (fgets(line, sizeof(line), file)) {
+    char* fields = strrchr(line, ')');  // The command name may contain spaces
+    unsigned long utime = 0;
+    unsigned long stime = 0;
+    if (fields && (sscanf(fields + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &utime, &stime) == 2)) {
+      seconds = (double)(utime + stime) / (double)sysconf(_SC_CLK_TCK);
+    }
+  }
+  fclose(file);
+  return seconds;
+}
+
+// Returns the value in kB of a field of /proc/PID/status like "VmRSS" (or -1 if unavailable)
+static long _ProcessMemory(int pid, const char* field) {
+  char path[64];
+  snprintf(path, sizeof(path), "/proc/%i/status", pid);
+  FILE* file = fopen(path, "r");
+  if (file == NULL) {
+    return -1;
+  }
+  char line[256];
+  long value = -1;
+  size_t fieldLength = strlen(field);
+  while (fgets(line, sizeof(line), file)) {
+    if ((strncmp(line, field, fieldLength) == 0) && (line[fieldLength] == ':')) {
+      value = atol(line + fieldLength + 1);
+      break;
+    }
+  }
+  fclose(file);
+  return value;
+}
+
+static void _PrepareUploadBody(size_t size) {
+  static const char kPrefix[] = "--" kMultipartBoundary "\r\nContent-Disposition: form-data; name=\"comment\"\r\n\r\nbenchmark\r\n"
+                                "--" kMultipartBoundary "\r\nContent-Disposition: form-data; name=\"file\"; filename=\"upload.bin\"\r\n"
+                                "Content-Type: application/octet-stream\r\n\r\n";
+  static const char kSuffix[] = "\r\n--" kMultipartBoundary "--\r\n";
+  _uploadBodyLength = sizeof(kPrefix) - 1 + size + sizeof(kSuffix) - 1;
+  _uploadBody = malloc(_uploadBodyLength);
+  memcpy(_uploadBody, kPrefix, sizeof(kPrefix) - 1);
+  for (size_t i = 0; i < size; ++i) {
+    _uploadBody[sizeof(kPrefix) - 1 + i] = (char)('a' + (i * 7) % 26);  // Never contains the boundary
+  }
+  memcpy(_uploadBody + sizeof(kPrefix) - 1 + size, kSuffix, sizeof(kSuffix) - 1);
+}
+
+static void _PrintUsage(const char* name) {
+  fprintf(stderr, "Usage: %s [--scenario NAME] [--host 127.0.0.1] [--port 8080] [--path /] [--routes N] [--multipart BYTES]\n"
+                  "          [--connections 64] [--slow-clients 0] [--warmup 2] [--duration 10] [--pid SERVER_PID]\n", name);
+}
+
+int main(int argc, char* argv[]) {
+  static const struct option options[] = {
+    {"scenario", required_argument, NULL, 's'},
+    {"host", required_argument, NULL, 'h'},
+    {"port", required_argument, NULL, 'p'},
+    {"path", required_argument, NULL, 'u'},
+    {"routes", required_argument, NULL, 'r'},
+    {"multipart", required_argument, NULL, 'm'},
+    {"connections", required_argument, NULL, 'c'},
+    {"slow-clients", required_argument, NULL, 'l'},
+    {"warmup", required_argument, NULL, 'w'},
+    {"duration", required_argument, NULL, 'd'},
+    {"pid", required_argument, NULL, 'i'},
+    {NULL, 0, NULL, 0}
+  };
+  _options = (Options){"default", "127.0.0.1", 8080, "/", 0, 0, 64, 0, 2.0, 10.0, 0};
+  int option;
+  while ((option = getopt_long(argc, argv, "", options, NULL)) != -1) {
+    switch (option) {
+      case 's': _options.scenario = optarg; break;
+      case 'h': _options.host = optarg; break;
+      case 'p': _options.port = atoi(optarg); break;
+      case 'u': _options.path = optarg; break;
+      case 'r': _options.routes = (unsigned int)atoi(optarg); break;
+      case 'm': _options.multipartSize = (size_t)atoll(optarg); break;
+      case 'c': _options.connections = (unsigned int)atoi(optarg); break;
+      case 'l': _options.slowClients = (unsigned int)atoi(optarg); break;
+      case 'w': _options.warmup = atof(optarg); break;
+      case 'd': _options.duration = atof(optarg); break;
+      case 'i': _options.pid = atoi(optarg); break;
+      default: _PrintUsage(argv[0]); return 1;
+    }
+  }
+  if ((_options.connections == 0) || (_options.duration <= 0.0)) {
+    _PrintUsage(argv[0]);
+    return 1;
+  }
+  memset(&_address, 0, sizeof(_address));
+  _address.sin_family = AF_INET;
+  _address.sin_port = htons((uint16_t)_options.port);
+  if (inet_pton(AF_INET, _options.host, &_address.sin_addr) != 1) {
+    fprintf(stderr, "Invalid IPv4 address: %s\n", _options.host);
+    return 1;
+  }
+  if (_options.multipartSize) {
+    _PrepareUploadBody(_options.multipartSize);
+  }
+
+  pthread_t slowClientsThread;
+  if (_options.slowClients) {
+    pthread_create(&slowClientsThread, NULL, _RunSlowClients, NULL);
+  }
+  Worker* workers = calloc(_options.connections, sizeof(Worker));
+  for (unsigned int i = 0; i < _options.connections; ++i) {
+    workers[i].index = i;
+    if (pthread_create(&workers[i].thread, NULL, _RunWorker, &workers[i]) != 0) {
+      fprintf(stderr, "Failed creating thread %u: %s\n", i, strerror(errno));
+      return 1;
+    }
+  }
+  usleep((useconds_t)(_options.warmup * 1000000.0));
+
+  double cpuStart = (_options.pid ? _ProcessCPUTime(_options.pid) : -1.0);
+  uint64_t start = _Now();
+  _measuring = 1;
+  usleep((useconds_t)(_options.duration * 1000000.0));
+  _measuring = 0;
+  double elapsed = (double)(_Now() - start) / 1000000.0;
+  double cpuEnd = (_options.pid ? _ProcessCPUTime(_options.pid) : -1.0);
+  long rss = (_options.pid ? _ProcessMemory(_options.pid, "VmRSS") : -1);
+  long peakRSS = (_options.pid ? _ProcessMemory(_options.pid, "VmHWM") : -1);
+  _stopping = 1;
+
+  Histogram* histogram = calloc(1, sizeof(Histogram));
+  uint64_t requests = 0;
+  uint64_t errors = 0;
+  uint64_t statusErrors = 0;
+  uint64_t bytesReceived = 0;
+  for (unsigned int i = 0; i < _options.connections; ++i) {
+    pthread_join(workers[i].thread, NULL);  // Workers blocked on a dead server end with the connection
+    for (size_t j = 0; j < kBucketCount; ++j) {
+      histogram->buckets[j] += workers[i].histogram.buckets[j];
+    }
+    histogram->count += workers[i].histogram.count;
+    histogram->sum += workers[i].histogram.sum;
+    if (workers[i].histogram.max > histogram->max) {
+      histogram->max = workers[i].histogram.max;
+    }
+    requests += workers[i].requests;
+    errors += workers[i].errors;
+    statusErrors += workers[i].statusErrors;
+    bytesReceived += workers[i].bytesReceived;
+  }
+  if (_options.slowClients) {
+    pthread_join(slowClientsThread, NULL);
+  }
+
+  printf("{\"scenario\":\"%s\",\"path\":\"%s\",\"connections\":%u,\"slow_clients\":%u,\"duration_s\":%.3f,"
+         "\"requests\":%llu,\"errors\":%llu,\"status_errors\":%llu,\"requests_per_s\":%.1f,\"bytes_received\":%llu,\"received_mb_per_s\":%.2f,"
+         "\"latency_us\":{\"mean\":%.1f,\"p50\":%llu,\"p90\":%llu,\"p99\":%llu,\"p999\":%llu,\"max\":%llu},"
+         "\"slow_client_disconnects\":%llu,\"server_cpu_s\":%.2f,\"server_cpu_percent\":%.1f,\"server_rss_kb\":%ld,\"server_peak_rss_kb\":%ld}\n",
+         _options.scenario, _options.path, _options.connections, _options.slowClients, elapsed,
+         (unsigned long long)requests, (unsigned long long)errors, (unsigned long long)statusErrors, (double)requests / elapsed,
+         (unsigned long long)bytesReceived, (double)bytesReceived / elapsed / (1024.0 * 1024.0),
+         (histogram->count ? (double)histogram->sum / (double)histogram->count : 0.0),
+         (unsigned long long)_ValueAtPercentile(histogram, 50.0), (unsigned long long)_ValueAtPercentile(histogram, 90.0),
+         (unsigned long long)_ValueAtPercentile(histogram, 99.0), (unsigned long long)_ValueAtPercentile(histogram, 99.9),
+         (unsigned long long)histogram->max, (unsigned long long)_slowClientDisconnects,
+         ((cpuStart >= 0.0) && (cpuEnd >= 0.0) ? cpuEnd - cpuStart : -1.0),
+         ((cpuStart >= 0.0) && (cpuEnd >= 0.0) ? (cpuEnd - cpuStart) / elapsed * 100.0 : -1.0), rss, peakRSS);
+  free(histogram);
+  free(workers);
+  free(_uploadBody);
+  return 0;
+}
@@ -0,0 +1,48 @@
+#!/usr/bin/env bash
+# Builds the benchmark tools, runs every scenario against a fresh server and
+# appends one JSON line per scenario to the results file (first argument, or
+# results/<git describe>-<date>.jsonl). Tune with PORT, DURATION, WARMUP and
+# CONNECTIONS; pin with e.g. "taskset -c 0-3 ./run-benchmarks.sh".
+
+set -euo pipefail
+cd "$(dirname "$0")"
+
+PORT=${PORT:-8089}
+DURATION=${DURATION:-15}
+WARMUP=${WARMUP:-3}
+CONNECTIONS=${CONNECTIONS:-64}
+mkdir -p results
+RESULTS=${1:-results/$(git describe --always --dirty 2>/dev/null || echo unknown)-$(date +%Y%m%d-%H%M%S).jsonl}
+
+make -s
+
+DOCROOT=$(mktemp -d)
+head -c 4096 /dev/urandom > "$DOCROOT/small.bin"
+head -c 16777216 /dev/urandom > "$DOCROOT/large.bin"
+
+logLevel=3 ./obj/ocfwebserver-benchmark-server "$PORT" "$DOCROOT" &
+SERVER=$!
+trap 'kill $SERVER 2>/dev/null || true; wait $SERVER 2>/dev/null || true; rm -rf "$DOCROOT"' EXIT
+
+for _ in $(seq 50); do
+  if (exec 3<>"/dev/tcp/127.0.0.1/$PORT") 2>/dev/null; then
+    break
+  fi
+  sleep 0.1
+done
+
+run() {
+  local scenario=$1
+  shift
+  ./ocfwebserver-load --scenario "$scenario" --host 127.0.0.1 --port "$PORT" --pid "$SERVER" \
+    --warmup "$WARMUP" --duration "$DURATION" --connections "$CONNECTIONS" "$@" | tee -a "$RESULTS"
+}
+
+run tiny --path /tiny
+run small-file --path /files/small.bin
+run large-file --path /files/large.bin --connections 8
+run multipart-upload --path /upload --multipart 1048576 --connections 16
+run many-routes --path '/routes/{i}' --routes 1000
+run slow-clients --path /tiny --slow-clients 500
+
+echo "Results written to $(pwd)/$RESULTS"
@@ -36,6 +36,10 @@
 #import "OCFWebServerRequest_Types.h"
 
 @class OCFWebServerRequest;
+@class OCFWebServerFileCache;
+@class OCFWebServerWorkerPool;
+@class OCFWebServerMetrics;
+@class OCFWebServerAccessLog;
 
 typedef OCFWebServerRequest*(^OCFWebServerMatchBlock)(NSString* requestMethod, NSURL* requestURL, NSDictionary* requestHeaders, NSString* urlPath, NSDictionary* urlQuery);
 typedef void(^OCFWebServerProcessBlock)(OCFWebServerRequest* request);
@@ -44,16 +48,36 @@ typedef void(^OCFWebServerProcessBlock)(OCFWebServerRequest* request);
 
 #pragma mark - Properties
 @property (nonatomic, assign, readonly, getter=isRunning) BOOL running;
-@property (nonatomic, assign, readonly) NSUInteger port;
+@property (nonatomic, assign, readonly) NSUInteger port;  // Port of the first listen address
+@property (nonatomic, assign) NSUInteger listenerShardCount;  // default: 1 (SO_REUSEPORT listening sockets per address the kernel spreads connections across)
 @property (nonatomic, assign, readonly) NSUInteger maxPendingConnections; // default: 16
+@property (nonatomic, assign) NSUInteger maxRequestsPerConnection;  // default: 100 (0 means unlimited)
+@property (nonatomic, assign) NSTimeInterval keepAliveTimeout;  // default: 15 seconds (0 disables persistent connections)
+@property (nonatomic, assign) NSUInteger maxRequestHeaderSize;  // default: 16 KB (request line and headers)
+@property (nonatomic, assign) NSUInteger maxConnections;  // default: 1024 (0 means unlimited)
+@property (nonatomic, assign) BOOL rejectsConnectionsOverLimit;  // default: NO (stop accepting until a connection closes), YES answers 503 and closes right away
+@property (nonatomic, assign) NSTimeInterval headerReadTimeout;  // default: 30 seconds to receive the complete request line and headers
+@property (nonatomic, assign) NSTimeInterval bodyReadTimeout;  // default: 60 seconds without receiving any request body bytes
+@property (nonatomic, assign) NSTimeInterval writeTimeout;  // default: 60 seconds without the client accepting any response bytes
+@property (nonatomic, assign) NSUInteger minimumBodyReadRate;  // default: 256 bytes per second averaged over the request body once it has been read for 10 seconds (0 disables)
+@property (nonatomic, assign) NSInteger compressionLevel;  // default: 6 (zlib level used for gzip / deflate responses, 0 disables compression)
+@property (nonatomic, assign) NSUInteger minimumCompressionSize;  // default: 1 KB (smaller bodies are sent uncompressed)
+@property (nonatomic, assign) BOOL keepsMultiPartData;  // default: YES (NO stops OCFWebServerMultiPartFormRequest keeping the raw body in memory besides its parsed arguments and files)
+@property (nonatomic, assign) long ioPriority;  // default: DISPATCH_QUEUE_PRIORITY_HIGH (socket I/O and request parsing, on one serial queue per connection)
+@property (nonatomic, strong) OCFWebServerWorkerPool *defaultWorkerPool;  // Runs the handlers added without a worker pool (default: 64 concurrent handlers at default priority)
+@property (nonatomic, strong) OCFWebServerFileCache *fileCache;  // Used by the base path handlers serving local files (default: 1024 entries, 16 MB of contents)
+@property (nonatomic, strong) OCFWebServerMetrics *metrics;  // Can only be changed while stopped (nil disables metrics)
+@property (nonatomic, strong) OCFWebServerAccessLog *accessLog;  // default: nil (every request is recorded once its response has been sent or the connection aborted)
 
 #pragma mark - OCFWebServer
 - (void)addHandlerWithMatchBlock:(OCFWebServerMatchBlock)matchBlock processBlock:(OCFWebServerProcessBlock)processBlock;
+- (void)addHandlerWithMatchBlock:(OCFWebServerMatchBlock)matchBlock processBlock:(OCFWebServerProcessBlock)processBlock workerPool:(OCFWebServerWorkerPool*)workerPool;  // Pass nil for the default worker pool
 - (void)removeAllHandlers;
 
 - (BOOL)start;  // Default is 8080 port and computer name
 - (BOOL)startWithPort:(NSUInteger)port bonjourName:(NSString*)name;  // Pass nil name to disable Bonjour or empty string to use computer name
-- (BOOL)startWithPort:(NSUInteger)port bonjourName:(NSString*)name maxPendingConnections:(NSUInteger)maxPendingConnections;
+- (BOOL)startWithPort:(NSUInteger)port bonjourName:(NSString*)name maxPendingConnections:(NSUInteger)maxPendingConnections;  // Listens on all IPv4 and IPv6 interfaces
+- (BOOL)startWithListenAddresses:(NSArray*)addresses bonjourName:(NSString*)name maxPendingConnections:(NSUInteger)maxPendingConnections;  // e.g. @[@"127.0.0.1:8080", @"[::1]:8080", @":9000"] (a missing host means all IPv4 and IPv6 interfaces)
 - (void)stop;
 
 @end
@@ -64,6 +88,7 @@ typedef void(^OCFWebServerProcessBlock)(OCFWebServerRequest* request);
 @end
 
 @interface OCFWebServer (Extensions)
++ (void)setLogLevel:(NSInteger)level;  // 0 (debug) to 5 (exceptions only), overrides the "logLevel" environment variable
 - (BOOL)runWithPort:(NSUInteger)port;  // Starts then automatically stops on SIGINT i.e. Ctrl-C (use on main thread only)
 @end
 
@@ -71,5 +96,8 @@ typedef void(^OCFWebServerProcessBlock)(OCFWebServerRequest* request);
 - (void)addDefaultHandlerForMethod:(NSString*)method requestClass:(Class)class processBlock:(OCFWebServerProcessBlock)block;
 - (void)addHandlerForBasePath:(NSString*)basePath localPath:(NSString*)localPath indexFilename:(NSString*)indexFilename cacheAge:(NSUInteger)cacheAge;  // Base path is recursive and case-sensitive
 - (void)addHandlerForMethod:(NSString*)method path:(NSString*)path requestClass:(Class)class processBlock:(OCFWebServerProcessBlock)block;  // Path is case-insensitive
+- (void)addHandlerForMethod:(NSString*)method path:(NSString*)path requestClass:(Class)class workerPool:(OCFWebServerWorkerPool*)workerPool processBlock:(OCFWebServerProcessBlock)block;
 - (void)addHandlerForMethod:(NSString*)method pathRegex:(NSString*)regex requestClass:(Class)class processBlock:(OCFWebServerProcessBlock)block;  // Regular expression is case-insensitive
+- (void)addHandlerForMethod:(NSString*)method pathRegex:(NSString*)regex requestClass:(Class)class workerPool:(OCFWebServerWorkerPool*)workerPool processBlock:(OCFWebServerProcessBlock)block;
+- (void)addMetricsHandlerForPath:(NSString*)path;  // Serves the metrics in the Prometheus text format
 @end
@@ -33,28 +33,44 @@
  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#if defined(__APPLE__)
 #import <TargetConditionals.h>
 #if TARGET_OS_IPHONE
 #import <MobileCoreServices/MobileCoreServices.h>
 #endif
+#endif
 
+#import <fcntl.h>
+#import <netdb.h>
 #import <netinet/in.h>
 
 #import "OCFWebServerPrivate.h"
 #import "OCFWebServerRequest.h"
 #import "OCFWebServerResponse.h"
 
+// Answer to connections over the limit when rejectsConnectionsOverLimit is set
+static const char _serviceUnavailableResponse[] = "HTTP/1.1 503 Service Unavailable\r\nConnection: close\r\nContent-Length: 0\r\nRetry-After: 1\r\n\r\n";
+
 static BOOL _run;
 
 NSString* OCFWebServerGetMimeTypeForExtension(NSString* extension) {
   static NSDictionary* _overrides = nil;
   if (_overrides == nil) {
+#if defined(__APPLE__)
     _overrides = @{@"css": @"text/css"};
+#else
+    // There is no system registry of types to ask outside of Apple platforms
+    _overrides = @{@"css": @"text/css", @"html": @"text/html", @"htm": @"text/html", @"txt": @"text/plain", @"js": @"application/javascript",
+                   @"json": @"application/json", @"xml": @"application/xml", @"svg": @"image/svg+xml", @"png": @"image/png",
+                   @"jpg": @"image/jpeg", @"jpeg": @"image/jpeg", @"gif": @"image/gif", @"ico": @"image/x-icon", @"pdf": @"application/pdf",
+                   @"zip": @"application/zip", @"gz": @"application/gzip", @"mp4": @"video/mp4", @"woff": @"font/woff", @"woff2": @"font/woff2"};
+#endif
   }
   NSString* mimeType = nil;
   extension = [extension lowercaseString];
   if (extension.length) {
     mimeType = _overrides[extension];
+#if defined(__APPLE__)
     if (mimeType == nil) {
       CFStringRef cfExtension = CFBridgingRetain(extension);
       CFStringRef uti = UTTypeCreatePreferredIdentifierForTag(kUTTagClassFilenameExtension, cfExtension, NULL);
@@ -64,43 +80,42 @@ NSString* OCFWebServerGetMimeTypeForExtension(NSString* extension) {
         CFRelease(uti);
       }
     }
+#endif
   }
   return mimeType;
 }
 
-NSString* OCFWebServerUnescapeURLString(NSString* string) {
-  return (id)CFBridgingRelease(CFURLCreateStringByReplacingPercentEscapesUsingEncoding(kCFAllocatorDefault, (CFStringRef)string, CFSTR(""),
-                                                                      kCFStringEncodingUTF8));
+#ifndef __GCDWEBSERVER_LOGGING_HEADER__
+
+long OCFWebServerLogLevel = 0;
+
+__attribute__((constructor)) static void _InitializeLogLevel(void) {
+  const char* logLevel = getenv("logLevel");
+  OCFWebServerLogLevel = (logLevel ? atol(logLevel) : 0);
 }
 
-NSDictionary* OCFWebServerParseURLEncodedForm(NSString* form) {
-  NSMutableDictionary* parameters = [NSMutableDictionary dictionary];
-  NSScanner* scanner = [[NSScanner alloc] initWithString:form];
-  [scanner setCharactersToBeSkipped:nil];
-  while (1) {
-    NSString* key = nil;
-    if (![scanner scanUpToString:@"=" intoString:&key] || [scanner isAtEnd]) {
-      break;
-    }
-    [scanner setScanLocation:([scanner scanLocation] + 1)];
-    
-    NSString* value = nil;
-    if (![scanner scanUpToString:@"&" intoString:&value]) {
-      break;
-    }
-    
-    key = [key stringByReplacingOccurrencesOfString:@"+" withString:@" "];
-    value = [value stringByReplacingOccurrencesOfString:@"+" withString:@" "];
-    parameters[OCFWebServerUnescapeURLString(key)] = OCFWebServerUnescapeURLString(value);
-    
-    if ([scanner isAtEnd]) {
-      break;
-    }
-    [scanner setScanLocation:([scanner scanLocation] + 1)];
-  }
-  return parameters;
+// Messages are written in order by a serial queue so logging never blocks the I/O threads on stdout
+void OCFWebServerLogMessage(long level, NSString* format, ...) {
+  static const char* levelNames[] = {"DEBUG", "VERBOSE", "INFO", "WARNING", "ERROR", "EXCEPTION"};
+  static dispatch_queue_t queue = NULL;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    queue = dispatch_queue_create("ocfwebserver.log", DISPATCH_QUEUE_SERIAL);
+    dispatch_set_target_queue(queue, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_BACKGROUND, 0));
+  });
+  va_list arguments;
+  va_start(arguments, format);
+  NSString* message = [[NSString alloc] initWithFormat:format arguments:arguments];
+  va_end(arguments);
+  NSData* line = [[NSString stringWithFormat:@"[%s] %@\n", levelNames[MIN(MAX(level, 0), 5)], message] dataUsingEncoding:NSUTF8StringEncoding];
+  dispatch_async(queue, ^{
+    fwrite(line.bytes, 1, line.length, stdout);
+    fflush(stdout);
+  });
 }
 
+#endif
+
 static void _SignalHandler(int signal) {
   _run = NO;
   printf("\n");
@@ -112,17 +127,30 @@ static void _SignalHandler(int signal) {
 #pragma mark - Properties
 @property(nonatomic, copy, readwrite) OCFWebServerMatchBlock matchBlock;
 @property(nonatomic, copy, readwrite) OCFWebServerProcessBlock processBlock;
+@property(nonatomic, strong, readwrite) OCFWebServerWorkerPool* workerPool;
+@property(nonatomic, strong, readwrite) OCFWebServerRouteMetrics* routeMetrics;
+@property(nonatomic, assign, readwrite) OCFWebServerRouteType routeType;
+@property(nonatomic, copy, readwrite) NSString* method;
+@property(nonatomic, copy, readwrite) NSString* pattern;
 
 @end
 
 @implementation OCFWebServerHandler
 
 #pragma mark - Creating
-- (instancetype)initWithMatchBlock:(OCFWebServerMatchBlock)matchBlock processBlock:(OCFWebServerProcessBlock)processBlock {
+- (instancetype)initWithMatchBlock:(OCFWebServerMatchBlock)matchBlock processBlock:(OCFWebServerProcessBlock)processBlock workerPool:(OCFWebServerWorkerPool*)workerPool {
+  return [self initWithRouteType:OCFWebServerRouteTypeCustom method:nil pattern:nil matchBlock:matchBlock processBlock:processBlock workerPool:workerPool];
+}
+
+- (instancetype)initWithRouteType:(OCFWebServerRouteType)routeType method:(NSString*)method pattern:(NSString*)pattern matchBlock:(OCFWebServerMatchBlock)matchBlock processBlock:(OCFWebServerProcessBlock)processBlock workerPool:(OCFWebServerWorkerPool*)workerPool {
   self = [super init];
   if(self) {
+    self.routeType = routeType;
+    self.method = method;
+    self.pattern = pattern;
     self.matchBlock = matchBlock;
     self.processBlock = processBlock;
+    self.workerPool = workerPool;
   }
   return self;
 }
@@ -134,9 +162,15 @@ static void _SignalHandler(int signal) {
 
 #pragma mark - Properties
 @property (nonatomic, readwrite) NSUInteger port;
-@property (nonatomic, strong) dispatch_source_t source;
+@property (nonatomic, copy) NSArray *sources;  // One dispatch source per listening socket (only set while running)
+#if defined(__APPLE__)
 @property (nonatomic, assign) CFNetServiceRef service;
+#endif
 @property (nonatomic, strong) NSMutableArray *connections;
+@property (nonatomic, strong, readwrite) OCFWebServerRouter *router;
+@property (nonatomic, copy, readwrite) NSData *serverHeaderData;
+@property (nonatomic, strong, readwrite) OCFWebServerTimerWheel *timerWheel;
+@property (nonatomic, assign) BOOL acceptingSuspended;  // YES while the listening source is suspended because of maxConnections
 @end
 
 @implementation OCFWebServer {
@@ -149,7 +183,7 @@ static void _SignalHandler(int signal) {
 }
 
 - (NSArray *)handlers {
-  return [_handlers copy];
+  return _handlers;  // Handlers can only be modified while the server is stopped
 }
 
 + (void)initialize {
@@ -162,6 +196,22 @@ static void _SignalHandler(int signal) {
   if(self) {
     self.handlers = @[];
     self.connections = [NSMutableArray new];
+    self.maxRequestsPerConnection = 100;
+    self.keepAliveTimeout = 15.0;
+    self.maxRequestHeaderSize = 16 * 1024;
+    self.maxConnections = 1024;
+    self.listenerShardCount = 1;
+    self.headerReadTimeout = 30.0;
+    self.bodyReadTimeout = 60.0;
+    self.writeTimeout = 60.0;
+    self.minimumBodyReadRate = 256;
+    self.compressionLevel = 6;
+    self.minimumCompressionSize = 1024;
+    self.keepsMultiPartData = YES;
+    self.ioPriority = DISPATCH_QUEUE_PRIORITY_HIGH;
+    self.defaultWorkerPool = [OCFWebServerWorkerPool workerPoolWithName:@"ocfwebserver.handlers" maxConcurrentHandlers:64 maxPendingHandlers:0 priority:DISPATCH_QUEUE_PRIORITY_DEFAULT];
+    self.fileCache = [[OCFWebServerFileCache alloc] init];
+    self.metrics = [[OCFWebServerMetrics alloc] init];
     [self setupHeaderLogging];
   }
   return self;
@@ -184,20 +234,29 @@ static void _SignalHandler(int signal) {
 
 #pragma mark - NSObject
 - (void)dealloc {
-  if (self.source) {
+  if (self.sources) {
     [self stop];
   }
+  [self.timerWheel invalidate];
 }
 
 #pragma mark - OCFWebServer
 - (void)addHandlerWithMatchBlock:(OCFWebServerMatchBlock)matchBlock processBlock:(OCFWebServerProcessBlock)handlerBlock {
-  DCHECK(self.source == NULL);
-  OCFWebServerHandler *handler = [[OCFWebServerHandler alloc] initWithMatchBlock:matchBlock processBlock:handlerBlock];
+  [self addHandlerWithMatchBlock:matchBlock processBlock:handlerBlock workerPool:nil];
+}
+
+- (void)addHandlerWithMatchBlock:(OCFWebServerMatchBlock)matchBlock processBlock:(OCFWebServerProcessBlock)handlerBlock workerPool:(OCFWebServerWorkerPool*)workerPool {
+  OCFWebServerHandler *handler = [[OCFWebServerHandler alloc] initWithMatchBlock:matchBlock processBlock:handlerBlock workerPool:workerPool];
+  [self _addHandler:handler];
+}
+
+- (void)_addHandler:(OCFWebServerHandler*)handler {
+  DCHECK(self.sources == nil);
   [_handlers insertObject:handler atIndex:0];
 }
 
 - (void)removeAllHandlers {
-  DCHECK(self.source == NULL);
+  DCHECK(self.sources == nil);
   [_handlers removeAllObjects];
 }
 
@@ -205,6 +264,7 @@ static void _SignalHandler(int signal) {
   return [self startWithPort:8080 bonjourName:@""];
 }
 
+#if defined(__APPLE__)
 static void _NetServiceClientCallBack(CFNetServiceRef service, CFStreamError* error, void* info) {
   @autoreleasepool {
     if (error->error) {
@@ -214,138 +274,324 @@ static void _NetServiceClientCallBack(CFNetServiceRef service, CFStreamError* er
     }
   }
 }
+#endif
 
 - (BOOL)startWithPort:(NSUInteger)port bonjourName:(NSString *)name {
   return [self startWithPort:port bonjourName:name maxPendingConnections:16];
 }
 
 - (BOOL)startWithPort:(NSUInteger)port bonjourName:(NSString*)name maxPendingConnections:(NSUInteger)maxPendingConnections {
-  DCHECK(self.source == NULL);
-  if (maxPendingConnections > SOMAXCONN) {
-    // We could truncate maxPendingConnections to SOMAXCONN here but let's not do this. listen(int, int) does that internally already.
-    // This should be more future proof but we want to let the developer know about that.
-    LOG_WARNING(@"Max. number of pending connections was set to %i. The kernel truncates this value to %i to be aware of that (see ‘$ man listen' for details).");
-  }
-  self.maxPendingConnections = maxPendingConnections;
+  return [self startWithListenAddresses:@[[NSString stringWithFormat:@":%lu", (unsigned long)port]] bonjourName:name maxPendingConnections:maxPendingConnections];
+}
 
-  int listeningSocket = socket(PF_INET, SOCK_STREAM, IPPROTO_TCP);
-  if (listeningSocket > 0) {
-    int yes = 1;
-    setsockopt(listeningSocket, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+// Returns a non-blocking listening socket or -1 on error with the errno of the failing call in "error". Only shards share
+// their port with SO_REUSEPORT so binding a port already in use by another server still fails.
+- (int)_createListeningSocketWithAddress:(const struct sockaddr*)address length:(socklen_t)length reusePort:(BOOL)reusePort error:(int*)error {
+  int listeningSocket = socket(address->sa_family, SOCK_STREAM, IPPROTO_TCP);
+  if (listeningSocket < 0) {
+    *error = errno;
+    return -1;
+  }
+  int yes = 1;
+  setsockopt(listeningSocket, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+  if (reusePort) {
     setsockopt(listeningSocket, SOL_SOCKET, SO_REUSEPORT, &yes, sizeof(yes));
-    
-    struct sockaddr_in addr4;
-    bzero(&addr4, sizeof(addr4));
-    addr4.sin_len = sizeof(addr4);
-    addr4.sin_family = AF_INET;
-    addr4.sin_port = htons(port);
-    addr4.sin_addr.s_addr = htonl(INADDR_ANY);
-    if (bind(listeningSocket, (void*)&addr4, sizeof(addr4)) == 0) {
-      if (listen(listeningSocket, (int)self.maxPendingConnections) == 0) {
-        self.source = dispatch_source_create(DISPATCH_SOURCE_TYPE_READ, listeningSocket, 0, kOCFWebServerGCDQueue);
-        dispatch_source_set_cancel_handler(self.source, ^{
-          @autoreleasepool {
-            int result = close(listeningSocket);
-            if (result != 0) {
-              LOG_ERROR(@"Failed closing socket (%i): %s", errno, strerror(errno));
-            } else {
-              LOG_DEBUG(@"Closed listening socket");
-            }
-          }
-        });
-        dispatch_source_set_event_handler(self.source, ^{
-          
-          @autoreleasepool {
-            struct sockaddr addr;
-            socklen_t addrlen = sizeof(addr);
-            int socket = accept(listeningSocket, &addr, &addrlen);
-            if (socket > 0) {
-              int yes = 1;
-              setsockopt(socket, SOL_SOCKET, SO_NOSIGPIPE, &yes, sizeof(yes));  // Make sure this socket cannot generate SIG_PIPE
-              
-              NSData* data = [NSData dataWithBytes:&addr length:addrlen];
-              Class connectionClass = [[self class] connectionClass];
-              OCFWebServerConnection *connection = [[connectionClass alloc] initWithServer:self address:data socket:socket];
-              @synchronized(_connections) {
-                [self.connections addObject:connection];
-                LOG_DEBUG(@"%lu number of connections", self.connections.count);
-              }
-              __typeof__(connection) __weak weakConnection = connection;
-              [connection openWithCompletionHandler:^{
-                @synchronized(_connections) {
-                  if(weakConnection != nil) {
-                    [self.connections removeObject:weakConnection];
-                    LOG_DEBUG(@"%lu number of connections", self.connections.count);
-                  }
-                }
-              }];
-            } else {
-              LOG_ERROR(@"Failed accepting socket (%i): %s", errno, strerror(errno));
-            }
-          }
-          
-        });
-        
-        if (port == 0) {  // Determine the actual port we are listening on
-          struct sockaddr addr;
-          socklen_t addrlen = sizeof(addr);
-          if (getsockname(listeningSocket, &addr, &addrlen) == 0) {
-            struct sockaddr_in* sockaddr = (struct sockaddr_in*)&addr;
-            _port = ntohs(sockaddr->sin_port);
-          } else {
-            LOG_ERROR(@"Failed retrieving socket address (%i): %s", errno, strerror(errno));
+  }
+  if (address->sa_family == AF_INET6) {
+    setsockopt(listeningSocket, IPPROTO_IPV6, IPV6_V6ONLY, &yes, sizeof(yes));  // IPv4 has its own listeners
+  }
+  fcntl(listeningSocket, F_SETFD, FD_CLOEXEC);
+  fcntl(listeningSocket, F_SETFL, fcntl(listeningSocket, F_GETFL) | O_NONBLOCK);  // Required to drain the accept queue
+  if ((bind(listeningSocket, address, length) != 0) || (listen(listeningSocket, (int)self.maxPendingConnections) != 0)) {
+    *error = errno;
+    close(listeningSocket);
+    return -1;
+  }
+  return listeningSocket;
+}
+
+- (void)_openConnectionWithSocket:(int)socket address:(const struct sockaddr*)address length:(socklen_t)length {
+#ifdef SO_NOSIGPIPE
+  int yes = 1;
+  setsockopt(socket, SOL_SOCKET, SO_NOSIGPIPE, &yes, sizeof(yes));  // Make sure this socket cannot generate SIG_PIPE
+#endif
+  OCFWebServerMetrics* metrics = self.metrics;
+  if (![self _admitConnection]) {
+    [metrics.connectionsRejected increment];
+    write(socket, _serviceUnavailableResponse, sizeof(_serviceUnavailableResponse) - 1);  // The send buffer of a new socket cannot be full
+    close(socket);
+    return;
+  }
+  [metrics.connectionsAccepted increment];
+  NSData* data = [NSData dataWithBytes:address length:length];
+  Class connectionClass = [[self class] connectionClass];
+  OCFWebServerConnection *connection = [[connectionClass alloc] initWithServer:self address:data socket:socket];
+  @synchronized(_connections) {
+    [self.connections addObject:connection];
+    LOG_DEBUG(@"%lu number of connections", self.connections.count);
+    if (self.maxConnections && (self.connections.count >= self.maxConnections) && !self.rejectsConnectionsOverLimit && !self.acceptingSuspended) {
+      LOG_WARNING(@"Reached the limit of %lu connections: pausing accepting new ones", (unsigned long)self.maxConnections);
+      for (dispatch_source_t source in self.sources) {
+        dispatch_suspend(source);  // Further clients wait in the listen backlogs
+      }
+      self.acceptingSuspended = YES;
+    }
+  }
+  __typeof__(connection) __weak weakConnection = connection;
+  [connection openWithCompletionHandler:^{
+    [metrics.connectionsClosed increment];
+    @synchronized(_connections) {
+      if(weakConnection != nil) {
+        [self.connections removeObject:weakConnection];
+        LOG_DEBUG(@"%lu number of connections", self.connections.count);
+      }
+      [self _resumeAcceptingIfPossible];
+    }
+  }];
+}
+
+// Drains the accept queue of the socket so a burst of connections is handled in a single event
+- (void)_acceptConnectionsOnSocket:(int)listeningSocket {
+  while (!self.acceptingSuspended) {
+    struct sockaddr_storage addr;
+    socklen_t addrlen = sizeof(addr);
+#if defined(__linux__)
+    int socket = accept4(listeningSocket, (struct sockaddr*)&addr, &addrlen, SOCK_NONBLOCK | SOCK_CLOEXEC);
+#else
+    int socket = accept(listeningSocket, (struct sockaddr*)&addr, &addrlen);
+    if (socket >= 0) {
+      fcntl(socket, F_SETFD, FD_CLOEXEC);
+      fcntl(socket, F_SETFL, fcntl(socket, F_GETFL) | O_NONBLOCK);
+    }
+#endif
+    if (socket < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) {
+        continue;
+      }
+      if ((errno != EAGAIN) && (errno != EWOULDBLOCK)) {
+        LOG_ERROR(@"Failed accepting socket (%i): %s", errno, strerror(errno));
+      }
+      break;
+    }
+    [self _openConnectionWithSocket:socket address:(struct sockaddr*)&addr length:addrlen];
+  }
+}
+
+// Binds listenerShardCount sockets to every address the listen address resolves to. Returns NO if any of them fails,
+// except that a wildcard address skips the families the host does not support (e.g. IPv6 on an IPv4-only host) and
+// only fails if none is left.
+- (BOOL)_addListenersForAddress:(NSString*)listenAddress sources:(NSMutableArray*)sources {
+  NSString* host = nil;
+  NSString* service = listenAddress;
+  if ([listenAddress hasPrefix:@"["]) {  // "[::1]:8080"
+    NSRange end = [listenAddress rangeOfString:@"]:"];
+    if (end.location == NSNotFound) {
+      LOG_ERROR(@"Invalid listen address \"%@\"", listenAddress);
+      return NO;
+    }
+    host = [listenAddress substringWithRange:NSMakeRange(1, end.location - 1)];
+    service = [listenAddress substringFromIndex:NSMaxRange(end)];
+  } else {
+    NSRange colon = [listenAddress rangeOfString:@":" options:NSBackwardsSearch];
+    if (colon.location != NSNotFound) {  // "127.0.0.1:8080" or ":8080"
+      host = (colon.location > 0 ? [listenAddress substringToIndex:colon.location] : nil);
+      service = [listenAddress substringFromIndex:NSMaxRange(colon)];
+    }
+  }
+  struct addrinfo hints;
+  bzero(&hints, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = AI_PASSIVE | AI_NUMERICHOST | AI_NUMERICSERV;
+  struct addrinfo* info = NULL;
+  int error = getaddrinfo([host UTF8String], [service UTF8String], &hints, &info);
+  if (error != 0) {
+    LOG_ERROR(@"Invalid listen address \"%@\": %s", listenAddress, gai_strerror(error));
+    return NO;
+  }
+  BOOL success = YES;
+  NSUInteger sourceCount = sources.count;
+  in_port_t boundPort = 0;  // Port picked by the kernel for the first socket when asking for port 0
+  NSUInteger shardCount = MAX(self.listenerShardCount, 1);
+  for (struct addrinfo* ai = info; ai && success; ai = ai->ai_next) {
+    struct sockaddr_storage address;
+    memcpy(&address, ai->ai_addr, ai->ai_addrlen);
+    for (NSUInteger i = 0; (i < shardCount) && success; ++i) {
+      in_port_t* port = (address.ss_family == AF_INET6 ? &((struct sockaddr_in6*)&address)->sin6_port : &((struct sockaddr_in*)&address)->sin_port);
+      if ((*port == 0) && boundPort) {
+        *port = boundPort;
+      }
+      int socketError = 0;
+      int listeningSocket = [self _createListeningSocketWithAddress:(struct sockaddr*)&address length:ai->ai_addrlen reusePort:(shardCount > 1) error:&socketError];
+      if (listeningSocket < 0) {
+        if ((host == nil) && ((socketError == EAFNOSUPPORT) || (socketError == EADDRNOTAVAIL))) {
+          LOG_WARNING(@"Skipping address family %i for listen address \"%@\" (%i): %s", ai->ai_family, listenAddress, socketError, strerror(socketError));
+        } else {
+          LOG_ERROR(@"Failed listening on \"%@\" (%i): %s", listenAddress, socketError, strerror(socketError));
+          success = NO;
+        }
+        break;
+      }
+      if (boundPort == 0) {
+        struct sockaddr_storage actual;
+        socklen_t actualLength = sizeof(actual);
+        if (getsockname(listeningSocket, (struct sockaddr*)&actual, &actualLength) == 0) {
+          boundPort = (actual.ss_family == AF_INET6 ? ((struct sockaddr_in6*)&actual)->sin6_port : ((struct sockaddr_in*)&actual)->sin_port);
+          if (_port == 0) {
+            _port = ntohs(boundPort);
           }
         } else {
-          _port = port;
+          LOG_ERROR(@"Failed retrieving socket address (%i): %s", errno, strerror(errno));
         }
-        
-        if (name) {
-          CFStringRef cfName = CFBridgingRetain(name);
-          _service = CFNetServiceCreate(kCFAllocatorDefault, CFSTR("local."), CFSTR("_http._tcp"), cfName, (SInt32)_port);
-          CFRelease(cfName);
-          if (_service) {
-            CFNetServiceClientContext context = {0, (__bridge void *)(self), NULL, NULL, NULL};
-            CFNetServiceSetClient(_service, _NetServiceClientCallBack, &context);
-            CFNetServiceScheduleWithRunLoop(_service, CFRunLoopGetMain(), kCFRunLoopCommonModes);
-            CFStreamError error = {0};
-            CFNetServiceRegisterWithOptions(_service, 0, &error);
+      }
+      
+      dispatch_source_t source = dispatch_source_create(DISPATCH_SOURCE_TYPE_READ, listeningSocket, 0, kOCFWebServerGCDQueue);
+      dispatch_source_set_cancel_handler(source, ^{
+        @autoreleasepool {
+          int result = close(listeningSocket);
+          if (result != 0) {
+            LOG_ERROR(@"Failed closing socket (%i): %s", errno, strerror(errno));
           } else {
-            LOG_ERROR(@"Failed creating CFNetService");
+            LOG_DEBUG(@"Closed listening socket");
           }
         }
-        
-        dispatch_resume(self.source);
-        LOG_VERBOSE(@"%@ started on port %i", [self class], (int)_port);
-      } else {
-        LOG_ERROR(@"Failed listening on socket (%i): %s", errno, strerror(errno));
-        close(listeningSocket);
+      });
+      dispatch_source_set_event_handler(source, ^{
+        @autoreleasepool {
+          [self _acceptConnectionsOnSocket:listeningSocket];
+        }
+      });
+      [sources addObject:source];
+    }
+  }
+  freeaddrinfo(info);
+  if (success && (sources.count == sourceCount)) {
+    LOG_ERROR(@"No usable address for listen address \"%@\"", listenAddress);
+    success = NO;
+  }
+  return success;
+}
+
+- (BOOL)startWithListenAddresses:(NSArray*)addresses bonjourName:(NSString*)name maxPendingConnections:(NSUInteger)maxPendingConnections {
+  DCHECK(self.sources == nil);
+  DCHECK(addresses.count > 0);
+  if (maxPendingConnections > SOMAXCONN) {
+    // We could truncate maxPendingConnections to SOMAXCONN here but let's not do this. listen(int, int) does that internally already.
+    // This should be more future proof but we want to let the developer know about that.
+    LOG_WARNING(@"Max. number of pending connections was set to %i. The kernel truncates this value to %i to be aware of that (see ‘$ man listen' for details).");
+  }
+#ifndef SO_NOSIGPIPE
+  signal(SIGPIPE, SIG_IGN);  // Sockets cannot opt out of SIGPIPE individually on this platform
+#endif
+  self.maxPendingConnections = maxPendingConnections;
+  for (OCFWebServerHandler* handler in _handlers) {
+    NSString* route = (handler.routeType == OCFWebServerRouteTypeCustom ? @"custom" : [NSString stringWithFormat:@"%@ %@", handler.method, handler.pattern]);
+    handler.routeMetrics = [self.metrics metricsForRoute:route];
+  }
+  self.router = [[OCFWebServerRouter alloc] initWithHandlers:[_handlers copy]];
+  self.serverHeaderData = [[NSString stringWithFormat:@"Server: %@\r\n", [[self class] serverName]] dataUsingEncoding:NSUTF8StringEncoding];
+  if (self.timerWheel == nil) {  // Kept across restarts for the connections still open
+    self.timerWheel = [[OCFWebServerTimerWheel alloc] initWithResolution:1.0];
+  }
+  
+  _port = 0;
+  NSMutableArray* sources = [[NSMutableArray alloc] init];
+  for (NSString* address in addresses) {
+    if (![self _addListenersForAddress:address sources:sources]) {
+      for (dispatch_source_t source in sources) {
+        dispatch_source_cancel(source);  // Never resumed so the cancel handler closing the socket runs right away
+        dispatch_resume(source);
       }
+      self.router = nil;
+      self.serverHeaderData = nil;
+      _port = 0;
+      return NO;
+    }
+  }
+  self.sources = sources;
+  
+#if defined(__APPLE__)
+  if (name) {
+    CFStringRef cfName = CFBridgingRetain(name);
+    _service = CFNetServiceCreate(kCFAllocatorDefault, CFSTR("local."), CFSTR("_http._tcp"), cfName, (SInt32)_port);
+    CFRelease(cfName);
+    if (_service) {
+      CFNetServiceClientContext context = {0, (__bridge void *)(self), NULL, NULL, NULL};
+      CFNetServiceSetClient(_service, _NetServiceClientCallBack, &context);
+      CFNetServiceScheduleWithRunLoop(_service, CFRunLoopGetMain(), kCFRunLoopCommonModes);
+      CFStreamError error = {0};
+      CFNetServiceRegisterWithOptions(_service, 0, &error);
     } else {
-      LOG_ERROR(@"Failed binding socket (%i): %s", errno, strerror(errno));
-      close(listeningSocket);
+      LOG_ERROR(@"Failed creating CFNetService");
     }
-  } else {
-    LOG_ERROR(@"Failed creating socket (%i): %s", errno, strerror(errno));
   }
-  return (self.source ? YES : NO);
+#else
+  if (name.length) {
+    LOG_WARNING(@"Bonjour is not available on this platform");
+  }
+#endif
+  
+  for (dispatch_source_t source in self.sources) {
+    dispatch_resume(source);
+  }
+  LOG_VERBOSE(@"%@ started on port %i with %lu listening socket(s)", [self class], (int)_port, (unsigned long)self.sources.count);
+  return YES;
 }
 
 - (BOOL)isRunning {
-  return (self.source ? YES : NO);
+  return (self.sources ? YES : NO);
+}
+
+// Only ever NO when rejecting connections over the limit since the listening source is paused otherwise
+- (BOOL)_admitConnection {
+  if ((self.maxConnections == 0) || !self.rejectsConnectionsOverLimit) {
+    return YES;
+  }
+  @synchronized(_connections) {
+    if (self.connections.count < self.maxConnections) {
+      return YES;
+    }
+  }
+  LOG_WARNING(@"Rejecting connection over the limit of %lu connections", (unsigned long)self.maxConnections);
+  return NO;
+}
+
+// Must be called with the connections locked
+- (void)_resumeAcceptingIfPossible {
+  if (self.acceptingSuspended && ((self.maxConnections == 0) || (self.connections.count < self.maxConnections))) {
+    LOG_VERBOSE(@"Resuming accepting connections");
+    self.acceptingSuspended = NO;
+    for (dispatch_source_t source in self.sources) {
+      dispatch_resume(source);
+    }
+  }
 }
 
 - (void)stop {
-  DCHECK(self.source != nil);
-  if (self.source) {
+  DCHECK(self.sources != nil);
+  if (self.sources) {
+#if defined(__APPLE__)
     if (self.service) {
       CFNetServiceUnscheduleFromRunLoop(self.service, CFRunLoopGetMain(), kCFRunLoopCommonModes);
       CFNetServiceSetClient(self.service, NULL, NULL);
       CFRelease(self.service);
       self.service = NULL;
     }
+#endif
     
-    dispatch_source_cancel(self.source);  // This will close the socket
-    self.source = nil;    
+    @synchronized(_connections) {
+      for (dispatch_source_t source in self.sources) {
+        if (self.acceptingSuspended) {  // Suspended sources cannot be cancelled
+          dispatch_resume(source);
+        }
+        dispatch_source_cancel(source);  // This will close the socket
+      }
+      self.acceptingSuspended = NO;
+    }
+    self.sources = nil;
+    self.router = nil;
+    self.serverHeaderData = nil;
+    [self.accessLog flush];
     LOG_VERBOSE(@"%@ stopped", [self class]);
   }
   self.port = 0;
@@ -367,6 +613,12 @@ static void _NetServiceClientCallBack(CFNetServiceRef service, CFStreamError* er
 
 @implementation OCFWebServer (Extensions)
 
++ (void)setLogLevel:(NSInteger)level {
+#ifndef __GCDWEBSERVER_LOGGING_HEADER__
+  OCFWebServerLogLevel = level;
+#endif
+}
+
 - (BOOL)runWithPort:(NSUInteger)port {
   BOOL success = NO;
   _run = YES;
@@ -374,7 +626,11 @@ static void _NetServiceClientCallBack(CFNetServiceRef service, CFStreamError* er
   if (handler != SIG_ERR) {
     if ([self startWithPort:port bonjourName:@""]) {
       while (_run) {
+#if defined(__APPLE__)
         CFRunLoopRunInMode(kCFRunLoopDefaultMode, 1.0, true);
+#else
+        [[NSRunLoop currentRunLoop] runMode:NSDefaultRunLoopMode beforeDate:[NSDate dateWithTimeIntervalSinceNow:1.0]];
+#endif
       }
       [self stop];
       success = YES;
@@ -388,46 +644,47 @@ static void _NetServiceClientCallBack(CFNetServiceRef service, CFStreamError* er
 
 @implementation OCFWebServer (Handlers)
 
+- (void)_addHandlerWithRouteType:(OCFWebServerRouteType)routeType method:(NSString*)method pattern:(NSString*)pattern matchBlock:(OCFWebServerMatchBlock)matchBlock processBlock:(OCFWebServerProcessBlock)processBlock {
+  [self _addHandlerWithRouteType:routeType method:method pattern:pattern matchBlock:matchBlock processBlock:processBlock workerPool:nil];
+}
+
+- (void)_addHandlerWithRouteType:(OCFWebServerRouteType)routeType method:(NSString*)method pattern:(NSString*)pattern matchBlock:(OCFWebServerMatchBlock)matchBlock processBlock:(OCFWebServerProcessBlock)processBlock workerPool:(OCFWebServerWorkerPool*)workerPool {
+  OCFWebServerHandler *handler = [[OCFWebServerHandler alloc] initWithRouteType:routeType method:method pattern:pattern matchBlock:matchBlock processBlock:processBlock workerPool:workerPool];
+  [self _addHandler:handler];
+}
+
 - (void)addDefaultHandlerForMethod:(NSString*)method requestClass:(Class)class processBlock:(OCFWebServerProcessBlock)block {
   [self addHandlerWithMatchBlock:^OCFWebServerRequest *(NSString* requestMethod, NSURL* requestURL, NSDictionary* requestHeaders, NSString* urlPath, NSDictionary* urlQuery) {
     return [[class alloc] initWithMethod:requestMethod URL:requestURL headers:requestHeaders path:urlPath query:urlQuery];
   } processBlock:block];
 }
 
-- (OCFWebServerResponse*)_responseWithContentsOfFile:(NSString*)path {
-  return [OCFWebServerFileResponse responseWithFile:path];
+- (OCFWebServerFileCacheEntry*)_fileCacheEntryForPath:(NSString*)path {
+  OCFWebServerFileCache* fileCache = self.fileCache;
+  return (fileCache ? [fileCache entryForPath:path] : [OCFWebServerFileCacheEntry entryWithPath:path]);
 }
 
-- (OCFWebServerResponse*)_responseWithContentsOfDirectory:(NSString*)path {
-  NSDirectoryEnumerator* enumerator = [[NSFileManager defaultManager] enumeratorAtPath:path];
-  if (enumerator == nil) {
-    return nil;
-  }
-  NSMutableString* html = [NSMutableString string];
-  [html appendString:@"<html><body>\n"];
-  [html appendString:@"<ul>\n"];
-  for (NSString* file in enumerator) {
-    if (![file hasPrefix:@"."]) {
-      NSString* type = [enumerator fileAttributes][NSFileType];
-      NSString* escapedFile = [file stringByAddingPercentEscapesUsingEncoding:NSUTF8StringEncoding];
-      DCHECK(escapedFile);
-      if ([type isEqualToString:NSFileTypeRegular]) {
-        [html appendFormat:@"<li><a href=\"%@\">%@</a></li>\n", escapedFile, file];
-      } else if ([type isEqualToString:NSFileTypeDirectory]) {
-        [html appendFormat:@"<li><a href=\"%@/\">%@/</a></li>\n", escapedFile, file];
-      }
+// Serves "file.gz" instead of "file" to clients accepting gzip if it is at least as recent
+- (OCFWebServerResponse*)_responseWithFileCacheEntry:(OCFWebServerFileCacheEntry*)entry request:(OCFWebServerRequest*)request {
+  OCFWebServerFileCacheEntry* gzipEntry = nil;
+  if (![[entry.path pathExtension] isEqualToString:@"gz"]) {
+    gzipEntry = [self _fileCacheEntryForPath:[entry.path stringByAppendingPathExtension:@"gz"]];
+    if (gzipEntry.directory || (gzipEntry.modificationTime < entry.modificationTime)) {
+      gzipEntry = nil;
     }
-    [enumerator skipDescendents];
   }
-  [html appendString:@"</ul>\n"];
-  [html appendString:@"</body></html>\n"];
-  return [OCFWebServerDataResponse responseWithHTML:html];
+  return [OCFWebServerFileResponse _responseWithCacheEntry:entry gzipEntry:gzipEntry isAttachment:NO requestHeaders:request.headers];
+}
+
+- (OCFWebServerResponse*)_responseWithContentsOfDirectory:(OCFWebServerFileCacheEntry*)entry {
+  NSData* listing = entry.directoryListing;  // Cached with the entry until the directory changes
+  return (listing ? [OCFWebServerDataResponse responseWithData:listing contentType:@"text/html; charset=utf-8"] : nil);
 }
 
 - (void)addHandlerForBasePath:(NSString*)basePath localPath:(NSString*)localPath indexFilename:(NSString*)indexFilename cacheAge:(NSUInteger)cacheAge {
   __typeof__(self) __weak weakSelf = self;
   if ([basePath hasPrefix:@"/"] && [basePath hasSuffix:@"/"]) {
-    [self addHandlerWithMatchBlock:^OCFWebServerRequest *(NSString* requestMethod, NSURL* requestURL, NSDictionary* requestHeaders, NSString* urlPath, NSDictionary* urlQuery) {
+    [self _addHandlerWithRouteType:OCFWebServerRouteTypeBasePath method:@"GET" pattern:basePath matchBlock:^OCFWebServerRequest *(NSString* requestMethod, NSURL* requestURL, NSDictionary* requestHeaders, NSString* urlPath, NSDictionary* urlQuery) {
       
       if (![requestMethod isEqualToString:@"GET"]) {
         return nil;
@@ -440,19 +697,19 @@ static void _NetServiceClientCallBack(CFNetServiceRef service, CFStreamError* er
     } processBlock:^(OCFWebServerRequest* request) {
       OCFWebServerResponse* response = nil;
       NSString* filePath = [localPath stringByAppendingPathComponent:[request.path substringFromIndex:basePath.length]];
-      BOOL isDirectory;
-      if ([[NSFileManager defaultManager] fileExistsAtPath:filePath isDirectory:&isDirectory]) {
-        if (isDirectory) {
-          if (indexFilename) {
-            NSString* indexPath = [filePath stringByAppendingPathComponent:indexFilename];
-            if ([[NSFileManager defaultManager] fileExistsAtPath:indexPath isDirectory:&isDirectory] && !isDirectory) {
-              response = [weakSelf _responseWithContentsOfFile:indexPath];
-            }
+      OCFWebServerFileCacheEntry* entry = [weakSelf _fileCacheEntryForPath:filePath];
+      if (entry.directory) {
+        if (indexFilename) {
+          OCFWebServerFileCacheEntry* indexEntry = [weakSelf _fileCacheEntryForPath:[filePath stringByAppendingPathComponent:indexFilename]];
+          if (indexEntry && !indexEntry.directory) {
+            response = [weakSelf _responseWithFileCacheEntry:indexEntry request:request];
           }
-          response = [weakSelf _responseWithContentsOfDirectory:filePath];
-        } else {
-          response = [weakSelf _responseWithContentsOfFile:filePath];
         }
+        if (response == nil) {
+          response = [weakSelf _responseWithContentsOfDirectory:entry];
+        }
+      } else if (entry) {
+        response = [weakSelf _responseWithFileCacheEntry:entry request:request];
       }
       if (response) {
         response.cacheControlMaxAge = cacheAge;
@@ -467,8 +724,12 @@ static void _NetServiceClientCallBack(CFNetServiceRef service, CFStreamError* er
 }
 
 - (void)addHandlerForMethod:(NSString*)method path:(NSString*)path requestClass:(Class)class processBlock:(OCFWebServerProcessBlock)block {
+  [self addHandlerForMethod:method path:path requestClass:class workerPool:nil processBlock:block];
+}
+
+- (void)addHandlerForMethod:(NSString*)method path:(NSString*)path requestClass:(Class)class workerPool:(OCFWebServerWorkerPool*)workerPool processBlock:(OCFWebServerProcessBlock)block {
   if ([path hasPrefix:@"/"] && [class isSubclassOfClass:[OCFWebServerRequest class]]) {
-    [self addHandlerWithMatchBlock:^OCFWebServerRequest *(NSString* requestMethod, NSURL* requestURL, NSDictionary* requestHeaders, NSString* urlPath, NSDictionary* urlQuery) {
+    [self _addHandlerWithRouteType:OCFWebServerRouteTypePath method:method pattern:path matchBlock:^OCFWebServerRequest *(NSString* requestMethod, NSURL* requestURL, NSDictionary* requestHeaders, NSString* urlPath, NSDictionary* urlQuery) {
       
       if (![requestMethod isEqualToString:method]) {
         return nil;
@@ -478,16 +739,29 @@ static void _NetServiceClientCallBack(CFNetServiceRef service, CFStreamError* er
       }
       return [[class alloc] initWithMethod:requestMethod URL:requestURL headers:requestHeaders path:urlPath query:urlQuery];
       
-    } processBlock:block];
+    } processBlock:block workerPool:workerPool];
   } else {
     DNOT_REACHED();
   }
 }
 
+- (void)addMetricsHandlerForPath:(NSString*)path {
+  __typeof__(self) __weak weakSelf = self;
+  [self addHandlerForMethod:@"GET" path:path requestClass:[OCFWebServerRequest class] processBlock:^(OCFWebServerRequest* request) {
+    NSData* data = [[weakSelf.metrics prometheusText] dataUsingEncoding:NSUTF8StringEncoding];
+    OCFWebServerResponse* response = (data ? [OCFWebServerDataResponse responseWithData:data contentType:@"text/plain; version=0.0.4; charset=utf-8"] : [OCFWebServerResponse responseWithStatusCode:404]);
+    [request respondWith:response];
+  }];
+}
+
 - (void)addHandlerForMethod:(NSString*)method pathRegex:(NSString*)regex requestClass:(Class)class processBlock:(OCFWebServerProcessBlock)block {
+  [self addHandlerForMethod:method pathRegex:regex requestClass:class workerPool:nil processBlock:block];
+}
+
+- (void)addHandlerForMethod:(NSString*)method pathRegex:(NSString*)regex requestClass:(Class)class workerPool:(OCFWebServerWorkerPool*)workerPool processBlock:(OCFWebServerProcessBlock)block {
   NSRegularExpression* expression = [NSRegularExpression regularExpressionWithPattern:regex options:NSRegularExpressionCaseInsensitive error:NULL];
   if (expression && [class isSubclassOfClass:[OCFWebServerRequest class]]) {
-    [self addHandlerWithMatchBlock:^OCFWebServerRequest *(NSString* requestMethod, NSURL* requestURL, NSDictionary* requestHeaders, NSString* urlPath, NSDictionary* urlQuery) {
+    [self _addHandlerWithRouteType:OCFWebServerRouteTypePathRegex method:method pattern:regex matchBlock:^OCFWebServerRequest *(NSString* requestMethod, NSURL* requestURL, NSDictionary* requestHeaders, NSString* urlPath, NSDictionary* urlQuery) {
       
       if (![requestMethod isEqualToString:method]) {
         return nil;
@@ -497,7 +771,7 @@ static void _NetServiceClientCallBack(CFNetServiceRef service, CFStreamError* er
       }
       return [[class alloc] initWithMethod:requestMethod URL:requestURL headers:requestHeaders path:urlPath query:urlQuery];
       
-    } processBlock:block];
+    } processBlock:block workerPool:workerPool];
   } else {
     DNOT_REACHED();
   }
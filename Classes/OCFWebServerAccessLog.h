@@ -0,0 +1,80 @@
+/*
+ This file belongs to the OCFWebServer project. OCFWebServer is a fork of GCDWebServer (originally developed by
+ Pierre-Olivier Latour). We have forked GCDWebServer because we made extensive and incompatible changes to it.
+ To find out more have a look at README.md.
+ 
+ Copyright (c) 2013, Christian Kienle / chris@objective-cloud.com
+ All rights reserved.
+ 
+ Original Copyright Statement:
+ Copyright (c) 2012-2013, Pierre-Olivier Latour
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ * Neither the name of the <organization> nor the
+ names of its contributors may be used to endorse or promote products
+ derived from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import <Foundation/Foundation.h>
+
+#define kOCFWebServerAccessLogMethodSize 16
+#define kOCFWebServerAccessLogTargetSize 240
+
+// One request as recorded by a connection: plain data so recording it is a copy into a ring buffer. Durations are in
+// microseconds and 0 for phases the request did not reach.
+typedef struct {
+  int64_t time;  // Microseconds since 1970 when the request completed
+  uint8_t addressFamily;  // AF_INET or AF_INET6 (0 if unknown)
+  uint8_t address[16];
+  uint16_t port;
+  uint16_t statusCode;
+  char method[kOCFWebServerAccessLogMethodSize];  // NUL-terminated (truncated if needed)
+  char target[kOCFWebServerAccessLogTargetSize];  // Request target as received (NUL-terminated, truncated if needed)
+  uint64_t bytesRead;
+  uint64_t bytesWritten;
+  uint32_t headerTime;  // First byte of the request to the end of the headers
+  uint32_t queueTime;  // Waiting for a worker of the handler's pool
+  uint32_t handlerTime;  // Process block starting to the response
+  uint32_t firstByteTime;  // End of the headers to the first byte of the response
+  uint32_t totalTime;  // First byte of the request to the last byte of the response
+} OCFWebServerAccessLogEntry;
+
+// Structured access log. Each thread recording requests copies them into its own lock-free ring buffer and a background
+// writer formats and writes them in batches, so connections never wait on the file. The writer runs periodically and
+// whenever a ring passes half full. Entries recorded while the ring of their thread is full are dropped and counted. Lines look like:
+// time=2013-10-17T09:30:00.123456Z peer=127.0.0.1:52814 method=GET target="/index.html" status=200 bytes_in=0 bytes_out=5120 header_us=18 queue_us=4 handler_us=95 ttfb_us=130 total_us=162
+@interface OCFWebServerAccessLog : NSObject
+
+#pragma mark - Properties
+@property(nonatomic, copy, readonly) NSString *path;  // nil when writing to a file descriptor
+@property(nonatomic, readonly) unsigned long long maximumFileSize;
+@property(nonatomic, readonly) NSUInteger maximumFileCount;
+@property(nonatomic, readonly) uint64_t droppedEntries;
+
+#pragma mark - Creating
+- (instancetype)initWithPath:(NSString*)path maximumFileSize:(unsigned long long)maximumFileSize maximumFileCount:(NSUInteger)maximumFileCount;  // Once the file reaches the size it is rotated to "path.1" and so on up to "path.<count - 1>" (a size of 0 never rotates)
+- (instancetype)initWithFileDescriptor:(int)fd;  // e.g. STDOUT_FILENO (not closed by the log)
+
+#pragma mark - Logging
+- (void)recordEntry:(const OCFWebServerAccessLogEntry*)entry;  // Can be called from any thread
+- (void)flush;  // Writes all the entries recorded so far before returning
+
+@end
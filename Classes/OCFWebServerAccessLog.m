@@ -0,0 +1,341 @@
+/*
+ This file belongs to the OCFWebServer project. OCFWebServer is a fork of GCDWebServer (originally developed by
+ Pierre-Olivier Latour). We have forked GCDWebServer because we made extensive and incompatible changes to it.
+ To find out more have a look at README.md.
+ 
+ Copyright (c) 2013, Christian Kienle / chris@objective-cloud.com
+ All rights reserved.
+ 
+ Original Copyright Statement:
+ Copyright (c) 2012-2013, Pierre-Olivier Latour
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ * Neither the name of the <organization> nor the
+ names of its contributors may be used to endorse or promote products
+ derived from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import <arpa/inet.h>
+#import <fcntl.h>
+#import <pthread.h>
+#import <stdatomic.h>
+#import <sys/stat.h>
+
+#import "OCFWebServerPrivate.h"
+#import "OCFWebServerAccessLog.h"
+
+#define kRingCapacity 1024  // Entries per thread (must be a power of 2): about 320 KB
+#define kFlushInterval 0.25  // Seconds (the writer is also woken up as soon as a ring is half full)
+#define kWriteBufferSize (64 * 1024)
+#define kMaximumLineSize 2048  // Upper bound of a formatted entry (every byte of the target could need escaping)
+
+// Single producer (the thread owning it) single consumer (the writer) ring, with the indexes on separate cache lines
+typedef struct {
+  _Atomic(uint32_t) head;  // Next entry the producer writes
+  char headPadding[60];
+  _Atomic(uint32_t) tail;  // Next entry the writer reads
+  atomic_bool abandoned;  // Set once the thread exits: the writer frees the ring after draining it
+  char tailPadding[59];
+  OCFWebServerAccessLogEntry entries[kRingCapacity];
+} OCFWebServerAccessLogRing;
+
+static void _AbandonRing(void* ring) {
+  atomic_store_explicit(&((OCFWebServerAccessLogRing*)ring)->abandoned, true, memory_order_release);
+}
+
+static char* _AppendFormattedEntry(char* buffer, const OCFWebServerAccessLogEntry* entry) {
+  char* position = buffer;
+  time_t seconds = (time_t)(entry->time / 1000000);
+  struct tm components;
+  gmtime_r(&seconds, &components);
+  position += strftime(position, 32, "time=%Y-%m-%dT%H:%M:%S", &components);
+  position += sprintf(position, ".%06dZ peer=", (int)(entry->time % 1000000));
+  
+  char address[INET6_ADDRSTRLEN];
+  if ((entry->addressFamily == AF_INET) && inet_ntop(AF_INET, entry->address, address, sizeof(address))) {
+    position += sprintf(position, "%s:%u", address, (unsigned int)entry->port);
+  } else if ((entry->addressFamily == AF_INET6) && inet_ntop(AF_INET6, entry->address, address, sizeof(address))) {
+    position += sprintf(position, "[%s]:%u", address, (unsigned int)entry->port);
+  } else {
+    *position++ = '-';
+  }
+  
+  position += sprintf(position, " method=%s target=\"", entry->method);
+  for (const char* character = entry->target; *character; ++character) {  // Keeps every line a single parsable line
+    unsigned char byte = (unsigned char)*character;
+    if ((byte == '"') || (byte == '\\')) {
+      *position++ = '\\';
+      *position++ = byte;
+    } else if ((byte < 0x20) || (byte >= 0x7F)) {
+      position += sprintf(position, "\\x%02X", byte);
+    } else {
+      *position++ = byte;
+    }
+  }
+  position += sprintf(position, "\" status=%u bytes_in=%llu bytes_out=%llu header_us=%u queue_us=%u handler_us=%u ttfb_us=%u total_us=%u\n",
+                      (unsigned int)entry->statusCode, (unsigned long long)entry->bytesRead, (unsigned long long)entry->bytesWritten,
+                      entry->headerTime, entry->queueTime, entry->handlerTime, entry->firstByteTime, entry->totalTime);
+  return position;
+}
+
+@interface OCFWebServerAccessLog ()
+
+#pragma mark - Properties
+@property(nonatomic, copy, readwrite) NSString *path;
+@property(nonatomic, readwrite) unsigned long long maximumFileSize;
+@property(nonatomic, readwrite) NSUInteger maximumFileCount;
+@property(nonatomic, assign) int file;
+@property(nonatomic, assign) BOOL ownsFile;
+@property(nonatomic, assign) unsigned long long fileSize;  // Writer queue only
+@property(nonatomic, assign) uint64_t reportedDroppedEntries;  // Writer queue only
+@property(nonatomic, strong) dispatch_queue_t queue;  // Serial queue the writer runs on
+@property(nonatomic, strong) dispatch_source_t timer;
+@property(nonatomic, strong) dispatch_source_t drainSource;  // Signaled by the producers when their ring passes half full
+
+@end
+
+@implementation OCFWebServerAccessLog {
+  pthread_key_t _ringKey;
+  OCFWebServerAccessLogRing** _rings;  // Guarded by self
+  NSUInteger _ringCount;
+  NSUInteger _ringCapacity;
+  _Atomic(uint64_t) _droppedEntries;
+  char* _buffer;  // Writer queue only (kWriteBufferSize plus room for one more line)
+  OCFWebServerAccessLogRing** _drainRings;  // Writer queue only (snapshot of the rings taken under the lock)
+  NSUInteger _drainRingCapacity;
+}
+
+#pragma mark - Creating
+- (instancetype)initWithPath:(NSString*)path maximumFileSize:(unsigned long long)maximumFileSize maximumFileCount:(NSUInteger)maximumFileCount {
+  int file = open([path fileSystemRepresentation], O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+  if (file < 0) {
+    LOG_ERROR(@"Failed opening access log \"%@\" (%i): %s", path, errno, strerror(errno));
+    return nil;
+  }
+  if((self = [self _initWithFile:file])) {
+    self.path = path;
+    self.maximumFileSize = maximumFileSize;
+    self.maximumFileCount = MAX(maximumFileCount, 1);
+    self.ownsFile = YES;
+    struct stat info;
+    self.fileSize = (fstat(file, &info) == 0 ? info.st_size : 0);
+  } else {
+    close(file);
+  }
+  return self;
+}
+
+- (instancetype)initWithFileDescriptor:(int)fd {
+  return [self _initWithFile:fd];
+}
+
+- (instancetype)_initWithFile:(int)file {
+  if((self = [super init])) {
+    if (pthread_key_create(&_ringKey, _AbandonRing) != 0) {
+      DNOT_REACHED();
+      return nil;
+    }
+    self.file = file;
+    atomic_init(&_droppedEntries, 0);
+    _buffer = malloc(kWriteBufferSize + kMaximumLineSize);
+    self.queue = dispatch_queue_create("ocfwebserver.accesslog", DISPATCH_QUEUE_SERIAL);
+    dispatch_set_target_queue(self.queue, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_LOW, 0));  // Background threads can starve while the connections keep the CPUs busy
+    self.timer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, self.queue);
+    dispatch_source_set_timer(self.timer, dispatch_time(DISPATCH_TIME_NOW, kFlushInterval * NSEC_PER_SEC), kFlushInterval * NSEC_PER_SEC, kFlushInterval * NSEC_PER_SEC / 2);
+    __typeof__(self) __weak weakSelf = self;
+    dispatch_source_set_event_handler(self.timer, ^{
+      [weakSelf _drain];
+    });
+    dispatch_resume(self.timer);
+    self.drainSource = dispatch_source_create(DISPATCH_SOURCE_TYPE_DATA_OR, 0, 0, self.queue);  // Signals coalesce until the drain runs
+    dispatch_source_set_event_handler(self.drainSource, ^{
+      [weakSelf _drain];
+    });
+    dispatch_resume(self.drainSource);
+  }
+  return self;
+}
+
+// A drain already running holds a strong reference so none can be running here: whatever is left is written directly
+- (void)dealloc {
+  if (self.timer) {
+    dispatch_source_cancel(self.timer);
+    dispatch_source_cancel(self.drainSource);
+    [self _drain];
+    pthread_key_delete(_ringKey);  // Exiting threads no longer touch the rings
+    for (NSUInteger i = 0; i < _ringCount; ++i) {
+      free(_rings[i]);
+    }
+    free(_rings);
+    free(_drainRings);
+    free(_buffer);
+    if (self.ownsFile) {
+      close(self.file);
+    }
+  }
+}
+
+#pragma mark - Properties
+- (uint64_t)droppedEntries {
+  return atomic_load_explicit(&_droppedEntries, memory_order_relaxed);
+}
+
+#pragma mark - Logging
+- (OCFWebServerAccessLogRing*)_registerRing {
+  OCFWebServerAccessLogRing* ring = NULL;
+  if (posix_memalign((void**)&ring, 64, sizeof(OCFWebServerAccessLogRing)) != 0) {
+    return NULL;
+  }
+  memset(ring, 0, sizeof(OCFWebServerAccessLogRing));
+  atomic_init(&ring->head, 0);
+  atomic_init(&ring->tail, 0);
+  atomic_init(&ring->abandoned, false);
+  @synchronized(self) {
+    if (_ringCount == _ringCapacity) {
+      _ringCapacity = MAX(2 * _ringCapacity, 16);
+      _rings = realloc(_rings, _ringCapacity * sizeof(OCFWebServerAccessLogRing*));
+    }
+    _rings[_ringCount++] = ring;
+  }
+  pthread_setspecific(_ringKey, ring);
+  return ring;
+}
+
+- (void)recordEntry:(const OCFWebServerAccessLogEntry*)entry {
+  OCFWebServerAccessLogRing* ring = pthread_getspecific(_ringKey);
+  if (ring == NULL) {
+    ring = [self _registerRing];
+  }
+  uint32_t head = (ring ? atomic_load_explicit(&ring->head, memory_order_relaxed) : 0);
+  uint32_t count = (ring ? head - atomic_load_explicit(&ring->tail, memory_order_acquire) : kRingCapacity);
+  if (count >= kRingCapacity) {
+    atomic_fetch_add_explicit(&_droppedEntries, 1, memory_order_relaxed);
+    return;
+  }
+  ring->entries[head & (kRingCapacity - 1)] = *entry;
+  atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+  if (count + 1 == kRingCapacity / 2) {  // Draining only lowers the count so every time it grows past half it goes through here
+    dispatch_source_merge_data(self.drainSource, 1);
+  }
+}
+
+- (void)flush {
+  dispatch_sync(self.queue, ^{
+    [self _drain];
+  });
+}
+
+#pragma mark - Writing (writer queue only)
+- (void)_writeBytes:(const char*)bytes length:(size_t)length {
+  while (length > 0) {
+    ssize_t result = write(self.file, bytes, length);
+    if (result < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      LOG_ERROR(@"Failed writing access log (%i): %s", errno, strerror(errno));
+      return;
+    }
+    bytes += result;
+    length -= result;
+    self.fileSize = self.fileSize + result;
+  }
+}
+
+// Renames "path.<n>" to "path.<n + 1>" from the oldest down, dropping the last one, then starts a new file
+- (void)_rotate {
+  close(self.file);
+  NSString* path = self.path;
+  for (NSUInteger i = self.maximumFileCount - 1; i > 0; --i) {
+    NSString* source = (i > 1 ? [NSString stringWithFormat:@"%@.%lu", path, (unsigned long)(i - 1)] : path);
+    NSString* destination = [NSString stringWithFormat:@"%@.%lu", path, (unsigned long)i];
+    rename([source fileSystemRepresentation], [destination fileSystemRepresentation]);  // Older files may not exist yet
+  }
+  int flags = O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC | (self.maximumFileCount > 1 ? 0 : O_TRUNC);
+  self.file = open([path fileSystemRepresentation], flags, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+  if (self.file < 0) {
+    LOG_ERROR(@"Failed reopening access log \"%@\" (%i): %s", path, errno, strerror(errno));
+    self.file = open("/dev/null", O_WRONLY | O_CLOEXEC);
+  }
+  self.fileSize = 0;
+}
+
+// Only the list of rings is read under the lock so a thread registering its ring never waits on a slow write
+- (void)_drain {
+  NSUInteger ringCount;
+  @synchronized(self) {
+    ringCount = _ringCount;
+    if (ringCount > _drainRingCapacity) {
+      _drainRingCapacity = _ringCapacity;
+      _drainRings = realloc(_drainRings, _drainRingCapacity * sizeof(OCFWebServerAccessLogRing*));
+    }
+    if (ringCount) {
+      memcpy(_drainRings, _rings, ringCount * sizeof(OCFWebServerAccessLogRing*));
+    }
+  }
+  char* position = _buffer;
+  NSUInteger abandonedCount = 0;
+  for (NSUInteger i = 0; i < ringCount; ++i) {
+    OCFWebServerAccessLogRing* ring = _drainRings[i];
+    BOOL abandoned = atomic_load_explicit(&ring->abandoned, memory_order_acquire);  // Before reading head so nothing can follow
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    for (; tail != head; ++tail) {
+      if (position - _buffer > kWriteBufferSize - kMaximumLineSize) {
+        [self _writeBytes:_buffer length:(position - _buffer)];
+        position = _buffer;
+      }
+      position = _AppendFormattedEntry(position, &ring->entries[tail & (kRingCapacity - 1)]);
+      atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+    }
+    if (abandoned) {
+      _drainRings[abandonedCount++] = ring;  // Reuses the slots already drained: freed once removed from the list
+    }
+  }
+  if (abandonedCount) {
+    @synchronized(self) {
+      for (NSUInteger i = 0; i < abandonedCount; ++i) {
+        for (NSUInteger j = 0; j < _ringCount; ++j) {
+          if (_rings[j] == _drainRings[i]) {
+            _rings[j] = _rings[--_ringCount];
+            break;
+          }
+        }
+      }
+    }
+    for (NSUInteger i = 0; i < abandonedCount; ++i) {
+      free(_drainRings[i]);
+    }
+  }
+  uint64_t droppedEntries = atomic_load_explicit(&_droppedEntries, memory_order_relaxed);
+  if (droppedEntries > self.reportedDroppedEntries) {
+    position += sprintf(position, "dropped=%llu\n", (unsigned long long)(droppedEntries - self.reportedDroppedEntries));
+    self.reportedDroppedEntries = droppedEntries;
+  }
+  if (position > _buffer) {
+    [self _writeBytes:_buffer length:(position - _buffer)];
+  }
+  if (self.path && (self.maximumFileSize > 0) && (self.fileSize >= self.maximumFileSize)) {
+    [self _rotate];
+  }
+}
+
+@end
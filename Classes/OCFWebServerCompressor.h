@@ -0,0 +1,77 @@
+/*
+ This file belongs to the OCFWebServer project. OCFWebServer is a fork of GCDWebServer (originally developed by
+ Pierre-Olivier Latour). We have forked GCDWebServer because we made extensive and incompatible changes to it.
+ To find out more have a look at README.md.
+ 
+ Copyright (c) 2013, Christian Kienle / chris@objective-cloud.com
+ All rights reserved.
+ 
+ Original Copyright Statement:
+ Copyright (c) 2012-2013, Pierre-Olivier Latour
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ * Neither the name of the <organization> nor the
+ names of its contributors may be used to endorse or promote products
+ derived from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import <Foundation/Foundation.h>
+
+typedef NS_ENUM(NSInteger, OCFWebServerContentEncoding) {
+  OCFWebServerContentEncodingIdentity,
+  OCFWebServerContentEncodingGzip,
+  OCFWebServerContentEncodingDeflate
+};
+
+typedef NS_ENUM(NSInteger, OCFWebServerCompressorMode) {
+  OCFWebServerCompressorModeBuffer,  // Output may be held back until more input arrives
+  OCFWebServerCompressorModeFlush,  // Everything passed in so far is decodable by the client
+  OCFWebServerCompressorModeFinish  // Ends the compressed stream
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+OCFWebServerContentEncoding OCFWebServerPreferredContentEncoding(NSString* acceptEncoding);  // Parses an "Accept-Encoding" header
+NSString* OCFWebServerContentEncodingName(OCFWebServerContentEncoding encoding);
+BOOL OCFWebServerIsCompressibleContentType(NSString* contentType);  // Text and structured text types (compressing images, video or archives again is a waste)
+
+#ifdef __cplusplus
+}
+#endif
+
+// zlib deflate stream producing the body of a response. Compressors are expensive to set up (deflateInit2() allocates
+// ~256 KB) so they are taken from and returned to a process wide pool instead of being created per response.
+@interface OCFWebServerCompressor : NSObject
+
+#pragma mark - Properties
+@property(nonatomic, readonly) OCFWebServerContentEncoding encoding;
+@property(nonatomic, readonly) NSInteger level;
+
+#pragma mark - Creating
++ (instancetype)compressorWithEncoding:(OCFWebServerContentEncoding)encoding level:(NSInteger)level;  // Reuses a pooled compressor if available
+
+#pragma mark - Compressing
+- (dispatch_data_t)compressBytes:(const void*)bytes length:(NSUInteger)length mode:(OCFWebServerCompressorMode)mode;  // Returns NULL on error (output may be empty)
+- (void)recycle;  // Resets the compressor and returns it to the pool - it must not be used afterwards
+
+@end
@@ -0,0 +1,215 @@
+/*
+ This file belongs to the OCFWebServer project. OCFWebServer is a fork of GCDWebServer (originally developed by
+ Pierre-Olivier Latour). We have forked GCDWebServer because we made extensive and incompatible changes to it.
+ To find out more have a look at README.md.
+ 
+ Copyright (c) 2013, Christian Kienle / chris@objective-cloud.com
+ All rights reserved.
+ 
+ Original Copyright Statement:
+ Copyright (c) 2012-2013, Pierre-Olivier Latour
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ * Neither the name of the <organization> nor the
+ names of its contributors may be used to endorse or promote products
+ derived from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import <zlib.h>
+
+#import "OCFWebServerPrivate.h"
+#import "OCFWebServerCompressor.h"
+
+#define kMaxPooledCompressors 16  // Per encoding and level
+#define kMinOutputBufferSize 1024
+
+static NSMutableDictionary* _pools = nil;
+
+OCFWebServerContentEncoding OCFWebServerPreferredContentEncoding(NSString* acceptEncoding) {
+  float gzipQuality = 0.0;
+  float deflateQuality = 0.0;
+  float wildcardQuality = -1.0;
+  NSCharacterSet* whitespace = [NSCharacterSet whitespaceCharacterSet];
+  for (NSString* component in [acceptEncoding componentsSeparatedByString:@","]) {
+    NSArray* parameters = [component componentsSeparatedByString:@";"];
+    NSString* coding = [[parameters[0] stringByTrimmingCharactersInSet:whitespace] lowercaseString];
+    float quality = 1.0;
+    for (NSUInteger i = 1; i < parameters.count; ++i) {
+      NSString* parameter = [parameters[i] stringByTrimmingCharactersInSet:whitespace];
+      if ([parameter hasPrefix:@"q="]) {
+        quality = [[parameter substringFromIndex:2] floatValue];
+      }
+    }
+    if ([coding isEqualToString:@"gzip"] || [coding isEqualToString:@"x-gzip"]) {
+      gzipQuality = quality;
+    } else if ([coding isEqualToString:@"deflate"]) {
+      deflateQuality = quality;
+    } else if ([coding isEqualToString:@"*"]) {
+      wildcardQuality = quality;
+    }
+  }
+  if (wildcardQuality >= 0.0) {
+    if ([acceptEncoding rangeOfString:@"gzip" options:NSCaseInsensitiveSearch].location == NSNotFound) {
+      gzipQuality = wildcardQuality;
+    }
+  }
+  if ((gzipQuality > 0.0) && (gzipQuality >= deflateQuality)) {
+    return OCFWebServerContentEncodingGzip;
+  }
+  if (deflateQuality > 0.0) {
+    return OCFWebServerContentEncodingDeflate;
+  }
+  return OCFWebServerContentEncodingIdentity;
+}
+
+NSString* OCFWebServerContentEncodingName(OCFWebServerContentEncoding encoding) {
+  switch (encoding) {
+    case OCFWebServerContentEncodingGzip: return @"gzip";
+    case OCFWebServerContentEncodingDeflate: return @"deflate";
+    default: return @"identity";
+  }
+}
+
+BOOL OCFWebServerIsCompressibleContentType(NSString* contentType) {
+  NSString* mimeType = [[[contentType componentsSeparatedByString:@";"] firstObject] lowercaseString];
+  if ([mimeType hasPrefix:@"text/"] || [mimeType hasSuffix:@"+json"] || [mimeType hasSuffix:@"+xml"]) {
+    return YES;
+  }
+  static NSSet* _types = nil;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    _types = [[NSSet alloc] initWithObjects:@"application/json", @"application/javascript", @"application/x-javascript", @"application/xml",
+              @"application/ecmascript", @"application/x-font-ttf", @"application/vnd.ms-fontobject", @"font/otf", @"image/x-icon", nil];
+  });
+  return [_types containsObject:mimeType];
+}
+
+@interface OCFWebServerCompressor ()
+
+#pragma mark - Properties
+@property(nonatomic, readwrite) OCFWebServerContentEncoding encoding;
+@property(nonatomic, readwrite) NSInteger level;
+
+@end
+
+@implementation OCFWebServerCompressor {
+  z_stream _stream;
+  BOOL _initialized;
+}
+
++ (void)initialize {
+  if (_pools == nil) {
+    _pools = [[NSMutableDictionary alloc] init];
+  }
+}
+
+static NSNumber* _PoolKey(OCFWebServerContentEncoding encoding, NSInteger level) {
+  return @(encoding * 16 + level);
+}
+
+#pragma mark - Creating
++ (instancetype)compressorWithEncoding:(OCFWebServerContentEncoding)encoding level:(NSInteger)level {
+  DCHECK(encoding != OCFWebServerContentEncodingIdentity);
+  level = MAX(MIN(level, Z_BEST_COMPRESSION), Z_BEST_SPEED);
+  OCFWebServerCompressor* compressor = nil;
+  @synchronized(_pools) {
+    NSMutableArray* pool = _pools[_PoolKey(encoding, level)];
+    compressor = [pool lastObject];
+    if (compressor) {
+      [pool removeLastObject];
+    }
+  }
+  if (compressor == nil) {
+    compressor = [[self alloc] initWithEncoding:encoding level:level];
+  }
+  return compressor;
+}
+
+- (instancetype)initWithEncoding:(OCFWebServerContentEncoding)encoding level:(NSInteger)level {
+  if((self = [super init])) {
+    self.encoding = encoding;
+    self.level = level;
+    int windowBits = (encoding == OCFWebServerContentEncodingGzip ? MAX_WBITS + 16 : MAX_WBITS);  // +16 writes a gzip wrapper instead of a zlib one
+    memset(&_stream, 0, sizeof(_stream));
+    if (deflateInit2(&_stream, (int)level, Z_DEFLATED, windowBits, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+      DNOT_REACHED();
+      return nil;
+    }
+    _initialized = YES;
+  }
+  return self;
+}
+
+#pragma mark - Compressing
+- (dispatch_data_t)compressBytes:(const void*)bytes length:(NSUInteger)length mode:(OCFWebServerCompressorMode)mode {
+  DCHECK(_initialized);
+  int flush = (mode == OCFWebServerCompressorModeFinish ? Z_FINISH : (mode == OCFWebServerCompressorModeFlush ? Z_SYNC_FLUSH : Z_NO_FLUSH));
+  _stream.next_in = (Bytef*)bytes;
+  _stream.avail_in = (uInt)length;
+  size_t capacity = MAX(deflateBound(&_stream, length), kMinOutputBufferSize);
+  dispatch_data_t output = dispatch_data_empty;
+  do {
+    char* buffer = malloc(capacity);
+    _stream.next_out = (Bytef*)buffer;
+    _stream.avail_out = (uInt)capacity;
+    int result = deflate(&_stream, flush);
+    if ((result != Z_OK) && (result != Z_STREAM_END) && (result != Z_BUF_ERROR)) {
+      LOG_ERROR(@"Failed compressing response body (error %i)", result);
+      free(buffer);
+      return NULL;
+    }
+    size_t size = capacity - _stream.avail_out;
+    if (size) {
+      output = dispatch_data_create_concat(output, dispatch_data_create(buffer, size, kOCFWebServerGCDQueue, DISPATCH_DATA_DESTRUCTOR_FREE));
+    } else {
+      free(buffer);
+    }
+  } while (_stream.avail_out == 0);  // The output buffer was too small so there may be more
+  DCHECK(_stream.avail_in == 0);
+  return output;
+}
+
+- (void)recycle {
+  DCHECK(_initialized);
+  if (deflateReset(&_stream) != Z_OK) {
+    return;
+  }
+  @synchronized(_pools) {
+    NSNumber* key = _PoolKey(self.encoding, self.level);
+    NSMutableArray* pool = _pools[key];
+    if (pool == nil) {
+      pool = [[NSMutableArray alloc] init];
+      _pools[key] = pool;
+    }
+    if (pool.count < kMaxPooledCompressors) {
+      [pool addObject:self];
+    }
+  }
+}
+
+#pragma mark - NSObject
+- (void)dealloc {
+  if (_initialized) {
+    deflateEnd(&_stream);
+  }
+}
+
+@end
@@ -33,16 +33,49 @@
  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#import <netinet/in.h>
+#import <sys/socket.h>
+#if defined(__linux__)
+#import <sys/sendfile.h>
+#else
+#import <sys/uio.h>
+#endif
+
 #import "OCFWebServerPrivate.h"
+#import "OCFWebServerCompressor.h"
+#import "OCFWebServerFormDecoder.h"
+#import "OCFWebServerHeaderParser.h"
+#import "OCFWebServerHeaderWriter.h"
+#import "OCFWebServerMetrics.h"
 #import "OCFWebServerRequest.h"
 #import "OCFWebServerResponse.h"
+#import "OCFWebServerWorkerPool.h"
 
-#define kHeadersReadBuffer 1024
 #define kBodyWriteBufferSize (32 * 1024)
+#define kFileReadBufferSize (256 * 1024)  // Slices of a file body when sendfile() is not available
+#define kChunkLineMaxLength 1024
+#define kBodyReadRateGracePeriod 10.0  // Seconds before minimumBodyReadRate is enforced
+
+// What the connection is waiting for, which decides the timeout armed on the timer wheel
+typedef NS_ENUM(NSUInteger, OCFWebServerConnectionPhase) {
+  OCFWebServerConnectionPhaseIdle,  // First byte of the next request on a persistent connection (keepAliveTimeout)
+  OCFWebServerConnectionPhaseReadingHeaders,  // Request line and headers (headerReadTimeout, not extended by later reads)
+  OCFWebServerConnectionPhaseReadingBody,  // Next piece of the request body (bodyReadTimeout)
+  OCFWebServerConnectionPhaseProcessing,  // Handler - no timeout
+  OCFWebServerConnectionPhaseWriting  // Client accepting more of the response (writeTimeout)
+};
+
+typedef NS_ENUM(NSUInteger, OCFWebServerChunkState) {
+  OCFWebServerChunkStateSize,
+  OCFWebServerChunkStateData,
+  OCFWebServerChunkStateDataEnd,
+  OCFWebServerChunkStateTrailer,
+  OCFWebServerChunkStateDone
+};
 
 typedef void (^ReadBufferCompletionBlock)(dispatch_data_t buffer);
 typedef void (^ReadDataCompletionBlock)(NSData* data);
-typedef void (^ReadHeadersCompletionBlock)(NSData* extraData);
+typedef void (^ReadHeadersCompletionBlock)(OCFWebServerHeaderParserResult result, dispatch_data_t extraData);
 typedef void (^ReadBodyCompletionBlock)(BOOL success);
 
 typedef void (^WriteBufferCompletionBlock)(BOOL success);
@@ -50,12 +83,48 @@ typedef void (^WriteDataCompletionBlock)(BOOL success);
 typedef void (^WriteHeadersCompletionBlock)(BOOL success);
 typedef void (^WriteBodyCompletionBlock)(BOOL success);
 
-static NSData* _separatorData = nil;
 static NSData* _continueData = nil;
-static NSDateFormatter* _dateFormatter = nil;
-static dispatch_queue_t _formatterQueue = NULL;
+static NSData* _keepAliveHeaderData = nil;
+static NSData* _closeHeaderData = nil;
+static NSData* _noCacheHeaderData = nil;
+static NSData* _chunkedHeaderData = nil;
+static NSData* _varyHeaderData = nil;
+static dispatch_data_t _chunkTerminatorData = NULL;
+static dispatch_data_t _lastChunkData = NULL;
+
+// Returns 0 on success and -1 on error (check errno). The number of bytes sent is returned in both cases.
+static int _SendFile(int file, int socket, off_t offset, off_t length, off_t* sent) {
+#if defined(__linux__)
+  off_t position = offset;
+  ssize_t result = sendfile(socket, file, &position, (size_t)MIN(length, (off_t)0x7FFFF000));
+  *sent = (result > 0 ? result : 0);
+  return (result < 0 ? -1 : 0);
+#else
+  off_t size = length;
+  int result = sendfile(file, socket, offset, &size, NULL, 0);
+  *sent = size;
+  return result;
+#endif
+}
 
-@interface OCFWebServerConnection ()
+// Truncates to fit and writes "-" for nil
+static void _CopyCString(char* destination, size_t size, NSString* string) {
+  const char* source = (string ? [string UTF8String] : "-");
+  size_t length = MIN(strlen(source), size - 1);
+  memcpy(destination, source, length);
+  destination[length] = 0;
+}
+
+// Microseconds between two OCFWebServerMetricsNow() values (0 if either phase was not reached)
+static inline uint32_t _ElapsedTime(uint64_t start, uint64_t end) {
+  return ((start && (end > start)) ? (uint32_t)MIN(end - start, UINT32_MAX) : 0);
+}
+
+static void _AppendHeaderData(OCFWebServerHeaderWriter* writer, NSData* data) {
+  [writer appendBytes:data.bytes length:data.length];
+}
+
+@interface OCFWebServerConnection () <OCFWebServerTimerWheelTarget>
 
 #pragma mark - Properties
 @property (nonatomic, weak, readwrite) OCFWebServer* server;
@@ -63,19 +132,49 @@ static dispatch_queue_t _formatterQueue = NULL;
 @property (nonatomic, readwrite) NSUInteger totalBytesRead;
 @property (nonatomic, readwrite) NSUInteger totalBytesWritten;
 @property (nonatomic, assign) CFSocketNativeHandle socket;
-@property (nonatomic, assign) CFHTTPMessageRef requestMessage;
+@property (nonatomic, strong) dispatch_queue_t queue;  // Serial queue all the I/O and parsing of the connection runs on
+@property (nonatomic, strong) OCFWebServerHeaderParser *headerParser;
 @property (nonatomic, strong) OCFWebServerRequest *request;
 @property (nonatomic, strong) OCFWebServerHandler *handler;
-@property (nonatomic, assign) CFHTTPMessageRef responseMessage;
+@property (nonatomic, strong) OCFWebServerHeaderWriter *headerWriter;
 @property (nonatomic, strong) OCFWebServerResponse *response;
 @property (nonatomic, copy) OCFWebServerConnectionCompletionHandler completionHandler;
+@property (nonatomic, strong) dispatch_data_t pendingData;  // Bytes received after the current request (pipelining)
+@property (nonatomic, assign) NSUInteger requestCount;
+@property (nonatomic, assign) BOOL keepAlive;
+@property (nonatomic, assign) OCFWebServerConnectionPhase phase;
+@property (nonatomic, assign) uint64_t timeoutDeadline;  // Of the timeout armed for the phase (0 if none)
+@property (nonatomic, assign) BOOL timedOut;
+@property (nonatomic, assign) CFAbsoluteTime bodyReadStartTime;
+@property (nonatomic, assign) NSUInteger bodyBytesRead;
+@property (nonatomic, assign) uint64_t requestStartTime;  // OCFWebServerMetricsNow() at the first byte of the request
+@property (nonatomic, assign) uint64_t headersEndTime;
+@property (nonatomic, assign) uint64_t handlerSubmitTime;
+@property (nonatomic, assign) uint64_t handlerStartTime;
+@property (nonatomic, assign) uint64_t responseTime;  // Handler responded
+@property (nonatomic, assign) uint64_t firstByteTime;
+@property (nonatomic, assign) NSUInteger recordedBytesRead;  // Totals already attributed to previous requests
+@property (nonatomic, assign) NSUInteger recordedBytesWritten;
+@property (nonatomic, assign) BOOL chunkedResponse;
+@property (nonatomic, assign) BOOL sendsBody;  // NO for HEAD requests and statuses without a body even if the response has one
+@property (nonatomic, strong) OCFWebServerCompressor *compressor;  // Only set while compressing the response body
+@property (nonatomic, assign) OCFWebServerChunkState chunkState;
+@property (nonatomic, assign) NSUInteger chunkRemainingLength;
+@property (nonatomic, strong) NSMutableData *chunkLine;
+@property (nonatomic, assign) BOOL streamingBody;  // Body handed to an OCFWebServerStreamingRequest as the handler asks for it
+@property (nonatomic, assign) BOOL bodyComplete;
+@property (nonatomic, assign) BOOL continuePending;  // "100 Continue" is only sent once the handler reads the body
+@property (nonatomic, assign) BOOL readingBody;  // Handler waiting for a read of the streamed body
+@property (nonatomic, assign) NSUInteger bodyRemainingLength;
+@property (nonatomic, assign) CFAbsoluteTime bodyPauseStartTime;
+@property (nonatomic, strong) OCFWebServerResponse *deferredResponse;  // Sent once the pending read of the streamed body completes
 
 @end
 
 @implementation OCFWebServerConnection (Read)
 
 - (void)_readBufferWithLength:(NSUInteger)length completionBlock:(ReadBufferCompletionBlock)block {
-  dispatch_read(self.socket, length, kOCFWebServerGCDQueue, ^(dispatch_data_t buffer, int error) {
+  dispatch_read(self.socket, length, self.queue, ^(dispatch_data_t buffer, int error) {
     @autoreleasepool
 	  {
       if (error == 0) {
@@ -85,7 +184,11 @@ static dispatch_queue_t _formatterQueue = NULL;
           self.totalBytesRead = self.totalBytesRead + size;
           block(buffer);
         } else {
-          if (self.totalBytesRead > 0) {
+          if (self.timedOut) {
+            LOG_DEBUG(@"Connection timed out on socket %i", self.socket);
+          } else if (self.phase == OCFWebServerConnectionPhaseIdle) {
+            LOG_DEBUG(@"Connection closed by peer on socket %i", self.socket);
+          } else if (self.totalBytesRead > 0) {
             LOG_ERROR(@"No more data available on socket %i", self.socket);
           } else {
             LOG_WARNING(@"No data received from socket %i", self.socket);
@@ -115,43 +218,102 @@ static dispatch_queue_t _formatterQueue = NULL;
   }];
 }
 
+// Arms the timeout of the phase on the shared timer wheel, replacing the one of the previous phase
+- (void)_enterPhase:(OCFWebServerConnectionPhase)phase {
+  OCFWebServer* server = self.server;
+  NSTimeInterval timeout = 0.0;
+  switch (phase) {
+    case OCFWebServerConnectionPhaseIdle: timeout = server.keepAliveTimeout; break;
+    case OCFWebServerConnectionPhaseReadingHeaders: timeout = server.headerReadTimeout; break;
+    case OCFWebServerConnectionPhaseReadingBody: timeout = server.bodyReadTimeout; break;
+    case OCFWebServerConnectionPhaseProcessing: break;
+    case OCFWebServerConnectionPhaseWriting: timeout = server.writeTimeout; break;
+  }
+  self.phase = phase;
+  self.timeoutDeadline = [server.timerWheel setTimeout:timeout forTarget:self];
+}
+
+// Re-arms the body timeout and returns NO if the client sends the body too slowly
+- (BOOL)_didReadBodyLength:(NSUInteger)length {
+  [self _enterPhase:OCFWebServerConnectionPhaseReadingBody];
+  self.bodyBytesRead = self.bodyBytesRead + length;
+  NSUInteger minimumRate = self.server.minimumBodyReadRate;
+  CFTimeInterval elapsed = CFAbsoluteTimeGetCurrent() - self.bodyReadStartTime;
+  if ((minimumRate > 0) && (elapsed > kBodyReadRateGracePeriod) && (self.bodyBytesRead < minimumRate * elapsed)) {
+    LOG_ERROR(@"Request body received below %lu bytes per second on socket %i", (unsigned long)minimumRate, self.socket);
+    self.timedOut = YES;
+    return NO;
+  }
+  return YES;
+}
+
+- (void)_keepPendingData:(dispatch_data_t)data {
+  DCHECK(self.pendingData == nil);
+  self.pendingData = (data && dispatch_data_get_size(data) ? data : nil);
+}
+
+// Feeds the regions of the buffer to the parser in place and returns whatever follows the header without copying it
+- (void)_parseHeadersBuffer:(dispatch_data_t)buffer completionBlock:(ReadHeadersCompletionBlock)block {
+  if (self.phase == OCFWebServerConnectionPhaseIdle) {
+    [self _enterPhase:OCFWebServerConnectionPhaseReadingHeaders];  // The header deadline is not extended by later reads
+  }
+  if (!self.headerParser.hasReceivedData) {
+    self.requestStartTime = OCFWebServerMetricsNow();
+  }
+  __block OCFWebServerHeaderParserResult result = OCFWebServerHeaderParserResultIncomplete;
+  __block size_t extraOffset = 0;
+  dispatch_data_apply(buffer, ^bool(dispatch_data_t region, size_t offset, const void* bytes, size_t size) {
+    NSUInteger consumedLength = 0;
+    result = [self.headerParser parseBytes:bytes length:size consumedLength:&consumedLength];
+    extraOffset = offset + consumedLength;
+    return (result == OCFWebServerHeaderParserResultIncomplete);
+  });
+  switch (result) {
+    case OCFWebServerHeaderParserResultIncomplete:
+      [self _readHeadersWithCompletionBlock:block];
+      break;
+      
+    case OCFWebServerHeaderParserResultComplete:
+      self.headersEndTime = OCFWebServerMetricsNow();
+      [self.server.metrics.headerParseTime recordValue:(self.headersEndTime - self.requestStartTime)];
+      block(result, dispatch_data_create_subrange(buffer, extraOffset, dispatch_data_get_size(buffer) - extraOffset));
+      break;
+      
+    default:
+      LOG_ERROR(@"Failed parsing request headers from socket %i", self.socket);
+      block(result, NULL);
+      break;
+  }
+}
+
 - (void)_readHeadersWithCompletionBlock:(ReadHeadersCompletionBlock)block {
-  DCHECK(self.requestMessage);
+  DCHECK(self.headerParser);
+  dispatch_data_t pendingData = self.pendingData;
+  if (pendingData) {  // Pipelined request already (partially) received with the previous one
+    self.pendingData = nil;
+    [self _parseHeadersBuffer:pendingData completionBlock:block];
+    return;
+  }
   [self _readBufferWithLength:SIZE_T_MAX completionBlock:^(dispatch_data_t buffer) {
     if(buffer) {
-      NSMutableData* data = [NSMutableData dataWithCapacity:kHeadersReadBuffer];
-      dispatch_data_apply(buffer, ^bool(dispatch_data_t region, size_t offset, const void* buffer, size_t size) {
-        [data appendBytes:buffer length:size];
-        return true;
-      });
-      NSRange range = [data rangeOfData:_separatorData options:0 range:NSMakeRange(0, data.length)];
-      if (range.location == NSNotFound) {
-        if (CFHTTPMessageAppendBytes(self.requestMessage, data.bytes, data.length)) {
-          [self _readHeadersWithCompletionBlock:block];
-        } else {
-          LOG_ERROR(@"Failed appending request headers data from socket %i", self.socket);
-          block(nil);
-        }
-      } else {
-        NSUInteger length = range.location + range.length;
-        if (CFHTTPMessageAppendBytes(self.requestMessage, data.bytes, length)) {
-          if (CFHTTPMessageIsHeaderComplete(self.requestMessage)) {
-            block([data subdataWithRange:NSMakeRange(length, data.length - length)]);
-          } else {
-            LOG_ERROR(@"Failed parsing request headers from socket %i", self.socket);
-            block(nil);
-          }
-        } else {
-          LOG_ERROR(@"Failed appending request headers data from socket %i", self.socket);
-          block(nil);
-        }
-      }
+      [self _parseHeadersBuffer:buffer completionBlock:block];
     } else {
-      block(nil);
+      block(OCFWebServerHeaderParserResultIncomplete, NULL);
     }
   }];
 }
 
+- (BOOL)_writeRequestBodyBuffer:(dispatch_data_t)buffer {
+  return dispatch_data_apply(buffer, ^bool(dispatch_data_t region, size_t offset, const void* bytes, size_t size) {
+    NSInteger result = [self.request write:bytes maxLength:size];
+    if (result != size) {
+      LOG_ERROR(@"Failed writing request body on socket %i (error %i)", self.socket, (int)result);
+      return false;
+    }
+    return true;
+  });
+}
+
 - (void)_readBodyWithRemainingLength:(NSUInteger)length completionBlock:(ReadBodyCompletionBlock)block {
   DCHECK([self.request hasBody]);
   [self _readBufferWithLength:length completionBlock:^(dispatch_data_t buffer) {
@@ -159,15 +321,7 @@ static dispatch_queue_t _formatterQueue = NULL;
     if (buffer) {
       NSInteger remainingLength = length - dispatch_data_get_size(buffer);
       if (remainingLength >= 0) {
-        bool success = dispatch_data_apply(buffer, ^bool(dispatch_data_t region, size_t offset, const void* buffer, size_t size) {
-          NSInteger result = [self.request write:buffer maxLength:size];
-          if (result != size) {
-            LOG_ERROR(@"Failed writing request body on socket %i (error %i)", self.socket, (int)result);
-            return false;
-          }
-          return true;
-        });
-        if (success) {
+        if ([self _didReadBodyLength:dispatch_data_get_size(buffer)] && [self _writeRequestBodyBuffer:buffer]) {
           if (remainingLength > 0) {
             [self _readBodyWithRemainingLength:remainingLength completionBlock:block];
           } else {
@@ -187,18 +341,153 @@ static dispatch_queue_t _formatterQueue = NULL;
   }];
 }
 
+// http://tools.ietf.org/html/rfc2616#section-3.6.1
+// Returns the number of bytes consumed or -1 on error. Consumption stops once the last chunk and the trailer have been seen.
+- (NSInteger)_decodeChunkedBytes:(const char*)bytes length:(NSUInteger)length {
+  NSUInteger offset = 0;
+  while ((offset < length) && (self.chunkState != OCFWebServerChunkStateDone)) {
+    if (self.chunkState == OCFWebServerChunkStateData) {
+      NSUInteger size = MIN(self.chunkRemainingLength, length - offset);
+      NSInteger result = [self.request write:(bytes + offset) maxLength:size];
+      if (result != size) {
+        LOG_ERROR(@"Failed writing request body on socket %i (error %i)", self.socket, (int)result);
+        return -1;
+      }
+      offset += size;
+      self.chunkRemainingLength = self.chunkRemainingLength - size;
+      if (self.chunkRemainingLength == 0) {
+        self.chunkState = OCFWebServerChunkStateDataEnd;
+      }
+      continue;
+    }
+    
+    // All other states consume complete lines
+    const char* newline = memchr(bytes + offset, '\n', length - offset);
+    NSUInteger lineLength = (newline ? (newline - (bytes + offset) + 1) : (length - offset));
+    if (self.chunkLine.length + lineLength > kChunkLineMaxLength) {
+      LOG_ERROR(@"Chunk line too long on socket %i", self.socket);
+      return -1;
+    }
+    [self.chunkLine appendBytes:(bytes + offset) length:lineLength];
+    offset += lineLength;
+    if (newline == NULL) {
+      break;
+    }
+    NSUInteger contentLength = self.chunkLine.length - 1;
+    const char* line = self.chunkLine.bytes;
+    if ((contentLength > 0) && (line[contentLength - 1] == '\r')) {
+      contentLength -= 1;
+    }
+    switch (self.chunkState) {
+      case OCFWebServerChunkStateSize: {
+        NSUInteger size = 0;
+        NSUInteger digits = 0;
+        for (; digits < contentLength; ++digits) {
+          char c = line[digits];
+          NSUInteger value;
+          if ((c >= '0') && (c <= '9')) {
+            value = c - '0';
+          } else if ((c >= 'a') && (c <= 'f')) {
+            value = c - 'a' + 10;
+          } else if ((c >= 'A') && (c <= 'F')) {
+            value = c - 'A' + 10;
+          } else {
+            break;  // Chunk extensions are ignored
+          }
+          if (size > (NSUIntegerMax >> 4)) {
+            LOG_ERROR(@"Chunk size overflow on socket %i", self.socket);
+            return -1;
+          }
+          size = (size << 4) | value;
+        }
+        if (digits == 0) {
+          LOG_ERROR(@"Invalid chunk size on socket %i", self.socket);
+          return -1;
+        }
+        self.chunkRemainingLength = size;
+        self.chunkState = (size > 0 ? OCFWebServerChunkStateData : OCFWebServerChunkStateTrailer);
+        break;
+      }
+      
+      case OCFWebServerChunkStateDataEnd:
+        if (contentLength != 0) {
+          LOG_ERROR(@"Missing chunk terminator on socket %i", self.socket);
+          return -1;
+        }
+        self.chunkState = OCFWebServerChunkStateSize;
+        break;
+        
+      case OCFWebServerChunkStateTrailer:
+        if (contentLength == 0) {  // Trailer headers are ignored
+          self.chunkState = OCFWebServerChunkStateDone;
+        }
+        break;
+        
+      default:
+        DNOT_REACHED();
+        return -1;
+    }
+    self.chunkLine.length = 0;
+  }
+  return offset;
+}
+
+// Returns NO on error. Bytes following the last chunk are kept for the next request.
+- (BOOL)_decodeChunkedBuffer:(dispatch_data_t)buffer {
+  __block BOOL success = YES;
+  __block size_t extraOffset = 0;
+  dispatch_data_apply(buffer, ^bool(dispatch_data_t region, size_t offset, const void* bytes, size_t size) {
+    NSInteger result = [self _decodeChunkedBytes:bytes length:size];
+    if (result < 0) {
+      success = NO;
+      return false;
+    }
+    if (self.chunkState == OCFWebServerChunkStateDone) {
+      extraOffset = offset + result;
+      return false;
+    }
+    return true;
+  });
+  if (success && (self.chunkState == OCFWebServerChunkStateDone)) {
+    [self _keepPendingData:dispatch_data_create_subrange(buffer, extraOffset, dispatch_data_get_size(buffer) - extraOffset)];
+  }
+  return success;
+}
+
+- (void)_readChunkedBodyWithCompletionBlock:(ReadBodyCompletionBlock)block {
+  DCHECK([self.request hasBody]);
+  [self _readBufferWithLength:SIZE_T_MAX completionBlock:^(dispatch_data_t buffer) {
+    
+    if (buffer && [self _didReadBodyLength:dispatch_data_get_size(buffer)] && [self _decodeChunkedBuffer:buffer]) {
+      if (self.chunkState == OCFWebServerChunkStateDone) {
+        block(YES);
+      } else {
+        [self _readChunkedBodyWithCompletionBlock:block];
+      }
+    } else {
+      block(NO);
+    }
+    
+  }];
+}
+
 @end
 
 @implementation OCFWebServerConnection (Write)
 
 - (void)_writeBuffer:(dispatch_data_t)buffer withCompletionBlock:(WriteBufferCompletionBlock)block {
   size_t size = dispatch_data_get_size(buffer);
-  dispatch_write(self.socket, buffer, kOCFWebServerGCDQueue, ^(dispatch_data_t data, int error) {
+  [self _enterPhase:OCFWebServerConnectionPhaseWriting];  // Re-armed for each buffer the client accepts
+  dispatch_write(self.socket, buffer, self.queue, ^(dispatch_data_t data, int error) {
     @autoreleasepool {
       if (error == 0) {
         DCHECK(data == NULL);
         LOG_DEBUG(@"Connection sent %i bytes on socket %i", size, self.socket);
         self.totalBytesWritten = self.totalBytesWritten + size;
+        if (self.headerWriter && (self.firstByteTime == 0)) {  // Not for "100 Continue"
+          self.firstByteTime = OCFWebServerMetricsNow();
+          [self.server.metrics.timeToFirstByte recordValue:(self.firstByteTime - self.headersEndTime)];
+        }
         block(YES);
       } else {
         LOG_ERROR(@"Error while writing to socket %i: %s (%i)", self.socket, strerror(error), error);
@@ -224,35 +513,205 @@ static dispatch_queue_t _formatterQueue = NULL;
 }
 
 - (void)_writeHeadersWithCompletionBlock:(WriteHeadersCompletionBlock)block {
-  DCHECK(self.responseMessage);
-  CFDataRef message = CFHTTPMessageCopySerializedMessage(self.responseMessage);
-  NSData *data = (__bridge_transfer NSData *)message;
-  [self _writeData:data withCompletionBlock:block];
-}
-
-- (void)_writeBodyWithCompletionBlock:(WriteBodyCompletionBlock)block {
-  DCHECK([self.response hasBody]);
-  void *buffer = malloc(kBodyWriteBufferSize);
-  NSInteger result = [self.response read:buffer maxLength:kBodyWriteBufferSize];
-  if (result > 0) {
-    dispatch_data_t wrapper = dispatch_data_create(buffer, result, kOCFWebServerGCDQueue, ^(){
-      free(buffer);
+  DCHECK(self.headerWriter);
+  [self _writeBuffer:[self.headerWriter finish] withCompletionBlock:block];
+}
+
+// Reads the file one slice at a time with pread() rather than mapping it, which would raise SIGBUS if the file was
+// truncated while being sent
+- (void)_writeFile:(int)file offset:(off_t)offset length:(off_t)length withCompletionBlock:(WriteBodyCompletionBlock)block {
+  size_t size = (size_t)MIN(length, (off_t)kFileReadBufferSize);
+  char* buffer = malloc(size);
+  ssize_t result;
+  do {
+    result = pread(file, buffer, size, offset);
+  } while ((result < 0) && (errno == EINTR));
+  if (result <= 0) {
+    if (result == 0) {
+      LOG_ERROR(@"File was truncated while sending it to socket %i", self.socket);
+    } else {
+      LOG_ERROR(@"Error while reading file for socket %i: %s (%i)", self.socket, strerror(errno), errno);
+    }
+    free(buffer);
+    block(NO);
+    return;
+  }
+  dispatch_data_t data = dispatch_data_create(buffer, result, kOCFWebServerGCDQueue, ^{
+    free(buffer);
+  });
+  [self _writeBuffer:data withCompletionBlock:^(BOOL success) {
+    if (success && (result < length)) {
+      [self _writeFile:file offset:(offset + result) length:(length - result) withCompletionBlock:block];
+    } else {
+      block(success);
+    }
+  }];
+}
+
+// Sends the file straight from the kernel's buffer cache whenever the socket becomes writable
+- (void)_sendFile:(int)file offset:(off_t)offset length:(off_t)length withCompletionBlock:(WriteBodyCompletionBlock)block {
+  int socket = self.socket;
+  __block off_t position = offset;
+  __block off_t remainingLength = length;
+  __block NSInteger status = 0;  // 1: done, -1: error, 2: not supported for this file or socket
+  [self _enterPhase:OCFWebServerConnectionPhaseWriting];
+  dispatch_source_t source = dispatch_source_create(DISPATCH_SOURCE_TYPE_WRITE, socket, 0, self.queue);
+  dispatch_source_set_event_handler(source, ^{
+    @autoreleasepool {
+      while ((status == 0) && (remainingLength > 0)) {
+        off_t sent = 0;
+        int result = _SendFile(file, socket, position, remainingLength, &sent);
+        if (sent > 0) {
+          LOG_DEBUG(@"Connection sent %i bytes on socket %i", (int)sent, socket);
+          position += sent;
+          remainingLength -= sent;
+          self.totalBytesWritten = self.totalBytesWritten + sent;
+          [self _enterPhase:OCFWebServerConnectionPhaseWriting];
+        }
+        if (result != 0) {
+          if (errno == EINTR) {
+            continue;
+          }
+          if (errno == EAGAIN) {
+            return;  // Wait for the socket to become writable again
+          }
+          if ((position == offset) && ((errno == EINVAL) || (errno == ENOTSOCK) || (errno == EOPNOTSUPP) || (errno == ENOSYS))) {
+            status = 2;
+          } else {
+            LOG_ERROR(@"Error while sending file to socket %i: %s (%i)", socket, strerror(errno), errno);
+            status = -1;
+          }
+        } else if (sent == 0) {
+          LOG_ERROR(@"File was truncated while sending it to socket %i", socket);
+          status = -1;
+        }
+      }
+      if (status == 0) {
+        status = 1;
+      }
+      dispatch_source_cancel(source);
+    }
+  });
+  dispatch_source_set_cancel_handler(source, ^{
+    @autoreleasepool {
+      if (status == 2) {
+        [self _writeFile:file offset:offset length:length withCompletionBlock:block];
+      } else {
+        block(status == 1 ? YES : NO);
+      }
+    }
+  });
+  dispatch_resume(source);
+}
+
+// Sends the headers in the same write as the whole body of a data response or the first piece of any other body. File
+// bodies sent with sendfile() can only follow the headers.
+- (void)_writeHeadersAndBodyWithCompletionBlock:(WriteBodyCompletionBlock)block {
+  dispatch_data_t headers = [self.headerWriter finish];
+  if (!self.sendsBody) {
+    [self _writeBuffer:headers withCompletionBlock:block];
+    return;
+  }
+  NSData* data = nil;
+  int file;
+  off_t offset;
+  off_t length;
+  if (!self.chunkedResponse && !self.compressor && [self.response isKindOfClass:[OCFWebServerDataResponse class]] && (data = [(OCFWebServerDataResponse*)self.response _getZeroCopyData])) {
+    dispatch_data_t body = dispatch_data_create(data.bytes, data.length, kOCFWebServerGCDQueue, ^{
+      [data self];  // Keeps the payload alive until written instead of copying it
     });
-    [self _writeBuffer:wrapper withCompletionBlock:^(BOOL success) {
-      if (success) {
-        [self _writeBodyWithCompletionBlock:block];
+    [self _writeHeaders:headers bodyBuffer:body complete:YES withCompletionBlock:block];
+  } else if (!self.chunkedResponse && !self.compressor && [self.response isKindOfClass:[OCFWebServerFileResponse class]] && [(OCFWebServerFileResponse*)self.response _getZeroCopyFile:&file offset:&offset length:&length]) {
+    [self _writeBuffer:headers withCompletionBlock:^(BOOL success) {
+      if (success && (length > 0)) {
+        [self _sendFile:file offset:offset length:length withCompletionBlock:block];
       } else {
-        block(NO);
+        block(success);
       }
     }];
-  } else if (result < 0) {
-    LOG_ERROR(@"Failed reading response body on socket %i (error %i)", self.socket, (int)result);
-    block(NO);
-    free(buffer);
   } else {
+    BOOL complete = NO;
+    dispatch_data_t buffer = [self _readBodyBufferReturningComplete:&complete];
+    [self _writeHeaders:headers bodyBuffer:buffer complete:complete withCompletionBlock:block];
+  }
+}
+
+// Returns the next piece of the body (compressed and) framed for the transfer encoding or NULL on error. Sets complete
+// once nothing follows the returned piece (which may then be empty).
+- (dispatch_data_t)_readBodyBufferReturningComplete:(BOOL*)complete {
+  DCHECK(self.sendsBody);
+  OCFWebServerCompressor* compressor = self.compressor;
+  // Streamed bodies are flushed piece by piece so the client does not wait on data held back by the compressor
+  OCFWebServerCompressorMode mode = ([self.response usesChunkedTransferEncoding] ? OCFWebServerCompressorModeFlush : OCFWebServerCompressorModeBuffer);
+  dispatch_data_t body = NULL;
+  BOOL endOfBody = NO;
+  do {
+    void *buffer = malloc(kBodyWriteBufferSize);
+    NSInteger result = [self.response read:buffer maxLength:kBodyWriteBufferSize];
+    if (result < 0) {
+      LOG_ERROR(@"Failed reading response body on socket %i (error %i)", self.socket, (int)result);
+      free(buffer);
+      return NULL;
+    }
+    endOfBody = (result == 0);
+    if (compressor) {
+      body = [compressor compressBytes:buffer length:result mode:(endOfBody ? OCFWebServerCompressorModeFinish : mode)];
+      free(buffer);
+      if (body == NULL) {
+        return NULL;
+      }
+    } else if (result > 0) {
+      body = dispatch_data_create(buffer, result, kOCFWebServerGCDQueue, ^(){
+        free(buffer);
+      });
+    } else {
+      free(buffer);
+      body = dispatch_data_empty;
+    }
+  } while (!endOfBody && (dispatch_data_get_size(body) == 0));  // An empty chunk would terminate the body
+  
+  if (self.chunkedResponse) {
+    size_t size = dispatch_data_get_size(body);
+    if (size) {
+      char chunkHeader[32];
+      int length = snprintf(chunkHeader, sizeof(chunkHeader), "%lx\r\n", (unsigned long)size);
+      dispatch_data_t header = dispatch_data_create(chunkHeader, length, kOCFWebServerGCDQueue, DISPATCH_DATA_DESTRUCTOR_DEFAULT);
+      body = dispatch_data_create_concat(dispatch_data_create_concat(header, body), _chunkTerminatorData);
+    }
+    if (endOfBody) {
+      body = dispatch_data_create_concat(body, _lastChunkData);
+    }
+  }
+  *complete = endOfBody;
+  return body;
+}
+
+// Writes the body buffer (preceded by the headers if any) then keeps reading and writing until the body is complete
+- (void)_writeHeaders:(dispatch_data_t)headers bodyBuffer:(dispatch_data_t)buffer complete:(BOOL)complete withCompletionBlock:(WriteBodyCompletionBlock)block {
+  if (buffer == NULL) {
+    block(NO);
+    return;
+  }
+  if (headers) {
+    buffer = dispatch_data_create_concat(headers, buffer);
+  }
+  if (dispatch_data_get_size(buffer) == 0) {
     block(YES);
-    free(buffer);
+    return;
   }
+  [self _writeBuffer:buffer withCompletionBlock:^(BOOL success) {
+    if (success && !complete) {
+      [self _writeBodyBufferWithCompletionBlock:block];
+    } else {
+      block(success);
+    }
+  }];
+}
+
+- (void)_writeBodyBufferWithCompletionBlock:(WriteBodyCompletionBlock)block {
+  BOOL complete = NO;
+  dispatch_data_t buffer = [self _readBodyBufferReturningComplete:&complete];
+  [self _writeHeaders:NULL bodyBuffer:buffer complete:complete withCompletionBlock:block];
 }
 
 @end
@@ -260,116 +719,390 @@ static dispatch_queue_t _formatterQueue = NULL;
 @implementation OCFWebServerConnection
 
 + (void)initialize {
-  DCHECK([NSThread isMainThread]);  // NSDateFormatter should be initialized on main thread
-  if (_separatorData == nil) {
-    _separatorData = [[NSData alloc] initWithBytes:"\r\n\r\n" length:4];
-    DCHECK(_separatorData);
-  }
   if (_continueData == nil) {
-    CFHTTPMessageRef message = CFHTTPMessageCreateResponse(kCFAllocatorDefault, 100, NULL, kCFHTTPVersion1_1);
-    _continueData = (NSData*)CFBridgingRelease(CFHTTPMessageCopySerializedMessage(message));
-    CFRelease(message);
+    _continueData = [[NSData alloc] initWithBytes:"HTTP/1.1 100 Continue\r\n\r\n" length:25];
     DCHECK(_continueData);
   }
-  if (_dateFormatter == nil) {
-    _dateFormatter = [[NSDateFormatter alloc] init];
-    _dateFormatter.timeZone = [NSTimeZone timeZoneWithAbbreviation:@"GMT"];
-    _dateFormatter.dateFormat = @"EEE',' dd MMM yyyy HH':'mm':'ss 'GMT'";
-    _dateFormatter.locale = [[NSLocale alloc] initWithLocaleIdentifier:@"en_US"];
-    DCHECK(_dateFormatter);
+  if (_keepAliveHeaderData == nil) {
+    _keepAliveHeaderData = [[NSData alloc] initWithBytes:"Connection: keep-alive\r\n" length:24];
+    DCHECK(_keepAliveHeaderData);
+  }
+  if (_closeHeaderData == nil) {
+    _closeHeaderData = [[NSData alloc] initWithBytes:"Connection: Close\r\n" length:19];
+    DCHECK(_closeHeaderData);
+  }
+  if (_noCacheHeaderData == nil) {
+    _noCacheHeaderData = [[NSData alloc] initWithBytes:"Cache-Control: no-cache\r\n" length:25];
+    DCHECK(_noCacheHeaderData);
+  }
+  if (_varyHeaderData == nil) {
+    _varyHeaderData = [[NSData alloc] initWithBytes:"Vary: Accept-Encoding\r\n" length:23];
+    DCHECK(_varyHeaderData);
+  }
+  if (_chunkedHeaderData == nil) {
+    _chunkedHeaderData = [[NSData alloc] initWithBytes:"Transfer-Encoding: chunked\r\n" length:28];
+    DCHECK(_chunkedHeaderData);
   }
-  if (_formatterQueue == NULL) {
-    _formatterQueue = dispatch_queue_create(NULL, DISPATCH_QUEUE_SERIAL);
-    DCHECK(_formatterQueue);
+  if (_chunkTerminatorData == NULL) {
+    _chunkTerminatorData = dispatch_data_create("\r\n", 2, kOCFWebServerGCDQueue, DISPATCH_DATA_DESTRUCTOR_DEFAULT);
+    DCHECK(_chunkTerminatorData);
+  }
+  if (_lastChunkData == NULL) {
+    _lastChunkData = dispatch_data_create("0\r\n\r\n", 5, kOCFWebServerGCDQueue, DISPATCH_DATA_DESTRUCTOR_DEFAULT);
+    DCHECK(_lastChunkData);
   }
 }
 
-- (void)_initializeResponseHeadersWithStatusCode:(NSInteger)statusCode {
-  self.responseMessage = CFHTTPMessageCreateResponse(kCFAllocatorDefault, statusCode, NULL, kCFHTTPVersion1_1);
-  CFHTTPMessageSetHeaderFieldValue(self.responseMessage, CFSTR("Connection"), CFSTR("Close"));
-  CFHTTPMessageSetHeaderFieldValue(self.responseMessage, CFSTR("Server"), (__bridge CFStringRef)[[self.server class] serverName]);
-  dispatch_sync(_formatterQueue, ^{
-    NSString* date = [_dateFormatter stringFromDate:[NSDate date]];
-    CFStringRef cfDate = (CFStringRef)CFBridgingRetain(date);
-    CFHTTPMessageSetHeaderFieldValue(self.responseMessage, CFSTR("Date"), cfDate);
-    CFRelease(cfDate);
-  });
+// Headers the response overrides with its additional headers are left out
+- (void)_initializeResponseHeadersWithStatusCode:(NSInteger)statusCode additionalHeaders:(NSDictionary*)additionalHeaders {
+  OCFWebServerHeaderWriter* writer = [[OCFWebServerHeaderWriter alloc] initWithStatusCode:statusCode];
+  NSString* connectionHeader = additionalHeaders[@"Connection"];
+  if (connectionHeader == nil) {
+    _AppendHeaderData(writer, self.keepAlive ? _keepAliveHeaderData : _closeHeaderData);
+  } else if ([connectionHeader rangeOfString:@"close" options:NSCaseInsensitiveSearch].location != NSNotFound) {
+    self.keepAlive = NO;  // The client will not send another request
+  }
+  if (additionalHeaders[@"Server"] == nil) {
+    _AppendHeaderData(writer, self.server.serverHeaderData);
+  }
+  if (additionalHeaders[@"Date"] == nil) {
+    [writer appendDateHeader];
+  }
+  self.headerWriter = writer;
 }
 
 - (void)_abortWithStatusCode:(NSUInteger)statusCode {
-  DCHECK(self.responseMessage == NULL);
+  DCHECK(self.headerWriter == nil);
   DCHECK((statusCode >= 400) && (statusCode < 600));
-  [self _initializeResponseHeadersWithStatusCode:statusCode];
+  self.keepAlive = NO;  // The state of the stream is unknown after an error
+  [self _initializeResponseHeadersWithStatusCode:statusCode additionalHeaders:nil];
   [self _writeHeadersWithCompletionBlock:^(BOOL success) {
+    [self _recordRequestWithStatusCode:statusCode];
     [self close];
   }];
   LOG_DEBUG(@"Connection aborted with status code %i on socket %i", statusCode, self.socket);
 }
 
 // http://www.w3.org/Protocols/rfc2616/rfc2616-sec10.html
-// This method is already called on the dispatch queue of the web server so there is no need to dispatch again.
-- (void)_processRequest {
-  DCHECK(self.responseMessage == NULL);
-  @try {
-    __typeof__(self) __weak weakSelf = self;
-    self.request.responseBlock = ^(OCFWebServerResponse *response) {
-      if (![response hasBody] || [response open]) {
-        weakSelf.response = response;
+// Called on the connection queue whichever thread the handler responds on.
+- (void)_sendResponse:(OCFWebServerResponse*)response {
+  if (self.response || self.headerWriter || self.deferredResponse) {
+    LOG_ERROR(@"Handler responded more than once on socket %i", self.socket);
+    return;
+  }
+  if (self.responseTime == 0) {  // Not again for a deferred response
+    self.responseTime = OCFWebServerMetricsNow();
+    [self.handler.routeMetrics.handlerTime recordValue:(self.responseTime - self.handlerStartTime)];
+  }
+  if (self.readingBody) {
+    self.deferredResponse = response;
+    return;
+  }
+  if (self.streamingBody && !self.bodyComplete) {
+    self.keepAlive = NO;  // The rest of the body is left unread
+  }
+  // The headers of a HEAD response describe the body a GET would return but the body itself is never sent, and neither
+  // is the body of a status that cannot have one
+  NSInteger statusCode = response.statusCode;
+  BOOL bodylessStatus = ((statusCode < 200) || (statusCode == 204) || (statusCode == 304));
+  BOOL describesBody = ([response hasBody] && !bodylessStatus);
+  self.sendsBody = (describesBody && ![self.headerParser.method isEqualToString:@"HEAD"]);
+  if (!self.sendsBody || [response open]) {
+    self.response = response;
+  }
+  if (self.response) {
+    BOOL compressible = NO;
+    if (self.sendsBody) {
+      compressible = [self _isCompressibleResponse];
+      self.compressor = (compressible ? [self _compressorForResponse] : nil);
+    }
+    BOOL unknownLength = ([self.response usesChunkedTransferEncoding] || self.compressor);
+    if (self.sendsBody && unknownLength) {
+      // HTTP/1.0 clients do not understand chunked transfer encoding: the end of the body is signaled by closing the connection instead
+      self.chunkedResponse = [self _requestIsHTTP11];
+      if (!self.chunkedResponse) {
+        self.keepAlive = NO;
+      }
+    }
+    NSDictionary* additionalHeaders = self.response.additionalHeaders;
+    [self _initializeResponseHeadersWithStatusCode:self.response.statusCode additionalHeaders:additionalHeaders];
+    OCFWebServerHeaderWriter* writer = self.headerWriter;
+    if (additionalHeaders[@"Cache-Control"] == nil) {
+      NSUInteger maxAge = self.response.cacheControlMaxAge;
+      if (maxAge > 0) {
+        [writer appendBytes:"Cache-Control: max-age=" length:23];
+        [writer appendUnsignedValue:maxAge];
+        [writer appendBytes:", public\r\n" length:10];
+      } else {
+        _AppendHeaderData(writer, _noCacheHeaderData);
+      }
+    }
+    [additionalHeaders enumerateKeysAndObjectsUsingBlock:^(NSString *key, NSString *obj, BOOL* stop) {
+      if ([key isEqualToString:@"Content-Length"] || [key isEqualToString:@"Transfer-Encoding"] || (describesBody && [key isEqualToString:@"Content-Type"])) {
+        return;  // Describe the body actually sent (if any)
+      }
+      if (self.compressor && [key isEqualToString:@"ETag"] && ![obj hasPrefix:@"W/"]) {
+        // A strong tag promises identical bytes but those depend on the compressor: If-None-Match still matches a weak tag
+        obj = [@"W/" stringByAppendingString:obj];
+      }
+      [writer appendHeader:key value:obj];
+    }];
+    
+    if (describesBody) {
+      [writer appendHeader:@"Content-Type" value:self.response.contentType];
+      if (compressible && (additionalHeaders[@"Vary"] == nil)) {  // Caches must not hand the compressed body to other clients
+        _AppendHeaderData(writer, _varyHeaderData);
+      }
+      if (self.compressor) {
+        [writer appendHeader:@"Content-Encoding" value:OCFWebServerContentEncodingName(self.compressor.encoding)];
       }
-      if (weakSelf.response) {
-        [weakSelf _initializeResponseHeadersWithStatusCode:weakSelf.response.statusCode];
-        NSUInteger maxAge = weakSelf.response.cacheControlMaxAge;
-        if (maxAge > 0) {
-          CFHTTPMessageSetHeaderFieldValue(weakSelf.responseMessage, CFSTR("Cache-Control"), (__bridge CFStringRef)[NSString stringWithFormat:@"max-age=%i, public", (int)maxAge]);
+      if (self.chunkedResponse) {
+        _AppendHeaderData(writer, _chunkedHeaderData);
+      } else if (!unknownLength) {
+        [writer appendHeader:"Content-Length" unsignedValue:self.response.contentLength];
+      }
+    } else if (!bodylessStatus) {
+      [writer appendHeader:"Content-Length" unsignedValue:0];  // Otherwise the client would read until the connection closes
+    }
+    [self _writeHeadersAndBodyWithCompletionBlock:^(BOOL success) {
+      if (self.sendsBody) {  // Only opened then
+        [self.response close];  // Can't do anything with result anyway
+      }
+      [self _finishRequestWithSuccess:success];
+    }];
+  } else {
+    [self _abortWithStatusCode:500];
+  }
+}
+
+// Returns NO if the buffer is not a valid continuation of the body
+- (BOOL)_receiveStreamedBodyBuffer:(dispatch_data_t)buffer {
+  size_t size = dispatch_data_get_size(buffer);
+  if (![self _didReadBodyLength:size]) {
+    return NO;
+  }
+  if (self.request.usesChunkedTransferEncoding) {
+    if (![self _decodeChunkedBuffer:buffer]) {
+      return NO;
+    }
+    self.bodyComplete = (self.chunkState == OCFWebServerChunkStateDone);
+  } else {
+    DCHECK(size <= self.bodyRemainingLength);
+    if (![self _writeRequestBodyBuffer:buffer]) {
+      return NO;
+    }
+    self.bodyRemainingLength = self.bodyRemainingLength - size;
+    self.bodyComplete = (self.bodyRemainingLength == 0);
+  }
+  if (self.bodyComplete) {
+    self.chunkLine = nil;
+    return [self.request close];
+  }
+  return YES;
+}
+
+// Time the handler spends on a piece of the body does not count against the client's minimum body rate
+- (void)_pauseStreamedBody {
+  [self _enterPhase:OCFWebServerConnectionPhaseProcessing];
+  self.bodyPauseStartTime = CFAbsoluteTimeGetCurrent();
+}
+
+- (void)_failStreamedBodyWithBlock:(OCFWebServerBodyReadBlock)block {
+  self.streamingBody = NO;
+  self.deferredResponse = nil;
+  self.request.responseBlock = nil;  // Too late for the handler to respond
+  block(nil);
+  [self _abortWithStatusCode:(self.timedOut ? 408 : 400)];
+}
+
+- (void)_completeStreamedReadWithSuccess:(BOOL)success block:(OCFWebServerBodyReadBlock)block {
+  self.readingBody = NO;
+  if (!success) {
+    [self _failStreamedBodyWithBlock:block];
+    return;
+  }
+  OCFWebServerResponse* response = self.deferredResponse;
+  if (response) {  // The handler responded in the meantime and does not need the rest of the body
+    self.deferredResponse = nil;
+    block(nil);
+    [self _sendResponse:response];
+    return;
+  }
+  [self _readStreamedBodyWithBlock:block];  // Reads again if the buffer only held chunk framing
+}
+
+// Nothing is read from the socket until the handler asks for more, which pushes back on the client through TCP flow control
+- (void)_readStreamedBodyWithBlock:(OCFWebServerBodyReadBlock)block {
+  if (!self.streamingBody || self.headerWriter) {
+    block(nil);
+    return;
+  }
+  if (self.readingBody) {
+    LOG_ERROR(@"Handler is already reading the request body on socket %i", self.socket);
+    block(nil);
+    return;
+  }
+  NSData* data = [(OCFWebServerStreamingRequest*)self.request _takeReceivedData];
+  if (data.length || self.bodyComplete) {
+    [self _pauseStreamedBody];
+    block(data);
+    return;
+  }
+  
+  self.readingBody = YES;
+  if (self.continuePending) {
+    self.continuePending = NO;
+    [self _writeData:_continueData withCompletionBlock:^(BOOL success) {
+      [self _completeStreamedReadWithSuccess:success block:block];
+    }];
+    return;
+  }
+  self.bodyReadStartTime = self.bodyReadStartTime + (CFAbsoluteTimeGetCurrent() - self.bodyPauseStartTime);
+  [self _enterPhase:OCFWebServerConnectionPhaseReadingBody];
+  NSUInteger length = (self.request.usesChunkedTransferEncoding ? SIZE_T_MAX : self.bodyRemainingLength);
+  [self _readBufferWithLength:length completionBlock:^(dispatch_data_t buffer) {
+    [self _completeStreamedReadWithSuccess:(buffer && [self _receiveStreamedBodyBuffer:buffer]) block:block];
+  }];
+}
+
+// Runs the handler right away and lets it pull the body through -readBodyWithCompletionBlock:
+- (void)_streamRequestBody:(dispatch_data_t)initialData {
+  OCFWebServerStreamingRequest* request = (OCFWebServerStreamingRequest*)self.request;
+  if (![request open]) {
+    [self _abortWithStatusCode:500];
+    return;
+  }
+  self.streamingBody = YES;
+  if ([request hasBody]) {
+    [self _beginRequestBody];
+    self.bodyComplete = NO;
+    self.bodyRemainingLength = request.contentLength;
+    if (request.usesChunkedTransferEncoding) {
+      self.chunkState = OCFWebServerChunkStateSize;
+      self.chunkRemainingLength = 0;
+      self.chunkLine = [[NSMutableData alloc] initWithCapacity:64];
+    }
+    if (![self _receiveStreamedBodyBuffer:(initialData ? initialData : dispatch_data_empty)]) {
+      [self _abortWithStatusCode:400];
+      return;
+    }
+  } else {
+    self.bodyComplete = [request close];
+  }
+  
+  __typeof__(self) __weak weakSelf = self;
+  __typeof__(request) __weak weakRequest = request;
+  [request _setBodyReader:^(OCFWebServerBodyReadBlock block) {
+    __typeof__(self) strongSelf = weakSelf;
+    if (strongSelf) {
+      dispatch_async(strongSelf.queue, ^{
+        if (strongSelf.request && (strongSelf.request == weakRequest)) {
+          [strongSelf _readStreamedBodyWithBlock:block];
         } else {
-          CFHTTPMessageSetHeaderFieldValue(weakSelf.responseMessage, CFSTR("Cache-Control"), CFSTR("no-cache"));
+          block(nil);  // Connection moved on to another request
         }
-        [weakSelf.response.additionalHeaders enumerateKeysAndObjectsUsingBlock:^(NSString *key, NSString *obj, BOOL* stop) {
-          CFHTTPMessageSetHeaderFieldValue(weakSelf.responseMessage, (__bridge CFStringRef)(key), (__bridge CFStringRef)(obj));
-        }];
-        
-        if ([weakSelf.response hasBody]) {
-          CFHTTPMessageSetHeaderFieldValue(weakSelf.responseMessage, CFSTR("Content-Type"), (__bridge CFStringRef)weakSelf.response.contentType);
-          CFHTTPMessageSetHeaderFieldValue(weakSelf.responseMessage, CFSTR("Content-Length"), (__bridge CFStringRef)[NSString stringWithFormat:@"%i", (int)weakSelf.response.contentLength]);
+      });
+    } else {
+      dispatch_async(kOCFWebServerGCDQueue, ^{
+        block(nil);
+      });
+    }
+  }];
+  [self _pauseStreamedBody];
+  [self _processRequest];
+}
+
+// The process block runs on the worker pool of the handler while the connection queue stays free for I/O
+- (void)_processRequest {
+  DCHECK(self.headerWriter == nil);
+  [self _enterPhase:OCFWebServerConnectionPhaseProcessing];
+  __typeof__(self) __weak weakSelf = self;
+  self.request.responseBlock = ^(OCFWebServerResponse *response) {
+    __typeof__(self) strongSelf = weakSelf;
+    if (strongSelf) {
+      dispatch_async(strongSelf.queue, ^{
+        [strongSelf _sendResponse:response];
+      });
+    }
+  };
+  OCFWebServerRequest* request = self.request;
+  OCFWebServerProcessBlock processBlock = self.handler.processBlock;
+  OCFWebServerWorkerPool* workerPool = (self.handler.workerPool ? self.handler.workerPool : self.server.defaultWorkerPool);
+  OCFWebServerHistogram* queueTime = self.server.metrics.handlerQueueTime;
+  uint64_t submitTime = OCFWebServerMetricsNow();
+  self.handlerSubmitTime = submitTime;
+  BOOL submitted = [workerPool submitBlock:^{
+    self.handlerStartTime = OCFWebServerMetricsNow();
+    [queueTime recordValue:(self.handlerStartTime - submitTime)];
+    @try {
+      processBlock(request);
+    }
+    @catch (NSException* exception) {
+      LOG_EXCEPTION(exception);
+      dispatch_async(self.queue, ^{
+        if (self.response || self.headerWriter || self.deferredResponse) {  // Too late for an error response
+          self.keepAlive = NO;  // Closed once the response in flight has been written
+        } else {
+          [self _abortWithStatusCode:500];
         }
-        [weakSelf _writeHeadersWithCompletionBlock:^(BOOL success) {
-          if (success) {
-            if ([weakSelf.response hasBody]) {
-              [weakSelf _writeBodyWithCompletionBlock:^(BOOL success) {
-                [weakSelf.response close];  // Can't do anything with result anyway
-                [weakSelf close];
-              }];
-            }
-          } else if ([weakSelf.response hasBody]) {
-            [weakSelf.response close];  // Can't do anything with result anyway
-            [weakSelf close];
-          }
-        }];
+      });
+    }
+  }];
+  if (!submitted) {
+    [self _abortWithStatusCode:503];
+  }
+}
+
+- (void)_beginRequestBody {
+  self.bodyReadStartTime = CFAbsoluteTimeGetCurrent();
+  self.bodyBytesRead = 0;
+  [self _enterPhase:OCFWebServerConnectionPhaseReadingBody];
+}
+
+- (void)_readChunkedRequestBody:(dispatch_data_t)initialData {
+  if ([self.request open]) {
+    self.chunkState = OCFWebServerChunkStateSize;
+    self.chunkRemainingLength = 0;
+    self.chunkLine = [[NSMutableData alloc] initWithCapacity:64];
+    ReadBodyCompletionBlock completionBlock = ^(BOOL success) {
+      
+      self.chunkLine = nil;
+      if (![self.request close]) {
+        success = NO;
+      }
+      if (success) {
+        [self _processRequest];
       } else {
-        [weakSelf _abortWithStatusCode:500];
+        [self _abortWithStatusCode:(self.timedOut ? 408 : 400)];
       }
+      
     };
-    self.handler.processBlock(self.request);
-  }
-  @catch (NSException* exception) {
-    LOG_EXCEPTION(exception);
+    if (![self _decodeChunkedBuffer:initialData]) {
+      completionBlock(NO);
+    } else if (self.chunkState == OCFWebServerChunkStateDone) {
+      completionBlock(YES);
+    } else {
+      [self _readChunkedBodyWithCompletionBlock:completionBlock];
+    }
+  } else {
     [self _abortWithStatusCode:500];
   }
-  @finally {
-    
-  }
 }
 
-- (void)_readRequestBody:(NSData*)initialData {
+- (void)_readRequestBody:(dispatch_data_t)initialData {
+  [self _beginRequestBody];
+  if (self.request.usesChunkedTransferEncoding) {
+    [self _readChunkedRequestBody:initialData];
+    return;
+  }
   if ([self.request open]) {
     NSInteger length = self.request.contentLength;
-    if (initialData.length) {
-      NSInteger result = [self.request write:initialData.bytes maxLength:initialData.length];
-      if (result == initialData.length) {
-        length -= initialData.length;
+    size_t initialLength = dispatch_data_get_size(initialData);
+    if (initialLength) {
+      if ([self _writeRequestBodyBuffer:initialData]) {
+        length -= initialLength;
         DCHECK(length >= 0);
       } else {
-        LOG_ERROR(@"Failed writing request body on socket %i (error %i)", self.socket, (int)result);
         length = -1;
       }
     }
@@ -382,7 +1115,7 @@ static dispatch_queue_t _formatterQueue = NULL;
         if (success) {
           [self _processRequest];
         } else {
-          [self _abortWithStatusCode:500];
+          [self _abortWithStatusCode:(self.timedOut ? 408 : 500)];
         }
         
       }];
@@ -401,62 +1134,228 @@ static dispatch_queue_t _formatterQueue = NULL;
   }
 }
 
+// Responses the server would compress for clients accepting it (whether this client does or not)
+- (BOOL)_isCompressibleResponse {
+  OCFWebServerResponse* response = self.response;
+  if ((self.server.compressionLevel <= 0) || (response.statusCode != 200) || response.additionalHeaders[@"Content-Encoding"]) {
+    return NO;
+  }
+  if (![response usesChunkedTransferEncoding] && (response.contentLength < self.server.minimumCompressionSize)) {
+    return NO;
+  }
+  return OCFWebServerIsCompressibleContentType(response.contentType);
+}
+
+- (OCFWebServerCompressor*)_compressorForResponse {
+  OCFWebServerContentEncoding encoding = OCFWebServerPreferredContentEncoding(self.request.headers[@"Accept-Encoding"]);
+  if (encoding == OCFWebServerContentEncodingIdentity) {
+    return nil;
+  }
+  return [OCFWebServerCompressor compressorWithEncoding:encoding level:self.server.compressionLevel];
+}
+
+- (BOOL)_requestIsHTTP11 {
+  OCFWebServerHeaderParser* parser = self.headerParser;
+  return ((parser.majorVersion > 1) || ((parser.majorVersion == 1) && (parser.minorVersion >= 1)));
+}
+
+- (BOOL)_shouldKeepAlive {
+  OCFWebServer* server = self.server;
+  if (!server.isRunning || (server.keepAliveTimeout <= 0.0)) {
+    return NO;
+  }
+  if ((server.maxRequestsPerConnection > 0) && (self.requestCount >= server.maxRequestsPerConnection)) {
+    return NO;
+  }
+  NSString* connectionHeader = self.headerParser.headers[@"Connection"];
+  if ([self _requestIsHTTP11]) {  // HTTP/1.1 connections are persistent unless the client opts out
+    return ([connectionHeader rangeOfString:@"close" options:NSCaseInsensitiveSearch].location == NSNotFound);
+  }
+  // HTTP/1.0 connections are only persistent if the client asks for it
+  return ([connectionHeader rangeOfString:@"keep-alive" options:NSCaseInsensitiveSearch].location != NSNotFound);
+}
+
+- (void)_resetRequestState {
+  [self.headerParser reset];
+  self.headerWriter = nil;
+  self.request.responseBlock = nil;
+  self.request = nil;
+  self.handler = nil;
+  self.response = nil;
+  self.keepAlive = NO;
+  self.chunkedResponse = NO;
+  self.sendsBody = NO;
+  self.compressor = nil;
+  self.requestStartTime = 0;
+  self.headersEndTime = 0;
+  self.handlerSubmitTime = 0;
+  self.handlerStartTime = 0;
+  self.responseTime = 0;
+  self.firstByteTime = 0;
+  self.streamingBody = NO;
+  self.bodyComplete = NO;
+  self.continuePending = NO;
+  self.deferredResponse = nil;
+}
+
+- (void)_logRequestWithStatusCode:(NSInteger)statusCode bytesRead:(NSUInteger)bytesRead bytesWritten:(NSUInteger)bytesWritten accessLog:(OCFWebServerAccessLog*)accessLog {
+  OCFWebServerAccessLogEntry entry;
+  memset(&entry, 0, sizeof(entry));
+  struct timespec now;
+  clock_gettime(CLOCK_REALTIME, &now);
+  entry.time = (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+  const struct sockaddr* address = self.address.bytes;
+  if ((self.address.length >= sizeof(struct sockaddr_in)) && (address->sa_family == AF_INET)) {
+    const struct sockaddr_in* address4 = (const struct sockaddr_in*)address;
+    entry.addressFamily = AF_INET;
+    memcpy(entry.address, &address4->sin_addr, sizeof(address4->sin_addr));
+    entry.port = ntohs(address4->sin_port);
+  } else if ((self.address.length >= sizeof(struct sockaddr_in6)) && (address->sa_family == AF_INET6)) {
+    const struct sockaddr_in6* address6 = (const struct sockaddr_in6*)address;
+    entry.addressFamily = AF_INET6;
+    memcpy(entry.address, &address6->sin6_addr, sizeof(address6->sin6_addr));
+    entry.port = ntohs(address6->sin6_port);
+  }
+  _CopyCString(entry.method, sizeof(entry.method), self.headerParser.method);
+  _CopyCString(entry.target, sizeof(entry.target), self.headerParser.target);
+  entry.statusCode = statusCode;
+  entry.bytesRead = bytesRead;
+  entry.bytesWritten = bytesWritten;
+  entry.headerTime = _ElapsedTime(self.requestStartTime, self.headersEndTime);
+  entry.queueTime = _ElapsedTime(self.handlerSubmitTime, self.handlerStartTime);
+  entry.handlerTime = _ElapsedTime(self.handlerStartTime, self.responseTime);
+  entry.firstByteTime = _ElapsedTime(self.headersEndTime, self.firstByteTime);
+  entry.totalTime = _ElapsedTime(self.requestStartTime, OCFWebServerMetricsNow());
+  [accessLog recordEntry:&entry];
+}
+
+- (void)_recordRequestWithStatusCode:(NSInteger)statusCode {
+  NSUInteger bytesRead = self.totalBytesRead - self.recordedBytesRead;
+  NSUInteger bytesWritten = self.totalBytesWritten - self.recordedBytesWritten;
+  OCFWebServerRouteMetrics* routeMetrics = (self.handler.routeMetrics ? self.handler.routeMetrics : self.server.metrics.unmatchedRoute);
+  [routeMetrics recordRequestWithStatusCode:statusCode bytesRead:bytesRead bytesWritten:bytesWritten];
+  OCFWebServerAccessLog* accessLog = self.server.accessLog;
+  if (accessLog) {
+    [self _logRequestWithStatusCode:statusCode bytesRead:bytesRead bytesWritten:bytesWritten accessLog:accessLog];
+  }
+  self.recordedBytesRead = self.totalBytesRead;
+  self.recordedBytesWritten = self.totalBytesWritten;
+}
+
+- (void)_finishRequestWithSuccess:(BOOL)success {
+  [self _recordRequestWithStatusCode:self.response.statusCode];
+  if (success) {
+    [self.compressor recycle];
+  }
+  self.compressor = nil;
+  if (success && self.keepAlive) {
+    LOG_DEBUG(@"Keeping connection alive after %i request(s) on socket %i", (int)self.requestCount, self.socket);
+    [self _resetRequestState];
+    [self _readRequestHeaders];
+  } else {
+    [self close];
+  }
+}
+
+- (NSURL*)_requestURL {
+  NSString* target = self.headerParser.target;
+  NSString* host = self.headerParser.headers[@"Host"];
+  NSURL* url = nil;
+  if ([target hasPrefix:@"/"] && host.length) {
+    url = [NSURL URLWithString:[NSString stringWithFormat:@"http://%@%@", host, target]];
+  }
+  return (url ? url : [NSURL URLWithString:target]);
+}
+
 - (void)_readRequestHeaders {
-  self.requestMessage = CFHTTPMessageCreateEmpty(kCFAllocatorDefault, true);
-  [self _readHeadersWithCompletionBlock:^(NSData* extraData) {
-    if (extraData) {
-      NSString* requestMethod = [(id)CFBridgingRelease(CFHTTPMessageCopyRequestMethod(self.requestMessage)) uppercaseString];
+  if (self.headerParser == nil) {
+    self.headerParser = [[OCFWebServerHeaderParser alloc] initWithMaximumHeaderSize:self.server.maxRequestHeaderSize];
+  }
+  DCHECK(!self.headerParser.hasReceivedData);
+  // The first request of a connection is held to the header timeout right away
+  [self _enterPhase:(((self.requestCount > 0) && (self.pendingData == nil)) ? OCFWebServerConnectionPhaseIdle : OCFWebServerConnectionPhaseReadingHeaders)];
+  [self _readHeadersWithCompletionBlock:^(OCFWebServerHeaderParserResult result, dispatch_data_t extraData) {
+    if (result == OCFWebServerHeaderParserResultComplete) {
+      self.requestCount = self.requestCount + 1;
+      self.keepAlive = [self _shouldKeepAlive];
+      NSString* requestMethod = self.headerParser.method;
       DCHECK(requestMethod);
-      NSURL* requestURL = (id)CFBridgingRelease(CFHTTPMessageCopyRequestURL(self.requestMessage));
-      DCHECK(requestURL);
-      NSString* requestPath = OCFWebServerUnescapeURLString((id)CFBridgingRelease(CFURLCopyPath((CFURLRef)requestURL)));  // Don't use -[NSURL path] which strips the ending slash
+      NSURL* requestURL = [self _requestURL];
+      if (requestURL == nil) {
+        LOG_ERROR(@"Invalid request target on socket %i", self.socket);
+        [self _abortWithStatusCode:400];
+        return;
+      }
+      NSString* requestPath = self.headerParser.path;
       if(requestPath == nil) {
         requestPath = @"/";
       }
-      DCHECK(requestPath);
       NSDictionary* requestQuery = nil;
-      NSString* queryString = (id)CFBridgingRelease(CFURLCopyQueryString((CFURLRef)requestURL, NULL));  // Don't use -[NSURL query] to make sure query is not unescaped;
+      NSString* queryString = self.headerParser.query;  // Still escaped
       if (queryString.length) {
-        requestQuery = OCFWebServerParseURLEncodedForm(queryString);
-        DCHECK(requestQuery);
+        requestQuery = [[OCFWebServerFormDictionary alloc] initWithString:queryString];  // Decoded on first access
       }
-      NSDictionary* requestHeaders = (id)CFBridgingRelease(CFHTTPMessageCopyAllHeaderFields(self.requestMessage));
+      NSDictionary* requestHeaders = self.headerParser.headers;
       DCHECK(requestHeaders);
-      for (OCFWebServerHandler *handler in self.server.handlers) {
-        self.request = handler.matchBlock(requestMethod, requestURL, requestHeaders, requestPath, requestQuery);
-        if (self.request) {
-          self.handler = handler;
-          break;
-        }
+      OCFWebServerHandler* handler = nil;
+      self.request = [self.server.router requestWithMethod:requestMethod URL:requestURL headers:requestHeaders path:requestPath query:requestQuery handler:&handler];
+      self.handler = handler;
+      if (!self.server.keepsMultiPartData && [self.request isKindOfClass:[OCFWebServerMultiPartFormRequest class]]) {
+        [(OCFWebServerMultiPartFormRequest*)self.request setKeepsData:NO];
       }
       if (self.request) {
         if (self.request.hasBody) {
-          if (extraData.length <= self.request.contentLength) {
-            NSString* expectHeader = (id)CFBridgingRelease(CFHTTPMessageCopyHeaderFieldValue(self.requestMessage, CFSTR("Expect")));
-            if (expectHeader) {
-              if ([expectHeader caseInsensitiveCompare:@"100-continue"] == NSOrderedSame) {
-                [self _writeData:_continueData withCompletionBlock:^(BOOL success) {
-                  if (success) {
-                    [self _readRequestBody:extraData];
-                  }
-                }];
-              } else {
-                LOG_ERROR(@"Unsupported 'Expect' / 'Content-Length' header combination on socket %i", self.socket);
-                [self _abortWithStatusCode:417];
+          dispatch_data_t bodyData = extraData;
+          size_t extraLength = dispatch_data_get_size(extraData);
+          if (!self.request.usesChunkedTransferEncoding && (extraLength > self.request.contentLength)) {  // Anything past the body belongs to the next pipelined request
+            NSUInteger contentLength = self.request.contentLength;
+            bodyData = dispatch_data_create_subrange(extraData, 0, contentLength);
+            [self _keepPendingData:dispatch_data_create_subrange(extraData, contentLength, extraLength - contentLength)];
+          }
+          BOOL streaming = [self.request isKindOfClass:[OCFWebServerStreamingRequest class]];
+          NSString* expectHeader = requestHeaders[@"Expect"];
+          if (expectHeader) {
+            if ([expectHeader caseInsensitiveCompare:@"100-continue"] == NSOrderedSame) {
+              if (streaming) {  // The handler may answer without ever reading the body
+                self.continuePending = YES;
+                [self _streamRequestBody:bodyData];
+                return;
               }
+              [self _writeData:_continueData withCompletionBlock:^(BOOL success) {
+                if (success) {
+                  [self _readRequestBody:bodyData];
+                } else {
+                  [self close];
+                }
+              }];
             } else {
-              [self _readRequestBody:extraData];
+              LOG_ERROR(@"Unsupported 'Expect' / 'Content-Length' header combination on socket %i", self.socket);
+              [self _abortWithStatusCode:417];
             }
+          } else if (streaming) {
+            [self _streamRequestBody:bodyData];
           } else {
-            LOG_ERROR(@"Unexpected 'Content-Length' header value on socket %i", self.socket);
-            [self _abortWithStatusCode:400];
+            [self _readRequestBody:bodyData];
           }
         } else {
-          [self _processRequest];
+          [self _keepPendingData:extraData];
+          if ([self.request isKindOfClass:[OCFWebServerStreamingRequest class]]) {
+            [self _streamRequestBody:NULL];
+          } else {
+            [self _processRequest];
+          }
         }
       } else {
         [self _abortWithStatusCode:405];
       }
+    } else if (result == OCFWebServerHeaderParserResultInvalid) {
+      [self _abortWithStatusCode:400];
+    } else if (result == OCFWebServerHeaderParserResultTooLarge) {
+      [self _abortWithStatusCode:431];
+    } else if (self.phase == OCFWebServerConnectionPhaseIdle) {  // Client closed the connection (or the keep-alive timeout expired) before sending another request
+      [self close];
+    } else if (self.timedOut) {
+      [self _abortWithStatusCode:408];
     } else {
       [self _abortWithStatusCode:500];
     }
@@ -470,17 +1369,28 @@ static dispatch_queue_t _formatterQueue = NULL;
     self.server = server;
     self.address = address;
     self.socket = socket;
+    self.queue = dispatch_queue_create("ocfwebserver.connection", DISPATCH_QUEUE_SERIAL);
+    dispatch_set_target_queue(self.queue, dispatch_get_global_queue(server.ioPriority, 0));
   }
   return self;
 }
 
-- (void)dealloc {
-  if(self.requestMessage) {
-    CFRelease(self.requestMessage);
-  }
-  if(self.responseMessage) {
-    CFRelease(self.responseMessage);
-  }
+#pragma mark - OCFWebServerTimerWheelTarget
+// Reads are only shut down so the pending read completes and the connection can still answer 408. A connection which
+// is idle, writing or already timed out is closed outright.
+- (void)timerWheelDidExpireAtDeadline:(uint64_t)deadline {
+  dispatch_async(self.queue, ^{
+    if (deadline != self.timeoutDeadline) {
+      return;  // Raced with the connection entering another phase (or closing) which re-armed or cancelled the timeout
+    }
+    self.timeoutDeadline = 0;
+    OCFWebServerConnectionPhase phase = self.phase;
+    BOOL reading = ((phase == OCFWebServerConnectionPhaseReadingHeaders) || (phase == OCFWebServerConnectionPhaseReadingBody));
+    BOOL alreadyTimedOut = self.timedOut;
+    LOG_DEBUG(@"Timeout expired in phase %i on socket %i", (int)phase, self.socket);
+    self.timedOut = YES;
+    shutdown(self.socket, (reading && !alreadyTimedOut ? SHUT_RD : SHUT_RDWR));
+  });
 }
 
 @end
@@ -490,10 +1400,14 @@ static dispatch_queue_t _formatterQueue = NULL;
 - (void)openWithCompletionHandler:(OCFWebServerConnectionCompletionHandler)completionHandler {
   LOG_DEBUG(@"Did open connection on socket %i", self.socket);
   self.completionHandler = completionHandler;
-  [self _readRequestHeaders];
+  dispatch_async(self.queue, ^{
+    [self _readRequestHeaders];
+  });
 }
 
 - (void)close {
+  [self.server.timerWheel cancelTimeoutForTarget:self];
+  self.timeoutDeadline = 0;
   int result = close(self.socket);
   if (result != 0) {
     LOG_ERROR(@"Failed closing socket %i for connection (%i): %s", self.socket, errno, strerror(errno));
@@ -0,0 +1,74 @@
+/*
+ This file belongs to the OCFWebServer project. OCFWebServer is a fork of GCDWebServer (originally developed by
+ Pierre-Olivier Latour). We have forked GCDWebServer because we made extensive and incompatible changes to it.
+ To find out more have a look at README.md.
+ 
+ Copyright (c) 2013, Christian Kienle / chris@objective-cloud.com
+ All rights reserved.
+ 
+ Original Copyright Statement:
+ Copyright (c) 2012-2013, Pierre-Olivier Latour
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ * Neither the name of the <organization> nor the
+ names of its contributors may be used to endorse or promote products
+ derived from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import <Foundation/Foundation.h>
+
+// Immutable snapshot of the metadata of a file or directory (and of the contents of small files)
+@interface OCFWebServerFileCacheEntry : NSObject
+
+#pragma mark - Properties
+@property(nonatomic, copy, readonly) NSString *path;
+@property(nonatomic, readonly, getter=isDirectory) BOOL directory;
+@property(nonatomic, readonly) unsigned long long size;
+@property(nonatomic, readonly) time_t modificationTime;
+@property(nonatomic, copy, readonly) NSString *mimeType;  // nil for directories
+@property(nonatomic, copy, readonly) NSString *eTag;  // Strong validator built from inode, size and modification time
+@property(nonatomic, copy, readonly) NSString *lastModified;  // Formatted for the "Last-Modified" header
+@property(nonatomic, copy, readonly) NSData *data;  // Contents of small files (may be nil)
+@property(nonatomic, copy, readonly) NSData *directoryListing;  // HTML listing of the regular files and subdirectories of a directory, built on first access (nil for files)
+
+#pragma mark - Creating
++ (instancetype)entryWithPath:(NSString*)path;  // Returns nil if there is no regular file or directory at path (symbolic links to files are not followed)
+
+@end
+
+// Bounded LRU cache of file entries shared by the handlers serving static files. An entry is revalidated with stat() at
+// most once per second, so replaced or modified files are picked up within a second without any file system watcher.
+// Paths without a file are remembered the same way.
+@interface OCFWebServerFileCache : NSObject
+
+#pragma mark - Properties
+@property(nonatomic, readonly) NSUInteger maximumEntries;
+@property(nonatomic, readonly) NSUInteger maximumDataSize;  // Total size of the cached file contents
+@property(nonatomic, readonly) NSUInteger maximumFileSize;  // Contents of larger files are never cached
+
+#pragma mark - Creating
+- (instancetype)initWithMaximumEntries:(NSUInteger)maximumEntries maximumDataSize:(NSUInteger)maximumDataSize maximumFileSize:(NSUInteger)maximumFileSize;
+
+#pragma mark - Caching
+- (OCFWebServerFileCacheEntry*)entryForPath:(NSString*)path;  // Returns nil if there is no such file or directory
+- (void)removeAllEntries;
+
+@end
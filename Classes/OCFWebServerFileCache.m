@@ -0,0 +1,352 @@
+/*
+ This file belongs to the OCFWebServer project. OCFWebServer is a fork of GCDWebServer (originally developed by
+ Pierre-Olivier Latour). We have forked GCDWebServer because we made extensive and incompatible changes to it.
+ To find out more have a look at README.md.
+ 
+ Copyright (c) 2013, Christian Kienle / chris@objective-cloud.com
+ All rights reserved.
+ 
+ Original Copyright Statement:
+ Copyright (c) 2012-2013, Pierre-Olivier Latour
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ * Neither the name of the <organization> nor the
+ names of its contributors may be used to endorse or promote products
+ derived from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import <dirent.h>
+#import <sys/stat.h>
+
+#import "OCFWebServerPrivate.h"
+#import "OCFWebServerFileCache.h"
+
+#if defined(__APPLE__)
+#define _ModificationTimeSpec(info) ((info).st_mtimespec)
+#else
+#define _ModificationTimeSpec(info) ((info).st_mtim)
+#endif
+
+@interface OCFWebServerFileCacheEntry ()
+
+#pragma mark - Properties
+@property(nonatomic, copy, readwrite) NSString *path;
+@property(nonatomic, readwrite, getter=isDirectory) BOOL directory;
+@property(nonatomic, readwrite) unsigned long long size;
+@property(nonatomic, readwrite) time_t modificationTime;
+@property(nonatomic, copy, readwrite) NSString *mimeType;
+@property(nonatomic, copy, readwrite) NSString *eTag;
+@property(nonatomic, copy, readwrite) NSString *lastModified;
+@property(nonatomic, copy, readwrite) NSData *data;
+@property(nonatomic, copy, readwrite) NSData *directoryListing;  // Guarded by the entry
+@property(nonatomic, assign) struct stat info;
+@property(nonatomic, assign, getter=isMissing) BOOL missing;  // Remembers that there is no file at this path (e.g. for "file.gz" lookups)
+@property(nonatomic, assign) time_t validationTime;  // Guarded by the cache
+@property(nonatomic, weak) OCFWebServerFileCacheEntry *previous;  // Guarded by the cache (towards most recently used)
+@property(nonatomic, strong) OCFWebServerFileCacheEntry *next;  // Guarded by the cache (towards least recently used)
+
+#pragma mark - Creating
+- (instancetype)initWithPath:(NSString*)path info:(struct stat)info;
+
+#pragma mark - Loading
+- (void)_loadDataWithMaximumSize:(NSUInteger)maximumSize;
+
+@end
+
+// Returns NO if there is no regular file or directory (symbolic links are only followed to directories)
+static BOOL _GetFileInfo(NSString* path, struct stat* info) {
+  const char* fileSystemPath = [path fileSystemRepresentation];
+  if (lstat(fileSystemPath, info) != 0) {
+    return NO;
+  }
+  if (S_ISLNK(info->st_mode)) {
+    if ((stat(fileSystemPath, info) != 0) || !S_ISDIR(info->st_mode)) {
+      return NO;
+    }
+  }
+  return (S_ISREG(info->st_mode) || S_ISDIR(info->st_mode));
+}
+
+static BOOL _IsSameFile(const struct stat* info1, const struct stat* info2) {
+  return ((info1->st_ino == info2->st_ino) && (info1->st_dev == info2->st_dev) && (info1->st_mode == info2->st_mode) && (info1->st_size == info2->st_size)
+          && (_ModificationTimeSpec(*info1).tv_sec == _ModificationTimeSpec(*info2).tv_sec) && (_ModificationTimeSpec(*info1).tv_nsec == _ModificationTimeSpec(*info2).tv_nsec));
+}
+
+static void _AppendString(NSMutableData* data, NSString* string) {
+  const char* bytes = [string UTF8String];
+  [data appendBytes:bytes length:strlen(bytes)];
+}
+
+static void _AppendEscapedHTML(NSMutableData* data, NSString* string) {
+  const char* bytes = [string UTF8String];
+  const char* run = bytes;
+  for (const char* position = bytes; *position; ++position) {
+    const char* entity = NULL;
+    switch (*position) {
+      case '&': entity = "&amp;"; break;
+      case '<': entity = "&lt;"; break;
+      case '>': entity = "&gt;"; break;
+      case '"': entity = "&quot;"; break;
+    }
+    if (entity) {
+      [data appendBytes:run length:(position - run)];
+      [data appendBytes:entity length:strlen(entity)];
+      run = position + 1;
+    }
+  }
+  [data appendBytes:run length:strlen(run)];
+}
+
+// Hidden files are left out and subdirectories end with "/"
+static NSData* _CreateDirectoryListing(NSString* path) {
+  DIR* directory = opendir([path fileSystemRepresentation]);
+  if (directory == NULL) {
+    return nil;
+  }
+  NSMutableArray* names = [[NSMutableArray alloc] init];
+  struct dirent* item;
+  while ((item = readdir(directory))) {
+    if (item->d_name[0] == '.') {
+      continue;
+    }
+    unsigned char type = item->d_type;
+    if (type == DT_UNKNOWN) {  // Not all file systems report the type
+      struct stat info;
+      NSString* itemPath = [path stringByAppendingPathComponent:[[NSFileManager defaultManager] stringWithFileSystemRepresentation:item->d_name length:strlen(item->d_name)]];
+      if (lstat([itemPath fileSystemRepresentation], &info) == 0) {
+        type = (S_ISREG(info.st_mode) ? DT_REG : (S_ISDIR(info.st_mode) ? DT_DIR : DT_UNKNOWN));
+      }
+    }
+    if ((type != DT_REG) && (type != DT_DIR)) {
+      continue;
+    }
+    NSString* name = [[NSFileManager defaultManager] stringWithFileSystemRepresentation:item->d_name length:strlen(item->d_name)];
+    [names addObject:(type == DT_DIR ? [name stringByAppendingString:@"/"] : name)];
+  }
+  closedir(directory);
+  [names sortUsingSelector:@selector(compare:)];
+  
+  NSMutableData* html = [[NSMutableData alloc] initWithCapacity:(64 * (names.count + 1))];
+  _AppendString(html, @"<html><body>\n<ul>\n");
+  for (NSString* name in names) {
+    NSString* escapedName = [name stringByAddingPercentEscapesUsingEncoding:NSUTF8StringEncoding];
+    DCHECK(escapedName);
+    _AppendString(html, @"<li><a href=\"");
+    _AppendEscapedHTML(html, escapedName);
+    _AppendString(html, @"\">");
+    _AppendEscapedHTML(html, name);
+    _AppendString(html, @"</a></li>\n");
+  }
+  _AppendString(html, @"</ul>\n</body></html>\n");
+  return html;
+}
+
+@implementation OCFWebServerFileCacheEntry
+
+#pragma mark - Creating
++ (instancetype)entryWithPath:(NSString*)path {
+  struct stat info;
+  if (!_GetFileInfo(path, &info)) {
+    return nil;
+  }
+  return [[self alloc] initWithPath:path info:info];
+}
+
+- (instancetype)initWithPath:(NSString*)path info:(struct stat)info {
+  if((self = [super init])) {
+    self.path = path;
+    self.info = info;
+    self.directory = S_ISDIR(info.st_mode);
+    self.size = (unsigned long long)info.st_size;
+    self.modificationTime = _ModificationTimeSpec(info).tv_sec;
+    if (!self.directory) {
+      NSString* mimeType = OCFWebServerGetMimeTypeForExtension([path pathExtension]);
+      self.mimeType = (mimeType ? mimeType : kOCFWebServerDefaultMimeType);
+      self.eTag = [NSString stringWithFormat:@"\"%llx-%llx-%lx%09lx\"", (unsigned long long)info.st_ino, self.size, (unsigned long)self.modificationTime, (unsigned long)_ModificationTimeSpec(info).tv_nsec];
+      self.lastModified = OCFWebServerFormatHTTPDate(self.modificationTime);
+    }
+  }
+  return self;
+}
+
+// Entries are replaced once the directory is modified so the listing never needs to be invalidated
+- (NSData*)directoryListing {
+  if (!self.directory) {
+    return nil;
+  }
+  @synchronized(self) {
+    if (_directoryListing == nil) {
+      _directoryListing = _CreateDirectoryListing(self.path);
+    }
+    return _directoryListing;
+  }
+}
+
+- (void)_loadDataWithMaximumSize:(NSUInteger)maximumSize {
+  if (self.directory || (self.size > maximumSize)) {
+    return;
+  }
+  NSData* data = [NSData dataWithContentsOfFile:self.path options:NSDataReadingUncached error:NULL];
+  if (data.length == self.size) {  // Otherwise the file was modified since stat()
+    self.data = data;
+  }
+}
+
+@end
+
+@interface OCFWebServerFileCache ()
+
+#pragma mark - Properties
+@property(nonatomic, readwrite) NSUInteger maximumEntries;
+@property(nonatomic, readwrite) NSUInteger maximumDataSize;
+@property(nonatomic, readwrite) NSUInteger maximumFileSize;
+@property(nonatomic, strong) NSMutableDictionary *entries;
+@property(nonatomic, strong) OCFWebServerFileCacheEntry *head;  // Most recently used
+@property(nonatomic, weak) OCFWebServerFileCacheEntry *tail;  // Least recently used
+@property(nonatomic, assign) NSUInteger dataSize;
+
+@end
+
+@implementation OCFWebServerFileCache
+
+#pragma mark - Creating
+- (instancetype)init {
+  return [self initWithMaximumEntries:1024 maximumDataSize:(16 * 1024 * 1024) maximumFileSize:(64 * 1024)];
+}
+
+- (instancetype)initWithMaximumEntries:(NSUInteger)maximumEntries maximumDataSize:(NSUInteger)maximumDataSize maximumFileSize:(NSUInteger)maximumFileSize {
+  if((self = [super init])) {
+    self.maximumEntries = maximumEntries;
+    self.maximumDataSize = maximumDataSize;
+    self.maximumFileSize = MIN(maximumFileSize, maximumDataSize);
+    self.entries = [[NSMutableDictionary alloc] init];
+  }
+  return self;
+}
+
+#pragma mark - LRU List (must be called while synchronized)
+- (void)_unlinkEntry:(OCFWebServerFileCacheEntry*)entry {
+  OCFWebServerFileCacheEntry* previous = entry.previous;
+  OCFWebServerFileCacheEntry* next = entry.next;
+  if (previous) {
+    previous.next = next;
+  } else {
+    self.head = next;
+  }
+  if (next) {
+    next.previous = previous;
+  } else {
+    self.tail = previous;
+  }
+  entry.previous = nil;
+  entry.next = nil;
+}
+
+- (void)_insertEntryAtHead:(OCFWebServerFileCacheEntry*)entry {
+  entry.next = self.head;
+  self.head.previous = entry;
+  self.head = entry;
+  if (self.tail == nil) {
+    self.tail = entry;
+  }
+}
+
+- (void)_removeEntry:(OCFWebServerFileCacheEntry*)entry {
+  [self _unlinkEntry:entry];
+  [self.entries removeObjectForKey:entry.path];
+  self.dataSize = self.dataSize - entry.data.length;
+}
+
+- (void)_addEntry:(OCFWebServerFileCacheEntry*)entry {
+  OCFWebServerFileCacheEntry* oldEntry = self.entries[entry.path];
+  if (oldEntry) {
+    [self _removeEntry:oldEntry];
+  }
+  self.entries[entry.path] = entry;
+  [self _insertEntryAtHead:entry];
+  self.dataSize = self.dataSize + entry.data.length;
+  while (((self.entries.count > self.maximumEntries) || (self.dataSize > self.maximumDataSize)) && (self.tail != entry)) {
+    [self _removeEntry:self.tail];
+  }
+}
+
+#pragma mark - Caching
+- (OCFWebServerFileCacheEntry*)entryForPath:(NSString*)path {
+  time_t now = time(NULL);
+  OCFWebServerFileCacheEntry* entry = nil;
+  @synchronized(self) {
+    entry = self.entries[path];
+    if (entry) {
+      [self _unlinkEntry:entry];
+      [self _insertEntryAtHead:entry];
+      if (entry.validationTime == now) {
+        return (entry.missing ? nil : entry);
+      }
+    }
+  }
+  
+  struct stat info;
+  if (!_GetFileInfo(path, &info)) {
+    if (entry.missing) {
+      @synchronized(self) {
+        entry.validationTime = now;
+      }
+    } else {
+      OCFWebServerFileCacheEntry* missingEntry = [[OCFWebServerFileCacheEntry alloc] init];
+      missingEntry.path = path;
+      missingEntry.missing = YES;
+      missingEntry.validationTime = now;
+      @synchronized(self) {
+        [self _addEntry:missingEntry];
+      }
+    }
+    return nil;
+  }
+  if (entry && !entry.missing) {
+    struct stat entryInfo = entry.info;
+    if (_IsSameFile(&info, &entryInfo)) {
+      @synchronized(self) {
+        entry.validationTime = now;
+      }
+      return entry;
+    }
+  }
+  
+  entry = [[OCFWebServerFileCacheEntry alloc] initWithPath:path info:info];
+  [entry _loadDataWithMaximumSize:self.maximumFileSize];
+  entry.validationTime = now;
+  @synchronized(self) {
+    [self _addEntry:entry];
+  }
+  return entry;
+}
+
+- (void)removeAllEntries {
+  @synchronized(self) {
+    while (self.tail) {
+      [self _removeEntry:self.tail];
+    }
+    DCHECK(self.entries.count == 0);
+    DCHECK(self.dataSize == 0);
+  }
+}
+
+@end
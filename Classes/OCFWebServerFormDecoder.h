@@ -0,0 +1,59 @@
+/*
+ This file belongs to the OCFWebServer project. OCFWebServer is a fork of GCDWebServer (originally developed by
+ Pierre-Olivier Latour). We have forked GCDWebServer because we made extensive and incompatible changes to it.
+ To find out more have a look at README.md.
+ 
+ Copyright (c) 2013, Christian Kienle / chris@objective-cloud.com
+ All rights reserved.
+ 
+ Original Copyright Statement:
+ Copyright (c) 2012-2013, Pierre-Olivier Latour
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ * Neither the name of the <organization> nor the
+ names of its contributors may be used to endorse or promote products
+ derived from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import <Foundation/Foundation.h>
+
+// Immutable dictionary of the arguments of an "application/x-www-form-urlencoded" string (query or form body) which
+// is only decoded the first time it is accessed. Copying it does not decode it.
+@interface OCFWebServerFormDictionary : NSDictionary
+
+#pragma mark - Creating
+- (instancetype)initWithString:(NSString*)string;  // Percent-escapes are decoded as UTF-8
+- (instancetype)initWithData:(NSData*)data encoding:(NSStringEncoding)encoding;  // Data must not be mutated afterwards
+
+@end
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Decodes in a single pass over the bytes: "+" becomes a space, valid percent-escapes are replaced by the bytes they
+// encode and invalid ones are kept as is. A pair without "=" has an empty value and the last of duplicate keys wins.
+// Pairs which do not form valid strings in the encoding are skipped.
+NSDictionary* OCFWebServerDecodeURLEncodedForm(const void* bytes, NSUInteger length, NSStringEncoding encoding);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,262 @@
+/*
+ This file belongs to the OCFWebServer project. OCFWebServer is a fork of GCDWebServer (originally developed by
+ Pierre-Olivier Latour). We have forked GCDWebServer because we made extensive and incompatible changes to it.
+ To find out more have a look at README.md.
+ 
+ Copyright (c) 2013, Christian Kienle / chris@objective-cloud.com
+ All rights reserved.
+ 
+ Original Copyright Statement:
+ Copyright (c) 2012-2013, Pierre-Olivier Latour
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ * Neither the name of the <organization> nor the
+ names of its contributors may be used to endorse or promote products
+ derived from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#if defined(__SSE2__)
+#import <emmintrin.h>
+#elif defined(__ARM_NEON)
+#import <arm_neon.h>
+#endif
+
+#import "OCFWebServerPrivate.h"
+#import "OCFWebServerFormDecoder.h"
+
+#define kStackBufferSize 512
+
+// Index of the first "&", "=", "%" or "+" (length if there is none), 16 bytes at a time where SIMD is available
+static inline NSUInteger _FindSpecialByte(const UInt8* bytes, NSUInteger length) {
+  NSUInteger offset = 0;
+#if defined(__SSE2__)
+  const __m128i ampersand = _mm_set1_epi8('&');
+  const __m128i equal = _mm_set1_epi8('=');
+  const __m128i percent = _mm_set1_epi8('%');
+  const __m128i plus = _mm_set1_epi8('+');
+  for (; offset + 16 <= length; offset += 16) {
+    __m128i chunk = _mm_loadu_si128((const __m128i*)(bytes + offset));
+    __m128i matches = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, ampersand), _mm_cmpeq_epi8(chunk, equal)),
+                                   _mm_or_si128(_mm_cmpeq_epi8(chunk, percent), _mm_cmpeq_epi8(chunk, plus)));
+    int mask = _mm_movemask_epi8(matches);
+    if (mask) {
+      return offset + __builtin_ctz(mask);
+    }
+  }
+#elif defined(__ARM_NEON)
+  const uint8x16_t ampersand = vdupq_n_u8('&');
+  const uint8x16_t equal = vdupq_n_u8('=');
+  const uint8x16_t percent = vdupq_n_u8('%');
+  const uint8x16_t plus = vdupq_n_u8('+');
+  for (; offset + 16 <= length; offset += 16) {
+    uint8x16_t chunk = vld1q_u8(bytes + offset);
+    uint8x16_t matches = vorrq_u8(vorrq_u8(vceqq_u8(chunk, ampersand), vceqq_u8(chunk, equal)),
+                                  vorrq_u8(vceqq_u8(chunk, percent), vceqq_u8(chunk, plus)));
+    // Narrowing leaves 4 bits per byte so the mask fits in 64 bits
+    uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(matches), 4)), 0);
+    if (mask) {
+      return offset + (__builtin_ctzll(mask) >> 2);
+    }
+  }
+#endif
+  for (; offset < length; ++offset) {
+    UInt8 byte = bytes[offset];
+    if ((byte == '&') || (byte == '=') || (byte == '%') || (byte == '+')) {
+      break;
+    }
+  }
+  return offset;
+}
+
+static inline int _HexValue(UInt8 byte) {
+  if ((byte >= '0') && (byte <= '9')) {
+    return byte - '0';
+  }
+  if ((byte >= 'a') && (byte <= 'f')) {
+    return byte - 'a' + 10;
+  }
+  if ((byte >= 'A') && (byte <= 'F')) {
+    return byte - 'A' + 10;
+  }
+  return -1;
+}
+
+static NSString* _CreateString(const UInt8* bytes, NSUInteger length, NSStringEncoding encoding) {
+  if (length == 0) {
+    return @"";
+  }
+  return [[NSString alloc] initWithBytes:bytes length:length encoding:encoding];
+}
+
+NSDictionary* OCFWebServerDecodeURLEncodedForm(const void* bytes, NSUInteger length, NSStringEncoding encoding) {
+  NSMutableDictionary* arguments = [[NSMutableDictionary alloc] init];
+  UInt8 stackBuffer[kStackBufferSize];
+  UInt8* buffer = (length <= kStackBufferSize ? stackBuffer : malloc(length));  // Decoding never makes a pair longer
+  if (buffer == NULL) {
+    return nil;
+  }
+  const UInt8* position = bytes;
+  const UInt8* end = position + length;
+  NSUInteger decodedLength = 0;
+  NSString* key = nil;
+  BOOL hasValue = NO;  // "=" seen in the current pair
+  while (1) {
+    NSUInteger runLength = _FindSpecialByte(position, end - position);
+    memcpy(buffer + decodedLength, position, runLength);
+    decodedLength += runLength;
+    position += runLength;
+    
+    if ((position == end) || (*position == '&')) {
+      if (hasValue) {
+        NSString* value = _CreateString(buffer, decodedLength, encoding);
+        if (key && value) {
+          arguments[key] = value;
+        }
+      } else if (decodedLength > 0) {
+        NSString* name = _CreateString(buffer, decodedLength, encoding);
+        if (name) {
+          arguments[name] = @"";
+        }
+      }
+      if (position == end) {
+        break;
+      }
+      position += 1;
+      decodedLength = 0;
+      key = nil;
+      hasValue = NO;
+      continue;
+    }
+    
+    switch (*position) {
+      case '+':
+        buffer[decodedLength++] = ' ';
+        position += 1;
+        break;
+        
+      case '%': {
+        int high = (end - position > 2 ? _HexValue(position[1]) : -1);
+        int low = (high >= 0 ? _HexValue(position[2]) : -1);
+        if (low >= 0) {
+          buffer[decodedLength++] = (UInt8)((high << 4) | low);
+          position += 3;
+        } else {
+          buffer[decodedLength++] = '%';
+          position += 1;
+        }
+        break;
+      }
+      
+      case '=':
+        if (hasValue) {  // Only the first "=" separates the key from the value
+          buffer[decodedLength++] = '=';
+        } else {
+          key = _CreateString(buffer, decodedLength, encoding);
+          decodedLength = 0;
+          hasValue = YES;
+        }
+        position += 1;
+        break;
+    }
+  }
+  if (buffer != stackBuffer) {
+    free(buffer);
+  }
+  return arguments;
+}
+
+@interface OCFWebServerFormDictionary ()
+
+#pragma mark - Properties
+@property (atomic, strong) NSDictionary *arguments;  // nil until first accessed
+@property (nonatomic, copy) NSString *string;
+@property (nonatomic, strong) NSData *data;
+@property (nonatomic, assign) NSStringEncoding encoding;
+
+@end
+
+@implementation OCFWebServerFormDictionary
+
+#pragma mark - Creating
+- (instancetype)initWithString:(NSString*)string {
+  if((self = [super init])) {
+    self.string = string;
+    self.encoding = NSUTF8StringEncoding;
+  }
+  return self;
+}
+
+- (instancetype)initWithData:(NSData*)data encoding:(NSStringEncoding)encoding {
+  if((self = [super init])) {
+    self.data = data;
+    self.encoding = encoding;
+  }
+  return self;
+}
+
+- (NSDictionary*)_arguments {
+  NSDictionary* arguments = self.arguments;
+  if (arguments == nil) {
+    @synchronized(self) {
+      arguments = self.arguments;
+      if (arguments == nil) {
+        if (self.string) {
+          const char* bytes = [self.string UTF8String];
+          arguments = OCFWebServerDecodeURLEncodedForm(bytes, strlen(bytes), self.encoding);
+        } else {
+          arguments = OCFWebServerDecodeURLEncodedForm(self.data.bytes, self.data.length, self.encoding);
+        }
+        if (arguments == nil) {
+          LOG_ERROR(@"Failed decoding URL encoded form");
+          arguments = @{};
+        }
+        self.arguments = arguments;
+        self.string = nil;
+        self.data = nil;
+      }
+    }
+  }
+  return arguments;
+}
+
+#pragma mark - NSDictionary
+- (NSUInteger)count {
+  return [[self _arguments] count];
+}
+
+- (id)objectForKey:(id)key {
+  return [[self _arguments] objectForKey:key];
+}
+
+- (NSEnumerator*)keyEnumerator {
+  return [[self _arguments] keyEnumerator];
+}
+
+- (NSUInteger)countByEnumeratingWithState:(NSFastEnumerationState*)state objects:(id __unsafe_unretained [])buffer count:(NSUInteger)length {
+  return [[self _arguments] countByEnumeratingWithState:state objects:buffer count:length];
+}
+
+#pragma mark - NSCopying
+- (id)copyWithZone:(NSZone*)zone {
+  return self;  // Immutable
+}
+
+@end
@@ -0,0 +1,71 @@
+/*
+ This file belongs to the OCFWebServer project. OCFWebServer is a fork of GCDWebServer (originally developed by
+ Pierre-Olivier Latour). We have forked GCDWebServer because we made extensive and incompatible changes to it.
+ To find out more have a look at README.md.
+ 
+ Copyright (c) 2013, Christian Kienle / chris@objective-cloud.com
+ All rights reserved.
+ 
+ Original Copyright Statement:
+ Copyright (c) 2012-2013, Pierre-Olivier Latour
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ * Neither the name of the <organization> nor the
+ names of its contributors may be used to endorse or promote products
+ derived from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import <Foundation/Foundation.h>
+
+typedef NS_ENUM(NSInteger, OCFWebServerHeaderParserResult) {
+  OCFWebServerHeaderParserResultIncomplete,
+  OCFWebServerHeaderParserResultComplete,
+  OCFWebServerHeaderParserResultInvalid,
+  OCFWebServerHeaderParserResultTooLarge
+};
+
+// Incremental parser for the request line and headers of an HTTP/1.x request. Bytes can be passed in as they arrive in
+// arbitrary pieces; the parser resumes where it stopped. A header received in a single piece is scanned in place and
+// its strings are created straight from that piece, otherwise the bytes received so far are copied into one buffer
+// (bounded by the maximum header size). Strings are only created once the header is complete. Headers with a non-numeric or conflicting
+// Content-Length, or with both Content-Length and Transfer-Encoding, are invalid.
+@interface OCFWebServerHeaderParser : NSObject
+
+#pragma mark - Properties
+@property(nonatomic, readonly) NSUInteger maximumHeaderSize;
+@property(nonatomic, readonly) BOOL hasReceivedData;  // YES once the first byte of the request has been parsed
+@property(nonatomic, copy, readonly) NSString *method;  // Only valid once complete
+@property(nonatomic, copy, readonly) NSString *target;  // Only valid once complete (raw request target)
+@property(nonatomic, copy, readonly) NSString *path;  // Only valid once complete (percent-escapes removed)
+@property(nonatomic, copy, readonly) NSString *query;  // Only valid once complete (raw query string, nil if none)
+@property(nonatomic, copy, readonly) NSDictionary *headers;  // Only valid once complete (header names are canonicalized e.g. "Content-Type")
+@property(nonatomic, readonly) NSUInteger majorVersion;  // Only valid once complete
+@property(nonatomic, readonly) NSUInteger minorVersion;  // Only valid once complete
+
+#pragma mark - Creating
+- (instancetype)initWithMaximumHeaderSize:(NSUInteger)maximumHeaderSize;
+
+#pragma mark - Parsing
+- (OCFWebServerHeaderParserResult)parseBytes:(const void*)bytes length:(NSUInteger)length consumedLength:(NSUInteger*)consumedLength;  // Stops right after the empty line terminating the header
+- (OCFWebServerHeaderParserResult)parseHeaderFieldBytes:(const void*)bytes length:(NSUInteger)length;  // Resets then parses a whole header block without request line (e.g. the headers of a MIME part) ending with an empty line; only "headers" is valid afterwards
+- (void)reset;
+
+@end
@@ -0,0 +1,513 @@
+/*
+ This file belongs to the OCFWebServer project. OCFWebServer is a fork of GCDWebServer (originally developed by
+ Pierre-Olivier Latour). We have forked GCDWebServer because we made extensive and incompatible changes to it.
+ To find out more have a look at README.md.
+ 
+ Copyright (c) 2013, Christian Kienle / chris@objective-cloud.com
+ All rights reserved.
+ 
+ Original Copyright Statement:
+ Copyright (c) 2012-2013, Pierre-Olivier Latour
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ * Neither the name of the <organization> nor the
+ names of its contributors may be used to endorse or promote products
+ derived from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import "OCFWebServerPrivate.h"
+#import "OCFWebServerHeaderParser.h"
+
+#define kMaxHeaderFields 128
+#define kInitialBufferCapacity 1024
+
+typedef NS_ENUM(NSUInteger, OCFWebServerHeaderParserState) {
+  OCFWebServerHeaderParserStateRequestLineStart,
+  OCFWebServerHeaderParserStateMethod,
+  OCFWebServerHeaderParserStateTargetStart,
+  OCFWebServerHeaderParserStateTarget,
+  OCFWebServerHeaderParserStateVersion,
+  OCFWebServerHeaderParserStateVersionLF,
+  OCFWebServerHeaderParserStateLineStart,
+  OCFWebServerHeaderParserStateName,
+  OCFWebServerHeaderParserStateValueStart,
+  OCFWebServerHeaderParserStateValue,
+  OCFWebServerHeaderParserStateValueLF,
+  OCFWebServerHeaderParserStateFinalLF,
+  OCFWebServerHeaderParserStateDone
+};
+
+typedef struct {
+  NSUInteger nameStart;
+  NSUInteger nameLength;
+  NSUInteger valueStart;
+  NSUInteger valueLength;
+} OCFWebServerHeaderField;
+
+// http://tools.ietf.org/html/rfc7230#section-3.2.6
+static inline BOOL _IsTokenCharacter(unsigned char c) {
+  if (((c >= 'a') && (c <= 'z')) || ((c >= 'A') && (c <= 'Z')) || ((c >= '0') && (c <= '9'))) {
+    return YES;
+  }
+  return ((c > 0x20) && (c < 0x7F) && strchr("!#$%&'*+-.^_`|~", c) ? YES : NO);
+}
+
+static inline int _HexValue(unsigned char c) {
+  if ((c >= '0') && (c <= '9')) {
+    return c - '0';
+  }
+  if ((c >= 'a') && (c <= 'f')) {
+    return c - 'a' + 10;
+  }
+  if ((c >= 'A') && (c <= 'F')) {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+// http://tools.ietf.org/html/rfc7230#section-3.3.2
+static BOOL _IsValidContentLength(const char* bytes, NSUInteger length) {
+  if ((length == 0) || (length > 18)) {  // Cannot overflow
+    return NO;
+  }
+  for (NSUInteger i = 0; i < length; ++i) {
+    if (!isdigit((unsigned char)bytes[i])) {
+      return NO;
+    }
+  }
+  return YES;
+}
+
+static NSString* _StringWithBytes(const char* bytes, NSUInteger length) {
+  NSString* string = [[NSString alloc] initWithBytes:bytes length:length encoding:NSUTF8StringEncoding];
+  if (string == nil) {
+    string = [[NSString alloc] initWithBytes:bytes length:length encoding:NSISOLatin1StringEncoding];
+  }
+  return string;
+}
+
+// Returns nil if the escapes are malformed or do not decode to UTF-8
+static NSString* _StringByRemovingPercentEscapes(const char* bytes, NSUInteger length) {
+  const char* escape = memchr(bytes, '%', length);
+  if (escape == NULL) {
+    return [[NSString alloc] initWithBytes:bytes length:length encoding:NSUTF8StringEncoding];
+  }
+  char stackBuffer[256];
+  char* buffer = (length <= sizeof(stackBuffer) ? stackBuffer : malloc(length));
+  NSUInteger prefixLength = escape - bytes;
+  memcpy(buffer, bytes, prefixLength);
+  NSUInteger outputLength = prefixLength;
+  NSString* string = nil;
+  NSUInteger index = prefixLength;
+  for (; index < length; ++index) {
+    char c = bytes[index];
+    if (c == '%') {
+      int high = (index + 2 < length ? _HexValue(bytes[index + 1]) : -1);
+      int low = (high >= 0 ? _HexValue(bytes[index + 2]) : -1);
+      if (low < 0) {
+        break;
+      }
+      c = (char)((high << 4) | low);
+      index += 2;
+    }
+    buffer[outputLength++] = c;
+  }
+  if (index == length) {
+    string = [[NSString alloc] initWithBytes:buffer length:outputLength encoding:NSUTF8StringEncoding];
+  }
+  if (buffer != stackBuffer) {
+    free(buffer);
+  }
+  return string;
+}
+
+// Returns one of the well-known methods without allocating if possible
+static NSString* _MethodWithBytes(const char* bytes, NSUInteger length) {
+  static const char* methods[] = {"GET", "POST", "PUT", "DELETE", "HEAD", "OPTIONS", "PATCH"};
+  static NSString* methodStrings[] = {@"GET", @"POST", @"PUT", @"DELETE", @"HEAD", @"OPTIONS", @"PATCH"};
+  for (NSUInteger i = 0; i < sizeof(methods) / sizeof(methods[0]); ++i) {
+    if ((strlen(methods[i]) == length) && (strncasecmp(methods[i], bytes, length) == 0)) {
+      return methodStrings[i];
+    }
+  }
+  return [[[NSString alloc] initWithBytes:bytes length:length encoding:NSASCIIStringEncoding] uppercaseString];
+}
+
+// Returns the canonical form of a header name i.e. "content-type" becomes "Content-Type"
+static NSString* _HeaderNameWithBytes(const char* bytes, NSUInteger length) {
+  static NSString* names[] = {@"Host", @"Connection", @"Content-Type", @"Content-Length", @"Transfer-Encoding", @"Expect", @"Accept",
+                              @"Accept-Encoding", @"Accept-Language", @"User-Agent", @"Cookie", @"Authorization", @"If-None-Match",
+                              @"If-Modified-Since", @"Range", @"If-Range", @"Cache-Control", @"Referer", @"Origin", @"Keep-Alive",
+                              @"X-Forwarded-For", @"X-Forwarded-Proto", @"X-Requested-With"};
+  static const char* cNames[sizeof(names) / sizeof(names[0])] = {0};
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    for (NSUInteger i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+      cNames[i] = [names[i] UTF8String];
+    }
+  });
+  for (NSUInteger i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+    if ((strlen(cNames[i]) == length) && (strncasecmp(cNames[i], bytes, length) == 0)) {
+      return names[i];
+    }
+  }
+  char stackBuffer[128];
+  char* buffer = (length <= sizeof(stackBuffer) ? stackBuffer : malloc(length));
+  BOOL upper = YES;
+  for (NSUInteger i = 0; i < length; ++i) {
+    char c = bytes[i];
+    buffer[i] = (char)(upper ? toupper(c) : tolower(c));
+    upper = (c == '-');
+  }
+  NSString* name = [[NSString alloc] initWithBytes:buffer length:length encoding:NSASCIIStringEncoding];
+  if (buffer != stackBuffer) {
+    free(buffer);
+  }
+  return name;
+}
+
+@interface OCFWebServerHeaderParser ()
+
+#pragma mark - Properties
+@property(nonatomic, readwrite) NSUInteger maximumHeaderSize;
+@property(nonatomic, readwrite) BOOL hasReceivedData;
+@property(nonatomic, copy, readwrite) NSString *method;
+@property(nonatomic, copy, readwrite) NSString *target;
+@property(nonatomic, copy, readwrite) NSString *path;
+@property(nonatomic, copy, readwrite) NSString *query;
+@property(nonatomic, copy, readwrite) NSDictionary *headers;
+@property(nonatomic, readwrite) NSUInteger majorVersion;
+@property(nonatomic, readwrite) NSUInteger minorVersion;
+
+@end
+
+@implementation OCFWebServerHeaderParser {
+  OCFWebServerHeaderParserState _state;
+  char* _buffer;  // Copy of the header bytes parsed so far when the header arrives in more than one piece
+  NSUInteger _length;
+  NSUInteger _capacity;
+  NSUInteger _methodStart;
+  NSUInteger _methodLength;
+  NSUInteger _targetStart;
+  NSUInteger _targetLength;
+  NSUInteger _versionStart;
+  NSUInteger _versionLength;
+  OCFWebServerHeaderField _fields[kMaxHeaderFields];
+  NSUInteger _fieldCount;
+  OCFWebServerHeaderField _field;  // Header line being parsed
+  BOOL _headerFieldsOnly;  // No request line
+}
+
+#pragma mark - Creating
+- (instancetype)initWithMaximumHeaderSize:(NSUInteger)maximumHeaderSize {
+  if((self = [super init])) {
+    self.maximumHeaderSize = maximumHeaderSize;
+    [self reset];
+  }
+  return self;
+}
+
+- (void)dealloc {
+  free(_buffer);
+}
+
+#pragma mark - Parsing
+- (void)reset {
+  _state = OCFWebServerHeaderParserStateRequestLineStart;
+  _length = 0;
+  _fieldCount = 0;
+  _headerFieldsOnly = NO;
+  self.hasReceivedData = NO;
+  self.method = nil;
+  self.target = nil;
+  self.path = nil;
+  self.query = nil;
+  self.headers = nil;
+  self.majorVersion = 0;
+  self.minorVersion = 0;
+}
+
+- (BOOL)_appendBytes:(const void*)bytes length:(NSUInteger)length {
+  if (_length + length > _capacity) {
+    NSUInteger capacity = MAX(_capacity, kInitialBufferCapacity);
+    while (capacity < _length + length) {
+      capacity *= 2;
+    }
+    char* buffer = realloc(_buffer, capacity);
+    if (buffer == NULL) {
+      return NO;
+    }
+    _buffer = buffer;
+    _capacity = capacity;
+  }
+  memcpy(_buffer + _length, bytes, length);
+  _length += length;
+  return YES;
+}
+
+- (BOOL)_addField:(OCFWebServerHeaderField)field {
+  if (_fieldCount == kMaxHeaderFields) {
+    return NO;
+  }
+  _fields[_fieldCount++] = field;
+  return YES;
+}
+
+- (OCFWebServerHeaderParserResult)parseBytes:(const void*)bytes length:(NSUInteger)length consumedLength:(NSUInteger*)consumedLength {
+  DCHECK(_state != OCFWebServerHeaderParserStateDone);
+  const unsigned char* input = bytes;
+  NSUInteger base = _length;  // Position of the first input byte in the buffer once it has been appended
+  NSUInteger index = 0;
+  OCFWebServerHeaderParserResult result = OCFWebServerHeaderParserResultIncomplete;
+  
+  if (length) {
+    self.hasReceivedData = YES;
+  }
+  while ((index < length) && (result == OCFWebServerHeaderParserResultIncomplete)) {
+    NSUInteger position = base + index;
+    if (position >= self.maximumHeaderSize) {
+      result = OCFWebServerHeaderParserResultTooLarge;
+      break;
+    }
+    unsigned char c = input[index];
+    switch (_state) {
+      
+      case OCFWebServerHeaderParserStateRequestLineStart:
+        if ((c == '\r') || (c == '\n')) {  // http://tools.ietf.org/html/rfc7230#section-3.5
+          break;
+        }
+        _methodStart = position;
+        _state = OCFWebServerHeaderParserStateMethod;
+        continue;
+        
+      case OCFWebServerHeaderParserStateMethod:
+        if (c == ' ') {
+          _methodLength = position - _methodStart;
+          _state = OCFWebServerHeaderParserStateTargetStart;
+        } else if (!_IsTokenCharacter(c)) {
+          result = OCFWebServerHeaderParserResultInvalid;
+        }
+        break;
+        
+      case OCFWebServerHeaderParserStateTargetStart:
+        if (c == ' ') {
+          break;
+        }
+        _targetStart = position;
+        _state = OCFWebServerHeaderParserStateTarget;
+        continue;
+        
+      case OCFWebServerHeaderParserStateTarget:
+        if (c == ' ') {
+          _targetLength = position - _targetStart;
+          _versionStart = position + 1;
+          _state = OCFWebServerHeaderParserStateVersion;
+        } else if ((c < 0x20) || (c == 0x7F)) {  // Also rejects HTTP/0.9 requests
+          result = OCFWebServerHeaderParserResultInvalid;
+        }
+        break;
+        
+      case OCFWebServerHeaderParserStateVersion:
+        if ((c == '\r') || (c == '\n')) {
+          _versionLength = position - _versionStart;
+          _state = (c == '\r' ? OCFWebServerHeaderParserStateVersionLF : OCFWebServerHeaderParserStateLineStart);
+        } else if (position - _versionStart >= 8) {
+          result = OCFWebServerHeaderParserResultInvalid;
+        }
+        break;
+        
+      case OCFWebServerHeaderParserStateVersionLF:
+      case OCFWebServerHeaderParserStateValueLF:
+        if (c != '\n') {
+          result = OCFWebServerHeaderParserResultInvalid;
+        } else if ((_state == OCFWebServerHeaderParserStateValueLF) && ![self _addField:_field]) {
+          result = OCFWebServerHeaderParserResultTooLarge;
+        } else {
+          _state = OCFWebServerHeaderParserStateLineStart;
+        }
+        break;
+        
+      case OCFWebServerHeaderParserStateLineStart:
+        if (c == '\r') {
+          _state = OCFWebServerHeaderParserStateFinalLF;
+        } else if (c == '\n') {
+          _state = OCFWebServerHeaderParserStateDone;
+        } else if (_IsTokenCharacter(c)) {  // Also rejects obsolete line folding
+          _field.nameStart = position;
+          _state = OCFWebServerHeaderParserStateName;
+        } else {
+          result = OCFWebServerHeaderParserResultInvalid;
+        }
+        break;
+        
+      case OCFWebServerHeaderParserStateName:
+        if (c == ':') {
+          _field.nameLength = position - _field.nameStart;
+          _state = OCFWebServerHeaderParserStateValueStart;
+        } else if (!_IsTokenCharacter(c)) {
+          result = OCFWebServerHeaderParserResultInvalid;
+        }
+        break;
+        
+      case OCFWebServerHeaderParserStateValueStart:
+        if ((c == ' ') || (c == '\t')) {
+          break;
+        }
+        _field.valueStart = position;
+        _state = OCFWebServerHeaderParserStateValue;
+        continue;
+        
+      case OCFWebServerHeaderParserStateValue:
+        if ((c == '\r') || (c == '\n')) {
+          _field.valueLength = position - _field.valueStart;
+          if (c == '\r') {
+            _state = OCFWebServerHeaderParserStateValueLF;
+          } else if ([self _addField:_field]) {
+            _state = OCFWebServerHeaderParserStateLineStart;
+          } else {
+            result = OCFWebServerHeaderParserResultTooLarge;
+          }
+        } else if (((c < 0x20) && (c != '\t')) || (c == 0x7F)) {
+          result = OCFWebServerHeaderParserResultInvalid;
+        }
+        break;
+        
+      case OCFWebServerHeaderParserStateFinalLF:
+        if (c == '\n') {
+          _state = OCFWebServerHeaderParserStateDone;
+        } else {
+          result = OCFWebServerHeaderParserResultInvalid;
+        }
+        break;
+        
+      case OCFWebServerHeaderParserStateDone:
+        DNOT_REACHED();
+        break;
+    }
+    index += 1;
+    if (_state == OCFWebServerHeaderParserStateDone) {
+      result = OCFWebServerHeaderParserResultComplete;
+    }
+  }
+  
+  const char* header = NULL;
+  if ((result == OCFWebServerHeaderParserResultComplete) && (base == 0)) {
+    header = (const char*)input;  // The whole header is in these bytes so the strings are created straight from them
+  } else if ((result == OCFWebServerHeaderParserResultIncomplete) || (result == OCFWebServerHeaderParserResultComplete)) {
+    if ([self _appendBytes:input length:index]) {  // Only a header split across pieces is copied
+      header = _buffer;
+    } else {
+      result = OCFWebServerHeaderParserResultTooLarge;
+    }
+  }
+  if (header && (result == OCFWebServerHeaderParserResultComplete) && ((!_headerFieldsOnly && ![self _finishRequestLineWithBytes:header]) || ![self _finishHeaderFieldsWithBytes:header])) {
+    result = OCFWebServerHeaderParserResultInvalid;
+  }
+  if (consumedLength) {
+    *consumedLength = index;
+  }
+  return result;
+}
+
+- (OCFWebServerHeaderParserResult)parseHeaderFieldBytes:(const void*)bytes length:(NSUInteger)length {
+  [self reset];
+  _headerFieldsOnly = YES;
+  _state = OCFWebServerHeaderParserStateLineStart;
+  NSUInteger consumedLength = 0;
+  OCFWebServerHeaderParserResult result = [self parseBytes:bytes length:length consumedLength:&consumedLength];
+  if ((result == OCFWebServerHeaderParserResultComplete) && (consumedLength < length)) {
+    result = OCFWebServerHeaderParserResultInvalid;
+  }
+  return result;
+}
+
+- (BOOL)_finishRequestLineWithBytes:(const char*)buffer {
+  
+  // Version: "HTTP/x.y"
+  const char* version = buffer + _versionStart;
+  if ((_versionLength != 8) || (strncmp(version, "HTTP/", 5) != 0) || !isdigit(version[5]) || (version[6] != '.') || !isdigit(version[7])) {
+    return NO;
+  }
+  self.majorVersion = version[5] - '0';
+  self.minorVersion = version[7] - '0';
+  
+  self.method = _MethodWithBytes(buffer + _methodStart, _methodLength);
+  if ((_methodLength == 0) || (_targetLength == 0)) {
+    return NO;
+  }
+  
+  // Target: origin-form "/path?query", absolute-form "http://host/path?query" or asterisk-form "*"
+  const char* target = buffer + _targetStart;
+  NSUInteger targetLength = _targetLength;
+  self.target = _StringWithBytes(target, targetLength);
+  const char* fragment = memchr(target, '#', targetLength);
+  if (fragment) {
+    targetLength = fragment - target;
+  }
+  const char* questionMark = memchr(target, '?', targetLength);
+  NSUInteger pathLength = (questionMark ? (NSUInteger)(questionMark - target) : targetLength);
+  const char* path = target;
+  if ((pathLength > 0) && (path[0] != '/') && (path[0] != '*')) {
+    const char* authority = NULL;
+    for (NSUInteger i = 0; i + 3 <= pathLength; ++i) {
+      if ((path[i] == ':') && (path[i + 1] == '/') && (path[i + 2] == '/')) {
+        authority = path + i + 3;
+        break;
+      }
+    }
+    const char* slash = (authority ? memchr(authority, '/', pathLength - (authority - path)) : NULL);
+    pathLength = (slash ? pathLength - (slash - path) : 0);
+    path = slash;
+  }
+  self.path = (pathLength ? _StringByRemovingPercentEscapes(path, pathLength) : nil);
+  if (questionMark) {
+    self.query = _StringWithBytes(questionMark + 1, targetLength - (questionMark + 1 - target));
+  }
+  return YES;
+}
+
+- (BOOL)_finishHeaderFieldsWithBytes:(const char*)buffer {
+  NSMutableDictionary* headers = [[NSMutableDictionary alloc] initWithCapacity:_fieldCount];
+  for (NSUInteger i = 0; i < _fieldCount; ++i) {
+    OCFWebServerHeaderField field = _fields[i];
+    while ((field.valueLength > 0) && ((buffer[field.valueStart + field.valueLength - 1] == ' ') || (buffer[field.valueStart + field.valueLength - 1] == '\t'))) {
+      field.valueLength -= 1;
+    }
+    NSString* name = _HeaderNameWithBytes(buffer + field.nameStart, field.nameLength);
+    NSString* value = _StringWithBytes(buffer + field.valueStart, field.valueLength);
+    NSString* previousValue = headers[name];
+    if ([name isEqualToString:@"Content-Length"]) {  // A body length clients and proxies could read differently allows request smuggling
+      if (!_IsValidContentLength(buffer + field.valueStart, field.valueLength) || (previousValue && ![previousValue isEqualToString:value])) {
+        return NO;
+      }
+      headers[name] = value;  // Identical values are only kept once
+      continue;
+    }
+    headers[name] = (previousValue ? [NSString stringWithFormat:@"%@, %@", previousValue, value] : value);  // http://tools.ietf.org/html/rfc7230#section-3.2.2
+  }
+  if (headers[@"Content-Length"] && headers[@"Transfer-Encoding"]) {  // http://tools.ietf.org/html/rfc7230#section-3.3.3
+    return NO;
+  }
+  self.headers = headers;
+  return YES;
+}
+
+@end
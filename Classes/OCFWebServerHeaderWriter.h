@@ -0,0 +1,54 @@
+/*
+ This file belongs to the OCFWebServer project. OCFWebServer is a fork of GCDWebServer (originally developed by
+ Pierre-Olivier Latour). We have forked GCDWebServer because we made extensive and incompatible changes to it.
+ To find out more have a look at README.md.
+ 
+ Copyright (c) 2013, Christian Kienle / chris@objective-cloud.com
+ All rights reserved.
+ 
+ Original Copyright Statement:
+ Copyright (c) 2012-2013, Pierre-Olivier Latour
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ * Neither the name of the <organization> nor the
+ names of its contributors may be used to endorse or promote products
+ derived from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import <Foundation/Foundation.h>
+
+// Serializes the status line and headers of a response directly into a growable byte buffer. Numbers are formatted
+// without going through NSString and the Date value is cached per thread for the current second, so building the
+// headers of a response takes a single allocation which is handed over to GCD without copying.
+@interface OCFWebServerHeaderWriter : NSObject
+
+#pragma mark - Creating
+- (instancetype)initWithStatusCode:(NSInteger)statusCode;  // Writes the "HTTP/1.1" status line
+
+#pragma mark - Writing
+- (void)appendBytes:(const void*)bytes length:(NSUInteger)length;  // Pre-serialized header lines (including "\r\n")
+- (void)appendHeader:(NSString*)name value:(NSString*)value;
+- (void)appendHeader:(const char*)name unsignedValue:(unsigned long long)value;  // e.g. Content-Length
+- (void)appendUnsignedValue:(unsigned long long)value;  // Digits only, to finish a line started with -appendBytes:length:
+- (void)appendDateHeader;
+- (dispatch_data_t)finish;  // Terminates the header - the writer must not be used afterwards
+
+@end
@@ -0,0 +1,252 @@
+/*
+ This file belongs to the OCFWebServer project. OCFWebServer is a fork of GCDWebServer (originally developed by
+ Pierre-Olivier Latour). We have forked GCDWebServer because we made extensive and incompatible changes to it.
+ To find out more have a look at README.md.
+ 
+ Copyright (c) 2013, Christian Kienle / chris@objective-cloud.com
+ All rights reserved.
+ 
+ Original Copyright Statement:
+ Copyright (c) 2012-2013, Pierre-Olivier Latour
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ * Neither the name of the <organization> nor the
+ names of its contributors may be used to endorse or promote products
+ derived from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import <time.h>
+
+#import "OCFWebServerPrivate.h"
+#import "OCFWebServerHeaderWriter.h"
+
+#define kInitialCapacity 512
+#define kDateLength 29  // "Sun, 06 Nov 1994 08:49:37 GMT"
+
+typedef struct {
+  time_t second;
+  char value[kDateLength];
+} OCFWebServerDateCache;
+
+static __thread OCFWebServerDateCache _dateCache = {-1, {0}};  // Per thread so refreshing it needs no lock
+
+static const char* _ReasonPhraseForStatusCode(NSInteger statusCode) {
+  switch (statusCode) {
+    case 100: return "Continue";
+    case 101: return "Switching Protocols";
+    case 200: return "OK";
+    case 201: return "Created";
+    case 202: return "Accepted";
+    case 203: return "Non-Authoritative Information";
+    case 204: return "No Content";
+    case 205: return "Reset Content";
+    case 206: return "Partial Content";
+    case 300: return "Multiple Choices";
+    case 301: return "Moved Permanently";
+    case 302: return "Found";
+    case 303: return "See Other";
+    case 304: return "Not Modified";
+    case 305: return "Use Proxy";
+    case 307: return "Temporary Redirect";
+    case 308: return "Permanent Redirect";
+    case 400: return "Bad Request";
+    case 401: return "Unauthorized";
+    case 402: return "Payment Required";
+    case 403: return "Forbidden";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 406: return "Not Acceptable";
+    case 407: return "Proxy Authentication Required";
+    case 408: return "Request Timeout";
+    case 409: return "Conflict";
+    case 410: return "Gone";
+    case 411: return "Length Required";
+    case 412: return "Precondition Failed";
+    case 413: return "Payload Too Large";
+    case 414: return "URI Too Long";
+    case 415: return "Unsupported Media Type";
+    case 416: return "Range Not Satisfiable";
+    case 417: return "Expectation Failed";
+    case 429: return "Too Many Requests";
+    case 431: return "Request Header Fields Too Large";
+    case 500: return "Internal Server Error";
+    case 501: return "Not Implemented";
+    case 502: return "Bad Gateway";
+    case 503: return "Service Unavailable";
+    case 504: return "Gateway Timeout";
+    case 505: return "HTTP Version Not Supported";
+  }
+  return "Unknown";
+}
+
+// Returns the number of digits written to buffer (which must hold at least 20 bytes)
+static NSUInteger _FormatUnsigned(unsigned long long value, char* buffer) {
+  char digits[20];
+  NSUInteger count = 0;
+  do {
+    digits[count++] = '0' + (char)(value % 10);
+    value /= 10;
+  } while (value);
+  for (NSUInteger i = 0; i < count; ++i) {
+    buffer[i] = digits[count - 1 - i];
+  }
+  return count;
+}
+
+static void _FormatTwoDigits(unsigned int value, char* buffer) {
+  buffer[0] = '0' + (char)(value / 10 % 10);
+  buffer[1] = '0' + (char)(value % 10);
+}
+
+// RFC 1123 date formatted by hand so it does not depend on the current locale
+static void _FormatDate(time_t second, char* buffer) {
+  static const char* days = "SunMonTueWedThuFriSat";
+  static const char* months = "JanFebMarAprMayJunJulAugSepOctNovDec";
+  struct tm tm;
+  gmtime_r(&second, &tm);
+  memcpy(buffer, days + 3 * tm.tm_wday, 3);
+  buffer[3] = ',';
+  buffer[4] = ' ';
+  _FormatTwoDigits(tm.tm_mday, buffer + 5);
+  buffer[7] = ' ';
+  memcpy(buffer + 8, months + 3 * tm.tm_mon, 3);
+  buffer[11] = ' ';
+  unsigned int year = tm.tm_year + 1900;
+  _FormatTwoDigits(year / 100, buffer + 12);
+  _FormatTwoDigits(year % 100, buffer + 14);
+  buffer[16] = ' ';
+  _FormatTwoDigits(tm.tm_hour, buffer + 17);
+  buffer[19] = ':';
+  _FormatTwoDigits(tm.tm_min, buffer + 20);
+  buffer[22] = ':';
+  _FormatTwoDigits(tm.tm_sec, buffer + 23);
+  memcpy(buffer + 25, " GMT", 4);
+}
+
+NSString* OCFWebServerFormatHTTPDate(time_t time) {
+  char buffer[kDateLength];
+  _FormatDate(time, buffer);
+  return [[NSString alloc] initWithBytes:buffer length:kDateLength encoding:NSASCIIStringEncoding];
+}
+
+@implementation OCFWebServerHeaderWriter {
+  char* _bytes;
+  NSUInteger _length;
+  NSUInteger _capacity;
+}
+
+#pragma mark - Creating
+- (instancetype)initWithStatusCode:(NSInteger)statusCode {
+  if((self = [super init])) {
+    _capacity = kInitialCapacity;
+    _bytes = malloc(_capacity);
+    DCHECK(_bytes);
+    DCHECK((statusCode >= 100) && (statusCode < 1000));
+    [self appendBytes:"HTTP/1.1 " length:9];
+    [self appendUnsignedValue:(unsigned long long)statusCode];
+    const char* reasonPhrase = _ReasonPhraseForStatusCode(statusCode);
+    [self appendBytes:" " length:1];
+    [self appendBytes:reasonPhrase length:strlen(reasonPhrase)];
+    [self appendBytes:"\r\n" length:2];
+  }
+  return self;
+}
+
+#pragma mark - Writing
+- (void)_reserveCapacity:(NSUInteger)length {
+  if (_length + length > _capacity) {
+    while (_length + length > _capacity) {
+      _capacity *= 2;
+    }
+    _bytes = realloc(_bytes, _capacity);
+    DCHECK(_bytes);
+  }
+}
+
+- (void)appendBytes:(const void*)bytes length:(NSUInteger)length {
+  DCHECK(_bytes);
+  [self _reserveCapacity:length];
+  memcpy(_bytes + _length, bytes, length);
+  _length += length;
+}
+
+// Writes the UTF-8 bytes of the string without creating an intermediary copy and replaces line breaks so a value can
+// never start a new header line
+- (void)_appendString:(NSString*)string {
+  NSUInteger maxLength = [string maxLengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+  [self _reserveCapacity:maxLength];
+  NSUInteger usedLength = 0;
+  [string getBytes:(_bytes + _length) maxLength:maxLength usedLength:&usedLength encoding:NSUTF8StringEncoding options:0 range:NSMakeRange(0, string.length) remainingRange:NULL];
+  for (NSUInteger i = _length; i < _length + usedLength; ++i) {
+    if ((_bytes[i] == '\r') || (_bytes[i] == '\n')) {
+      _bytes[i] = ' ';
+    }
+  }
+  _length += usedLength;
+}
+
+- (void)appendHeader:(NSString*)name value:(NSString*)value {
+  DCHECK(_bytes);
+  [self _appendString:name];
+  [self appendBytes:": " length:2];
+  [self _appendString:value];
+  [self appendBytes:"\r\n" length:2];
+}
+
+- (void)appendHeader:(const char*)name unsignedValue:(unsigned long long)value {
+  DCHECK(_bytes);
+  [self appendBytes:name length:strlen(name)];
+  [self appendBytes:": " length:2];
+  [self appendUnsignedValue:value];
+  [self appendBytes:"\r\n" length:2];
+}
+
+- (void)appendUnsignedValue:(unsigned long long)value {
+  DCHECK(_bytes);
+  [self _reserveCapacity:20];
+  _length += _FormatUnsigned(value, _bytes + _length);
+}
+
+- (void)appendDateHeader {
+  time_t now = time(NULL);
+  if (_dateCache.second != now) {
+    _FormatDate(now, _dateCache.value);
+    _dateCache.second = now;
+  }
+  [self appendBytes:"Date: " length:6];
+  [self appendBytes:_dateCache.value length:kDateLength];
+  [self appendBytes:"\r\n" length:2];
+}
+
+- (dispatch_data_t)finish {
+  DCHECK(_bytes);
+  [self appendBytes:"\r\n" length:2];
+  dispatch_data_t data = dispatch_data_create(_bytes, _length, kOCFWebServerGCDQueue, DISPATCH_DATA_DESTRUCTOR_FREE);
+  _bytes = NULL;
+  return data;
+}
+
+#pragma mark - NSObject
+- (void)dealloc {
+  free(_bytes);
+}
+
+@end
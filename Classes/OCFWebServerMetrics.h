@@ -0,0 +1,93 @@
+/*
+ This file belongs to the OCFWebServer project. OCFWebServer is a fork of GCDWebServer (originally developed by
+ Pierre-Olivier Latour). We have forked GCDWebServer because we made extensive and incompatible changes to it.
+ To find out more have a look at README.md.
+ 
+ Copyright (c) 2013, Christian Kienle / chris@objective-cloud.com
+ All rights reserved.
+ 
+ Original Copyright Statement:
+ Copyright (c) 2012-2013, Pierre-Olivier Latour
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ * Neither the name of the <organization> nor the
+ names of its contributors may be used to endorse or promote products
+ derived from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import <Foundation/Foundation.h>
+#import <time.h>
+
+// Monotonic clock all the durations are measured with (microseconds)
+static inline uint64_t OCFWebServerMetricsNow(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000 + (uint64_t)now.tv_nsec / 1000;
+}
+
+// Counter striped across cache lines so threads incrementing it concurrently do not contend. Reading it sums the stripes.
+@interface OCFWebServerCounter : NSObject
+@property(nonatomic, readonly) uint64_t value;
+- (void)increment;
+- (void)add:(uint64_t)value;
+@end
+
+// Lock-free log-linear histogram of durations in microseconds: 16 buckets per power of two so any value is known within
+// about 6%. Recording is a couple of relaxed atomic additions.
+@interface OCFWebServerHistogram : NSObject
+@property(nonatomic, readonly) uint64_t count;
+@property(nonatomic, readonly) uint64_t sum;
+- (void)recordValue:(uint64_t)value;
+- (uint64_t)valueAtPercentile:(double)percentile;  // e.g. 99.0 (returns 0 if empty)
+- (uint64_t)countOfValuesUpTo:(uint64_t)value;  // Only counts buckets entirely below value
+@end
+
+// Requests handled by one route, split by status class (1xx to 5xx)
+@interface OCFWebServerRouteMetrics : NSObject
+@property(nonatomic, copy, readonly) NSString *route;  // e.g. "GET /index.html" or "custom"
+@property(nonatomic, strong, readonly) OCFWebServerHistogram *handlerTime;  // From the process block starting to the response
+- (void)recordRequestWithStatusCode:(NSInteger)statusCode bytesRead:(uint64_t)bytesRead bytesWritten:(uint64_t)bytesWritten;
+- (uint64_t)requestCountForStatusClass:(NSUInteger)statusClass;  // 1 to 5
+- (uint64_t)bytesReadForStatusClass:(NSUInteger)statusClass;
+- (uint64_t)bytesWrittenForStatusClass:(NSUInteger)statusClass;
+@end
+
+// Metrics of a server, cheap enough to leave on in production (set the metrics of the server to nil to turn them off)
+@interface OCFWebServerMetrics : NSObject
+
+#pragma mark - Properties
+@property(nonatomic, strong, readonly) OCFWebServerCounter *connectionsAccepted;
+@property(nonatomic, strong, readonly) OCFWebServerCounter *connectionsRejected;  // Over maxConnections
+@property(nonatomic, strong, readonly) OCFWebServerCounter *connectionsClosed;
+@property(nonatomic, readonly) uint64_t openConnections;
+@property(nonatomic, strong, readonly) OCFWebServerHistogram *headerParseTime;  // From the first byte of the request to the end of its headers
+@property(nonatomic, strong, readonly) OCFWebServerHistogram *handlerQueueTime;  // Wait for a slot in the worker pool
+@property(nonatomic, strong, readonly) OCFWebServerHistogram *timeToFirstByte;  // From the end of the request headers to the first response bytes being sent
+@property(nonatomic, strong, readonly) OCFWebServerRouteMetrics *unmatchedRoute;  // Requests rejected before reaching a handler
+
+#pragma mark - Routes
+- (OCFWebServerRouteMetrics*)metricsForRoute:(NSString*)route;  // Created on first use
+- (NSArray*)allRouteMetrics;
+
+#pragma mark - Exporting
+- (NSString*)prometheusText;  // Text exposition format 0.0.4
+
+@end
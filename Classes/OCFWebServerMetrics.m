@@ -0,0 +1,360 @@
+/*
+ This file belongs to the OCFWebServer project. OCFWebServer is a fork of GCDWebServer (originally developed by
+ Pierre-Olivier Latour). We have forked GCDWebServer because we made extensive and incompatible changes to it.
+ To find out more have a look at README.md.
+ 
+ Copyright (c) 2013, Christian Kienle / chris@objective-cloud.com
+ All rights reserved.
+ 
+ Original Copyright Statement:
+ Copyright (c) 2012-2013, Pierre-Olivier Latour
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ * Neither the name of the <organization> nor the
+ names of its contributors may be used to endorse or promote products
+ derived from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import <stdatomic.h>
+
+#import "OCFWebServerPrivate.h"
+#import "OCFWebServerMetrics.h"
+
+#define kCounterStripes 16
+#define kSubBucketBits 4
+#define kSubBucketCount (1 << kSubBucketBits)
+#define kMaxExponent 40  // Values are clamped to about 12 days
+#define kBucketCount ((kMaxExponent - kSubBucketBits + 2) * kSubBucketCount)
+
+typedef struct {
+  _Atomic(uint64_t) value;
+  char padding[64 - sizeof(uint64_t)];  // One cache line per stripe
+} OCFWebServerCounterStripe;
+
+static _Atomic(unsigned int) _nextStripe = 0;
+static __thread unsigned int _threadStripe = 0;  // Stripe index + 1 of the current thread
+
+// Upper bounds of the buckets of the Prometheus histograms (microseconds)
+static const uint64_t _prometheusBounds[] = {500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000, 2500000, 5000000, 10000000};
+
+static inline unsigned int _CurrentStripe() {
+  if (_threadStripe == 0) {
+    _threadStripe = (atomic_fetch_add_explicit(&_nextStripe, 1, memory_order_relaxed) % kCounterStripes) + 1;
+  }
+  return _threadStripe - 1;
+}
+
+static inline NSUInteger _BucketIndex(uint64_t value) {
+  if (value < kSubBucketCount) {
+    return (NSUInteger)value;
+  }
+  unsigned int exponent = 63 - __builtin_clzll(value);
+  if (exponent > kMaxExponent) {
+    return kBucketCount - 1;
+  }
+  return (exponent - kSubBucketBits + 1) * kSubBucketCount + ((value >> (exponent - kSubBucketBits)) & (kSubBucketCount - 1));
+}
+
+static inline uint64_t _BucketUpperBound(NSUInteger index) {
+  if (index < kSubBucketCount) {
+    return index;
+  }
+  unsigned int exponent = (unsigned int)(index / kSubBucketCount) + kSubBucketBits - 1;
+  uint64_t lowerBound = (uint64_t)(kSubBucketCount + (index % kSubBucketCount)) << (exponent - kSubBucketBits);
+  return lowerBound + ((uint64_t)1 << (exponent - kSubBucketBits)) - 1;
+}
+
+static NSString* _EscapeLabelValue(NSString* value) {
+  value = [value stringByReplacingOccurrencesOfString:@"\\" withString:@"\\\\"];
+  value = [value stringByReplacingOccurrencesOfString:@"\"" withString:@"\\\""];
+  return [value stringByReplacingOccurrencesOfString:@"\n" withString:@"\\n"];
+}
+
+@implementation OCFWebServerCounter {
+  OCFWebServerCounterStripe* _stripes;
+}
+
+- (instancetype)init {
+  if((self = [super init])) {
+    _stripes = calloc(kCounterStripes, sizeof(OCFWebServerCounterStripe));
+  }
+  return self;
+}
+
+- (void)dealloc {
+  free(_stripes);
+}
+
+- (void)increment {
+  atomic_fetch_add_explicit(&_stripes[_CurrentStripe()].value, 1, memory_order_relaxed);
+}
+
+- (void)add:(uint64_t)value {
+  atomic_fetch_add_explicit(&_stripes[_CurrentStripe()].value, value, memory_order_relaxed);
+}
+
+- (uint64_t)value {
+  uint64_t value = 0;
+  for (NSUInteger i = 0; i < kCounterStripes; ++i) {
+    value += atomic_load_explicit(&_stripes[i].value, memory_order_relaxed);
+  }
+  return value;
+}
+
+@end
+
+@implementation OCFWebServerHistogram {
+  _Atomic(uint64_t)* _buckets;
+  _Atomic(uint64_t) _count;
+  _Atomic(uint64_t) _sum;
+}
+
+- (instancetype)init {
+  if((self = [super init])) {
+    _buckets = calloc(kBucketCount, sizeof(_Atomic(uint64_t)));
+  }
+  return self;
+}
+
+- (void)dealloc {
+  free(_buckets);
+}
+
+- (void)recordValue:(uint64_t)value {
+  atomic_fetch_add_explicit(&_buckets[_BucketIndex(value)], 1, memory_order_relaxed);
+  atomic_fetch_add_explicit(&_count, 1, memory_order_relaxed);
+  atomic_fetch_add_explicit(&_sum, value, memory_order_relaxed);
+}
+
+- (uint64_t)count {
+  return atomic_load_explicit(&_count, memory_order_relaxed);
+}
+
+- (uint64_t)sum {
+  return atomic_load_explicit(&_sum, memory_order_relaxed);
+}
+
+- (uint64_t)valueAtPercentile:(double)percentile {
+  uint64_t counts[kBucketCount];
+  uint64_t total = [self _getBucketCounts:counts];
+  if (total == 0) {
+    return 0;
+  }
+  uint64_t rank = (uint64_t)ceil(MIN(MAX(percentile, 0.0), 100.0) / 100.0 * total);
+  uint64_t cumulative = 0;
+  for (NSUInteger i = 0; i < kBucketCount; ++i) {
+    cumulative += counts[i];
+    if ((cumulative >= rank) && (counts[i] > 0)) {
+      return _BucketUpperBound(i);
+    }
+  }
+  return _BucketUpperBound(kBucketCount - 1);
+}
+
+- (uint64_t)countOfValuesUpTo:(uint64_t)value {
+  uint64_t count = 0;
+  for (NSUInteger i = 0; (i < kBucketCount) && (_BucketUpperBound(i) <= value); ++i) {
+    count += atomic_load_explicit(&_buckets[i], memory_order_relaxed);
+  }
+  return count;
+}
+
+// Returns the total of the copied counts, which may differ from the count while values are being recorded
+- (uint64_t)_getBucketCounts:(uint64_t*)counts {
+  uint64_t total = 0;
+  for (NSUInteger i = 0; i < kBucketCount; ++i) {
+    counts[i] = atomic_load_explicit(&_buckets[i], memory_order_relaxed);
+    total += counts[i];
+  }
+  return total;
+}
+
+- (void)_appendPrometheusSamplesWithName:(NSString*)name labels:(NSString*)labels toString:(NSMutableString*)string {
+  uint64_t counts[kBucketCount];
+  uint64_t total = [self _getBucketCounts:counts];
+  NSString* separator = (labels.length ? @"," : @"");
+  uint64_t cumulative = 0;
+  NSUInteger index = 0;
+  for (NSUInteger i = 0; i < sizeof(_prometheusBounds) / sizeof(uint64_t); ++i) {
+    for (; (index < kBucketCount) && (_BucketUpperBound(index) <= _prometheusBounds[i]); ++index) {
+      cumulative += counts[index];
+    }
+    [string appendFormat:@"%@_bucket{%@%@le=\"%g\"} %llu\n", name, labels, separator, (double)_prometheusBounds[i] / 1000000.0, cumulative];
+  }
+  [string appendFormat:@"%@_bucket{%@%@le=\"+Inf\"} %llu\n", name, labels, separator, total];
+  [string appendFormat:@"%@_sum%@ %g\n", name, (labels.length ? [NSString stringWithFormat:@"{%@}", labels] : @""), (double)self.sum / 1000000.0];
+  [string appendFormat:@"%@_count%@ %llu\n", name, (labels.length ? [NSString stringWithFormat:@"{%@}", labels] : @""), total];
+}
+
+@end
+
+@interface OCFWebServerRouteMetrics ()
+@property(nonatomic, copy, readwrite) NSString *route;
+@property(nonatomic, strong, readwrite) OCFWebServerHistogram *handlerTime;
+@property(nonatomic, copy) NSArray *requestCounters;  // Indexed by status class - 1
+@property(nonatomic, copy) NSArray *bytesReadCounters;
+@property(nonatomic, copy) NSArray *bytesWrittenCounters;
+@end
+
+@implementation OCFWebServerRouteMetrics
+
+static NSArray* _CreateStatusClassCounters() {
+  return @[[OCFWebServerCounter new], [OCFWebServerCounter new], [OCFWebServerCounter new], [OCFWebServerCounter new], [OCFWebServerCounter new]];
+}
+
+- (instancetype)initWithRoute:(NSString*)route {
+  if((self = [super init])) {
+    self.route = route;
+    self.handlerTime = [[OCFWebServerHistogram alloc] init];
+    self.requestCounters = _CreateStatusClassCounters();
+    self.bytesReadCounters = _CreateStatusClassCounters();
+    self.bytesWrittenCounters = _CreateStatusClassCounters();
+  }
+  return self;
+}
+
+- (void)recordRequestWithStatusCode:(NSInteger)statusCode bytesRead:(uint64_t)bytesRead bytesWritten:(uint64_t)bytesWritten {
+  NSUInteger index = (NSUInteger)MIN(MAX(statusCode / 100, 1), 5) - 1;
+  [(OCFWebServerCounter*)self.requestCounters[index] increment];
+  [(OCFWebServerCounter*)self.bytesReadCounters[index] add:bytesRead];
+  [(OCFWebServerCounter*)self.bytesWrittenCounters[index] add:bytesWritten];
+}
+
+- (uint64_t)requestCountForStatusClass:(NSUInteger)statusClass {
+  DCHECK((statusClass >= 1) && (statusClass <= 5));
+  return [(OCFWebServerCounter*)self.requestCounters[statusClass - 1] value];
+}
+
+- (uint64_t)bytesReadForStatusClass:(NSUInteger)statusClass {
+  DCHECK((statusClass >= 1) && (statusClass <= 5));
+  return [(OCFWebServerCounter*)self.bytesReadCounters[statusClass - 1] value];
+}
+
+- (uint64_t)bytesWrittenForStatusClass:(NSUInteger)statusClass {
+  DCHECK((statusClass >= 1) && (statusClass <= 5));
+  return [(OCFWebServerCounter*)self.bytesWrittenCounters[statusClass - 1] value];
+}
+
+@end
+
+@interface OCFWebServerMetrics ()
+@property(nonatomic, strong, readwrite) OCFWebServerCounter *connectionsAccepted;
+@property(nonatomic, strong, readwrite) OCFWebServerCounter *connectionsRejected;
+@property(nonatomic, strong, readwrite) OCFWebServerCounter *connectionsClosed;
+@property(nonatomic, strong, readwrite) OCFWebServerHistogram *headerParseTime;
+@property(nonatomic, strong, readwrite) OCFWebServerHistogram *handlerQueueTime;
+@property(nonatomic, strong, readwrite) OCFWebServerHistogram *timeToFirstByte;
+@property(nonatomic, strong, readwrite) OCFWebServerRouteMetrics *unmatchedRoute;
+@property(nonatomic, strong) NSMutableDictionary *routes;
+@end
+
+@implementation OCFWebServerMetrics
+
+#pragma mark - Creating
+- (instancetype)init {
+  if((self = [super init])) {
+    self.connectionsAccepted = [[OCFWebServerCounter alloc] init];
+    self.connectionsRejected = [[OCFWebServerCounter alloc] init];
+    self.connectionsClosed = [[OCFWebServerCounter alloc] init];
+    self.headerParseTime = [[OCFWebServerHistogram alloc] init];
+    self.handlerQueueTime = [[OCFWebServerHistogram alloc] init];
+    self.timeToFirstByte = [[OCFWebServerHistogram alloc] init];
+    self.unmatchedRoute = [[OCFWebServerRouteMetrics alloc] initWithRoute:@"unmatched"];
+    self.routes = [[NSMutableDictionary alloc] init];
+  }
+  return self;
+}
+
+#pragma mark - Properties
+- (uint64_t)openConnections {
+  uint64_t closed = self.connectionsClosed.value;  // Read first so the difference cannot go negative
+  uint64_t accepted = self.connectionsAccepted.value;
+  return (accepted > closed ? accepted - closed : 0);
+}
+
+#pragma mark - Routes
+- (OCFWebServerRouteMetrics*)metricsForRoute:(NSString*)route {
+  @synchronized(self.routes) {
+    OCFWebServerRouteMetrics* metrics = self.routes[route];
+    if (metrics == nil) {
+      metrics = [[OCFWebServerRouteMetrics alloc] initWithRoute:route];
+      self.routes[route] = metrics;
+    }
+    return metrics;
+  }
+}
+
+- (NSArray*)allRouteMetrics {
+  NSMutableArray* routes = nil;
+  @synchronized(self.routes) {
+    routes = [[self.routes.allValues sortedArrayUsingComparator:^NSComparisonResult(OCFWebServerRouteMetrics* metrics1, OCFWebServerRouteMetrics* metrics2) {
+      return [metrics1.route compare:metrics2.route];
+    }] mutableCopy];
+  }
+  [routes addObject:self.unmatchedRoute];
+  return routes;
+}
+
+#pragma mark - Exporting
+static void _AppendHeader(NSMutableString* string, NSString* name, NSString* type, NSString* help) {
+  [string appendFormat:@"# HELP %@ %@\n# TYPE %@ %@\n", name, help, name, type];
+}
+
+- (NSString*)prometheusText {
+  NSMutableString* string = [[NSMutableString alloc] initWithCapacity:16 * 1024];
+  _AppendHeader(string, @"ocfwebserver_connections_accepted_total", @"counter", @"Connections accepted.");
+  [string appendFormat:@"ocfwebserver_connections_accepted_total %llu\n", self.connectionsAccepted.value];
+  _AppendHeader(string, @"ocfwebserver_connections_rejected_total", @"counter", @"Connections refused with 503 over the connection limit.");
+  [string appendFormat:@"ocfwebserver_connections_rejected_total %llu\n", self.connectionsRejected.value];
+  _AppendHeader(string, @"ocfwebserver_connections_open", @"gauge", @"Connections currently open.");
+  [string appendFormat:@"ocfwebserver_connections_open %llu\n", self.openConnections];
+  
+  _AppendHeader(string, @"ocfwebserver_header_parse_seconds", @"histogram", @"Time from the first byte of a request to the end of its headers.");
+  [self.headerParseTime _appendPrometheusSamplesWithName:@"ocfwebserver_header_parse_seconds" labels:@"" toString:string];
+  _AppendHeader(string, @"ocfwebserver_handler_queue_seconds", @"histogram", @"Time spent waiting for a worker pool slot.");
+  [self.handlerQueueTime _appendPrometheusSamplesWithName:@"ocfwebserver_handler_queue_seconds" labels:@"" toString:string];
+  _AppendHeader(string, @"ocfwebserver_time_to_first_byte_seconds", @"histogram", @"Time from the end of the request headers to the first response bytes being sent.");
+  [self.timeToFirstByte _appendPrometheusSamplesWithName:@"ocfwebserver_time_to_first_byte_seconds" labels:@"" toString:string];
+  
+  NSArray* routes = [self allRouteMetrics];
+  _AppendHeader(string, @"ocfwebserver_handler_seconds", @"histogram", @"Time from the process block starting to the response.");
+  for (OCFWebServerRouteMetrics* route in routes) {
+    NSString* labels = [NSString stringWithFormat:@"route=\"%@\"", _EscapeLabelValue(route.route)];
+    [route.handlerTime _appendPrometheusSamplesWithName:@"ocfwebserver_handler_seconds" labels:labels toString:string];
+  }
+  NSString* names[] = {@"ocfwebserver_requests_total", @"ocfwebserver_request_bytes_total", @"ocfwebserver_response_bytes_total"};
+  NSString* helps[] = {@"Requests completed.", @"Bytes received for requests.", @"Bytes sent for responses."};
+  for (NSUInteger i = 0; i < 3; ++i) {
+    _AppendHeader(string, names[i], @"counter", helps[i]);
+    for (OCFWebServerRouteMetrics* route in routes) {
+      NSString* escapedRoute = _EscapeLabelValue(route.route);
+      for (NSUInteger statusClass = 1; statusClass <= 5; ++statusClass) {
+        uint64_t value = (i == 0 ? [route requestCountForStatusClass:statusClass] : (i == 1 ? [route bytesReadForStatusClass:statusClass] : [route bytesWrittenForStatusClass:statusClass]));
+        if (value) {
+          [string appendFormat:@"%@{route=\"%@\",status=\"%lux\"} %llu\n", names[i], escapedRoute, (unsigned long)statusClass, value];
+        }
+      }
+    }
+  }
+  return string;
+}
+
+@end
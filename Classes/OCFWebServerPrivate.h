@@ -33,7 +33,15 @@
  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#import "OCFWebServerAccessLog.h"
 #import "OCFWebServerConnection.h"
+#import "OCFWebServerFileCache.h"
+#import "OCFWebServerMetrics.h"
+#import "OCFWebServerRequest.h"
+#import "OCFWebServerResponse.h"
+#import "OCFWebServerRouter.h"
+#import "OCFWebServerTimerWheel.h"
+#import "OCFWebServerWorkerPool.h"
 
 #ifdef __GCDWEBSERVER_LOGGING_HEADER__
 
@@ -42,27 +50,26 @@
 
 #else
 
-static inline void __LogMessage(long level, NSString* format, ...) {
-  static const char* levelNames[] = {"DEBUG", "VERBOSE", "INFO", "WARNING", "ERROR", "EXCEPTION"};
-  static long minLevel = -1;
-  if (minLevel < 0) {
-    const char* logLevel = getenv("logLevel");
-    minLevel = logLevel ? atoi(logLevel) : 0;
-  }
-  if (level >= minLevel) {
-    va_list arguments;
-    va_start(arguments, format);
-    NSString* message = [[NSString alloc] initWithFormat:format arguments:arguments];
-    va_end(arguments);
-    printf("[%s] %s\n", levelNames[level], [message UTF8String]);
-  }
-}
+extern long OCFWebServerLogLevel;  // Messages below are dropped before being formatted ("logLevel" environment variable, 0 by default)
+void OCFWebServerLogMessage(long level, NSString* format, ...);  // Formats on the calling thread and prints on a background queue
+
+// Define OCFWEBSERVER_MINIMUM_LOG_LEVEL as a preprocessor constant to compile out the levels below it
+#ifndef OCFWEBSERVER_MINIMUM_LOG_LEVEL
+#define OCFWEBSERVER_MINIMUM_LOG_LEVEL 0
+#endif
+
+#define __LOG_MESSAGE(__LEVEL__, ...) \
+  do { \
+    if (((__LEVEL__) >= OCFWEBSERVER_MINIMUM_LOG_LEVEL) && ((__LEVEL__) >= OCFWebServerLogLevel)) { \
+      OCFWebServerLogMessage(__LEVEL__, __VA_ARGS__); \
+    } \
+  } while (0)
 
-#define LOG_VERBOSE(...) __LogMessage(1, __VA_ARGS__)
-#define LOG_INFO(...) __LogMessage(2, __VA_ARGS__)
-#define LOG_WARNING(...) __LogMessage(3, __VA_ARGS__)
-#define LOG_ERROR(...) __LogMessage(4, __VA_ARGS__)
-#define LOG_EXCEPTION(__EXCEPTION__) __LogMessage(5, @"%@", __EXCEPTION__)
+#define LOG_VERBOSE(...) __LOG_MESSAGE(1, __VA_ARGS__)
+#define LOG_INFO(...) __LOG_MESSAGE(2, __VA_ARGS__)
+#define LOG_WARNING(...) __LOG_MESSAGE(3, __VA_ARGS__)
+#define LOG_ERROR(...) __LOG_MESSAGE(4, __VA_ARGS__)
+#define LOG_EXCEPTION(__EXCEPTION__) __LOG_MESSAGE(5, @"%@", __EXCEPTION__)
 
 #ifdef NDEBUG
 
@@ -79,7 +86,7 @@ static inline void __LogMessage(long level, NSString* format, ...) {
     } \
   } while (0)
 #define DNOT_REACHED() abort()
-#define LOG_DEBUG(...) __LogMessage(0, __VA_ARGS__)
+#define LOG_DEBUG(...) __LOG_MESSAGE(0, __VA_ARGS__)
 
 #endif
 
@@ -93,8 +100,7 @@ extern "C" {
 #endif
 
 NSString* OCFWebServerGetMimeTypeForExtension(NSString* extension);
-NSString* OCFWebServerUnescapeURLString(NSString* string);
-NSDictionary* OCFWebServerParseURLEncodedForm(NSString* form);
+NSString* OCFWebServerFormatHTTPDate(time_t time);  // RFC 1123 e.g. "Sun, 06 Nov 1994 08:49:37 GMT"
 
 #ifdef __cplusplus
 }
@@ -109,13 +115,46 @@ NSDictionary* OCFWebServerParseURLEncodedForm(NSString* form);
 
 #pragma mark - Properties
 @property (nonatomic, copy, readonly) NSArray* handlers;
+@property (nonatomic, strong, readonly) OCFWebServerRouter* router;  // Only valid while running
+@property (nonatomic, copy, readonly) NSData* serverHeaderData;  // Pre-serialized "Server" header line (only valid while running)
+@property (nonatomic, strong, readonly) OCFWebServerTimerWheel* timerWheel;  // Drives the timeouts of all connections (created on first start)
 @property (nonatomic, assign, readwrite) NSUInteger maxPendingConnections;
 @property (assign, readwrite, setter = setHeaderLoggingEnabled:) BOOL headerLoggingEnabled;
 
 @end
 
+@interface OCFWebServerDataResponse (Private)
+- (NSData*)_getZeroCopyData;  // Only valid between -open and -close (returns nil if the body must be read through -read:maxLength:)
+@end
+
+@interface OCFWebServerFileResponse (Private)
++ (OCFWebServerResponse*)_responseWithCacheEntry:(OCFWebServerFileCacheEntry*)fileEntry gzipEntry:(OCFWebServerFileCacheEntry*)gzipEntry isAttachment:(BOOL)attachment requestHeaders:(NSDictionary*)headers;
+- (instancetype)_initWithCacheEntry:(OCFWebServerFileCacheEntry*)entry contentType:(NSString*)contentType byteRanges:(NSArray*)ranges;
+- (BOOL)_getZeroCopyFile:(int*)file offset:(off_t*)offset length:(off_t*)length;  // Only valid between -open and -close (returns NO if the body must be read through -read:maxLength:)
+@end
+
+typedef void (^OCFWebServerBodyReaderBlock)(OCFWebServerBodyReadBlock block);
+
+@interface OCFWebServerStreamingRequest (Private)
+- (void)_setBodyReader:(OCFWebServerBodyReaderBlock)reader;  // Set by the connection before the process block runs
+- (NSData*)_takeReceivedData;  // Body bytes written since the previous call (empty if none)
+@end
+
+typedef NS_ENUM(NSUInteger, OCFWebServerRouteType) {
+  OCFWebServerRouteTypeCustom,  // Only the match block knows which requests it accepts
+  OCFWebServerRouteTypePath,
+  OCFWebServerRouteTypeBasePath,
+  OCFWebServerRouteTypePathRegex
+};
+
 @interface OCFWebServerHandler : NSObject
 @property(nonatomic, copy, readonly) OCFWebServerMatchBlock matchBlock;
 @property(nonatomic, copy, readonly) OCFWebServerProcessBlock processBlock;
-- (id)initWithMatchBlock:(OCFWebServerMatchBlock)matchBlock processBlock:(OCFWebServerProcessBlock)processBlock;
+@property(nonatomic, strong, readonly) OCFWebServerWorkerPool* workerPool;  // nil for the default worker pool of the server
+@property(nonatomic, strong, readonly) OCFWebServerRouteMetrics* routeMetrics;  // Assigned when the server starts (nil without metrics)
+@property(nonatomic, assign, readonly) OCFWebServerRouteType routeType;
+@property(nonatomic, copy, readonly) NSString* method;  // nil for custom routes
+@property(nonatomic, copy, readonly) NSString* pattern;  // Path, base path or regular expression (nil for custom routes)
+- (id)initWithMatchBlock:(OCFWebServerMatchBlock)matchBlock processBlock:(OCFWebServerProcessBlock)processBlock workerPool:(OCFWebServerWorkerPool*)workerPool;
+- (id)initWithRouteType:(OCFWebServerRouteType)routeType method:(NSString*)method pattern:(NSString*)pattern matchBlock:(OCFWebServerMatchBlock)matchBlock processBlock:(OCFWebServerProcessBlock)processBlock workerPool:(OCFWebServerWorkerPool*)workerPool;
 @end
@@ -47,7 +47,8 @@
 @property(nonatomic, copy, readonly) NSString *path;
 @property(nonatomic, copy, readonly) NSDictionary *query;  // May be nil
 @property(nonatomic, copy, readonly) NSString *contentType;  // Automatically parsed from headers (nil if request has no body)
-@property(nonatomic, readonly) NSUInteger contentLength;  // Automatically parsed from headers
+@property(nonatomic, readonly) NSUInteger contentLength;  // Automatically parsed from headers (0 if the body uses chunked transfer encoding)
+@property(nonatomic, readonly) BOOL usesChunkedTransferEncoding;  // Automatically parsed from headers
 
 #pragma mark - Creating
 - (instancetype)initWithMethod:(NSString *)method URL:(NSURL *)url headers:(NSDictionary *)headers path:(NSString *)path query:(NSDictionary *)query;
@@ -79,6 +80,18 @@
 
 @end
 
+typedef void(^OCFWebServerBodyReadBlock)(NSData* data);  // Empty data at the end of the body, nil if it could not be received
+
+// The process block runs as soon as the headers are received and pulls the body from the socket piece by piece:
+// nothing more is read until the handler asks for it again, so the client is held back while the handler catches up.
+// Responding before the end of the body is fine (the connection is then closed after the response).
+@interface OCFWebServerStreamingRequest : OCFWebServerRequest
+
+#pragma mark - Reading
+- (void)readBodyWithCompletionBlock:(OCFWebServerBodyReadBlock)block;  // Block is called on the connection's queue with the next piece of the body (one read at a time)
+
+@end
+
 @interface OCFWebServerURLEncodedFormRequest : OCFWebServerDataRequest
 
 #pragma mark - Properties
@@ -115,7 +128,8 @@
 @interface OCFWebServerMultiPartFormRequest : OCFWebServerRequest
 
 #pragma mark - Properties
-@property (nonatomic, copy, readonly) NSData *data;  // Only valid after open / write / close sequence
+@property (nonatomic, assign) BOOL keepsData;  // Default is YES - set to NO for every request by keepsMultiPartData on OCFWebServer, or by a subclass in its initializer, to not buffer the raw body in memory
+@property (nonatomic, copy, readonly) NSData *data;  // Only valid after open / write / close sequence if keepsData is YES
 @property (nonatomic, copy, readonly) NSDictionary *arguments;  // Only valid after open / write / close sequence
 @property (nonatomic, copy, readonly) NSDictionary *files;  // Only valid after open / write / close sequence
 
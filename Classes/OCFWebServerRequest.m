@@ -34,9 +34,12 @@
  */
 
 #import "OCFWebServerPrivate.h"
+#import "OCFWebServerFormDecoder.h"
+#import "OCFWebServerHeaderParser.h"
 #import "OCFWebServerRequest.h"
 
 #define kMultiPartBufferSize (256 * 1024)
+#define kMultiPartMaxHeaderSize (16 * 1024)
 
 typedef NS_ENUM(NSUInteger, OCFWebServerParserState) {
   OCFWebServerParserStateUndefined,
@@ -46,9 +49,41 @@ typedef NS_ENUM(NSUInteger, OCFWebServerParserState) {
   OCFWebServerParserStateEnd
 };
 
-static NSData* _newlineData = nil;
-static NSData* _newlinesData = nil;
-static NSData* _dashNewlineData = nil;
+static void _InitializeSkipTable(const UInt8* needle, NSUInteger needleLength, NSUInteger* skipTable) {
+  for (NSUInteger i = 0; i < 256; ++i) {
+    skipTable[i] = needleLength;
+  }
+  for (NSUInteger i = 0; i + 1 < needleLength; ++i) {
+    skipTable[needle[i]] = needleLength - 1 - i;
+  }
+}
+
+// Boyer-Moore-Horspool search using a table from _InitializeSkipTable()
+static NSUInteger _FindDelimiter(const UInt8* bytes, NSUInteger length, const UInt8* needle, NSUInteger needleLength, const NSUInteger* skipTable) {
+  if (length < needleLength) {
+    return NSNotFound;
+  }
+  NSUInteger last = needleLength - 1;
+  NSUInteger offset = 0;
+  while (offset <= length - needleLength) {
+    UInt8 byte = bytes[offset + last];
+    if ((byte == needle[last]) && (memcmp(bytes + offset, needle, last) == 0)) {
+      return offset;
+    }
+    offset += skipTable[byte];
+  }
+  return NSNotFound;
+}
+
+// Returns the location of "\r\n\r\n"
+static NSUInteger _FindHeadersEnd(const UInt8* bytes, NSUInteger length, NSUInteger start) {
+  for (NSUInteger i = start; i + 3 < length; ++i) {
+    if ((bytes[i] == '\r') && (bytes[i + 1] == '\n') && (bytes[i + 2] == '\r') && (bytes[i + 3] == '\n')) {
+      return i;
+    }
+  }
+  return NSNotFound;
+}
 
 static NSString* _ExtractHeaderParameter(NSString* header, NSString* attribute) {
   NSString* value = nil;
@@ -76,6 +111,24 @@ static NSStringEncoding _StringEncodingFromCharset(NSString* charset) {
   return (encoding != kCFStringEncodingInvalidId ? encoding : NSUTF8StringEncoding);
 }
 
+// http://tools.ietf.org/html/rfc7230#section-3.3.2: only digits, which rules out signs, whitespace and lists of values
+static BOOL _ParseContentLength(NSString* string, NSUInteger* length) {
+  NSUInteger count = string.length;
+  if ((count == 0) || (count > 18)) {  // Cannot overflow
+    return NO;
+  }
+  NSUInteger value = 0;
+  for (NSUInteger i = 0; i < count; ++i) {
+    unichar c = [string characterAtIndex:i];
+    if ((c < '0') || (c > '9')) {
+      return NO;
+    }
+    value = value * 10 + (c - '0');
+  }
+  *length = value;
+  return YES;
+}
+
 @interface OCFWebServerRequest ()
 
 #pragma mark - Properties
@@ -86,6 +139,7 @@ static NSStringEncoding _StringEncodingFromCharset(NSString* charset) {
 @property(nonatomic, copy, readwrite) NSDictionary* query;  // May be nil
 @property(nonatomic, copy, readwrite) NSString* contentType;
 @property(nonatomic, readwrite) NSUInteger contentLength;  // Automatically parsed from headers
+@property(nonatomic, readwrite) BOOL usesChunkedTransferEncoding;
 
 @end
 
@@ -101,19 +155,29 @@ static NSStringEncoding _StringEncodingFromCharset(NSString* charset) {
     self.query = query;
     
     self.contentType = self.headers[@"Content-Type"];
+    NSString *transferEncoding = self.headers[@"Transfer-Encoding"];
     NSString *contentLengthString = self.headers[@"Content-Length"];
-    if(contentLengthString == nil) {
-      LOG_DEBUG(@"Request has no content length.");
-      // FIXME: Check RFC. This does not seem to be correct.
-      //        As far I know it is okay for requests to not
-      //        have a content length header value at all.
+    if(transferEncoding && contentLengthString) {
+      // http://tools.ietf.org/html/rfc7230#section-3.3.3: the two may be used to smuggle a request past a proxy
+      LOG_ERROR(@"Request has both 'Transfer-Encoding' and 'Content-Length' headers");
+      return nil;
+    }
+    if(transferEncoding && ([transferEncoding caseInsensitiveCompare:@"identity"] != NSOrderedSame)) {
+      if([transferEncoding rangeOfString:@"chunked" options:NSCaseInsensitiveSearch].location == NSNotFound) {
+        LOG_ERROR(@"Unsupported 'Transfer-Encoding' header value: %@", transferEncoding);
+        return nil;
+      }
+      self.usesChunkedTransferEncoding = YES;
       self.contentLength = 0;
+      if(self.contentType == nil) {
+        self.contentType = kOCFWebServerDefaultMimeType;
+      }
+    } else if(contentLengthString == nil) {
+      self.contentLength = 0;  // http://tools.ietf.org/html/rfc7230#section-3.3.3: a request without either has no body
     } else {
-      // FIXME: Validate contents of contentLengthString: A malformed content length value
-      //        may have bad side effects.
-      NSInteger length = [contentLengthString integerValue];
-      if(length < 0) {
-        DNOT_REACHED();
+      NSUInteger length = 0;
+      if(!_ParseContentLength(contentLengthString, &length)) {
+        LOG_ERROR(@"Invalid 'Content-Length' header value: %@", contentLengthString);
         return nil;
       }
       self.contentLength = length;
@@ -244,6 +308,66 @@ static NSStringEncoding _StringEncodingFromCharset(NSString* charset) {
 
 @end
 
+@interface OCFWebServerStreamingRequest ()
+
+#pragma mark - Properties
+@property (nonatomic, copy) OCFWebServerBodyReaderBlock bodyReader;
+@property (nonatomic, strong) NSMutableData *receivedData;  // Written by the connection and not handed to the handler yet
+
+@end
+
+@implementation OCFWebServerStreamingRequest
+
+#pragma mark - Reading
+- (void)readBodyWithCompletionBlock:(OCFWebServerBodyReadBlock)block {
+  OCFWebServerBodyReaderBlock reader = self.bodyReader;
+  if (reader) {
+    reader(block);
+  } else {
+    LOG_ERROR(@"Request body can only be read from the process block");
+    dispatch_async(kOCFWebServerGCDQueue, ^{
+      block(nil);
+    });
+  }
+}
+
+#pragma mark - OCFWebServerRequest
+- (BOOL)open {
+  DCHECK(self.receivedData == nil);
+  self.receivedData = [[NSMutableData alloc] init];
+  return YES;
+}
+
+- (NSInteger)write:(const void*)buffer maxLength:(NSUInteger)length {
+  DCHECK(self.receivedData != nil);
+  [self.receivedData appendBytes:buffer length:length];
+  return length;
+}
+
+- (BOOL)close {
+  DCHECK(self.receivedData != nil);
+  return YES;
+}
+
+@end
+
+@implementation OCFWebServerStreamingRequest (Private)
+
+- (void)_setBodyReader:(OCFWebServerBodyReaderBlock)reader {
+  self.bodyReader = reader;
+}
+
+- (NSData*)_takeReceivedData {
+  NSData* data = self.receivedData;
+  if (data.length == 0) {
+    return data;
+  }
+  self.receivedData = [[NSMutableData alloc] init];
+  return data;
+}
+
+@end
+
 @interface OCFWebServerURLEncodedFormRequest ()
 
 #pragma mark - Properties
@@ -265,10 +389,9 @@ static NSStringEncoding _StringEncodingFromCharset(NSString* charset) {
   }
   
   NSString *charset = _ExtractHeaderParameter(self.contentType, @"charset");
-  NSString *string = [[NSString alloc] initWithData:self.data encoding:_StringEncodingFromCharset(charset)];
-  self.arguments = OCFWebServerParseURLEncodedForm(string);
+  self.arguments = [[OCFWebServerFormDictionary alloc] initWithData:self.data encoding:_StringEncodingFromCharset(charset)];  // Decoded on first access
   
-  return (self.arguments ? YES : NO);
+  return YES;
 }
 
 @end
@@ -364,11 +487,12 @@ static NSStringEncoding _StringEncodingFromCharset(NSString* charset) {
 #pragma mark - Properties
 @property (nonatomic, copy, readwrite) NSDictionary *arguments;
 @property (nonatomic, copy, readwrite) NSDictionary *files;
-@property (nonatomic, copy, readwrite) NSData *parserData;
-@property (nonatomic, copy) NSData *boundary;
+@property (nonatomic, copy) NSData *boundary;  // Delimiter i.e. "\r\n--" followed by the boundary parameter
 @property (nonatomic, assign) OCFWebServerParserState parserState;
+@property (nonatomic, strong) OCFWebServerHeaderParser *partHeaderParser;
 @property (nonatomic, copy) NSString *controlName;
 @property (nonatomic, copy) NSString *fileName;
+@property (nonatomic, copy) NSString *partContentType;
 @property (nonatomic, copy) NSString *tmpPath;
 @property (nonatomic, assign) int tmpFile;
 @property (nonatomic, copy, readwrite) NSData *data;
@@ -378,8 +502,11 @@ static NSStringEncoding _StringEncodingFromCharset(NSString* charset) {
 @implementation OCFWebServerMultiPartFormRequest {
   NSMutableDictionary *_arguments;
   NSMutableDictionary *_files;
-  NSMutableData *_parserData;
+  NSMutableData *_parserData;  // Unconsumed bytes only (at most a partial delimiter or the headers of a part)
+  NSMutableData *_partData;  // Content of the current argument part
   NSMutableData* _data;
+  NSUInteger _searchOffset;  // Where to resume looking for the end of the part headers
+  NSUInteger _boundarySkipTable[256];
 }
 
 #pragma mark - Properties
@@ -399,14 +526,6 @@ static NSStringEncoding _StringEncodingFromCharset(NSString* charset) {
   return [_files copy];
 }
 
-- (void)setParserData:(NSData *)parserData {
-  _parserData = [parserData mutableCopy];
-}
-
-- (NSData *)parserData {
-  return [_parserData copy];
-}
-
 - (NSData *)data {
   return [_data copy];
 }
@@ -419,13 +538,15 @@ static NSStringEncoding _StringEncodingFromCharset(NSString* charset) {
 - (instancetype)initWithMethod:(NSString*)method URL:(NSURL*)URL headers:(NSDictionary*)headers path:(NSString*)path query:(NSDictionary*)query {
   if((self = [super initWithMethod:method URL:URL headers:headers path:path query:query])) {
     NSString *boundary = _ExtractHeaderParameter(self.contentType, @"boundary");
-    if(boundary) {
-      self.boundary = [[NSString stringWithFormat:@"--%@", boundary] dataUsingEncoding:NSASCIIStringEncoding];
+    if(boundary.length) {
+      self.boundary = [[NSString stringWithFormat:@"\r\n--%@", boundary] dataUsingEncoding:NSASCIIStringEncoding];
     }
     if(self.boundary == nil) {
       DNOT_REACHED();
       return nil;
     }
+    _InitializeSkipTable(self.boundary.bytes, self.boundary.length, _boundarySkipTable);
+    self.keepsData = YES;
     self.arguments = @{};
     self.files = @{};
     self.parserState = OCFWebServerParserStateUndefined;
@@ -437,134 +558,196 @@ static NSStringEncoding _StringEncodingFromCharset(NSString* charset) {
   DCHECK(_parserData != nil);
   [_parserData appendBytes:buffer length:length];
   
-  DCHECK(_data != nil);
-  [_data appendBytes:buffer length:length];
+  if (self.keepsData) {
+    DCHECK(_data != nil);
+    [_data appendBytes:buffer length:length];
+  }
   return ([self _parseData] ? length : -1);
 }
 
 - (BOOL)open {
-  DCHECK(self.parserData == nil);
+  DCHECK(_parserData == nil);
   DCHECK(self.data == nil);
-  self.data = [NSMutableData dataWithCapacity:self.contentLength];
+  if (self.keepsData) {
+    self.data = [NSMutableData dataWithCapacity:self.contentLength];
+  }
   
-  self.parserData = [[NSMutableData alloc] initWithCapacity:kMultiPartBufferSize];
+  _parserData = [[NSMutableData alloc] initWithCapacity:kMultiPartBufferSize];
+  [_parserData appendBytes:"\r\n" length:2];  // Lets the first boundary match the delimiter like the following ones
+  _searchOffset = 0;
   self.parserState = OCFWebServerParserStateStart;
   return YES;
 }
 
+- (BOOL)_beginPartWithHeaderBytes:(const UInt8*)bytes length:(NSUInteger)length {
+  self.controlName = nil;
+  self.fileName = nil;
+  self.partContentType = nil;
+  self.tmpPath = nil;
+  _partData = nil;
+  
+  if (self.partHeaderParser == nil) {
+    self.partHeaderParser = [[OCFWebServerHeaderParser alloc] initWithMaximumHeaderSize:kMultiPartMaxHeaderSize + 4];
+  }
+  OCFWebServerHeaderParser* parser = self.partHeaderParser;
+  if ([parser parseHeaderFieldBytes:bytes length:length] == OCFWebServerHeaderParserResultComplete) {
+    NSDictionary* headers = parser.headers;
+    NSString* contentDisposition = headers[@"Content-Disposition"];
+    if ([[contentDisposition lowercaseString] hasPrefix:@"form-data;"]) {
+      self.controlName = _ExtractHeaderParameter(contentDisposition, @"name");
+      self.fileName = _ExtractHeaderParameter(contentDisposition, @"filename");
+    }
+    self.partContentType = headers[@"Content-Type"];
+  }
+  if (self.controlName == nil) {
+    DNOT_REACHED();
+    return NO;
+  }
+  
+  if (self.fileName) {
+    NSString* path = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSProcessInfo processInfo] globallyUniqueString]];
+    self.tmpFile = open([path fileSystemRepresentation], O_CREAT | O_TRUNC | O_WRONLY, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    if (self.tmpFile <= 0) {
+      DNOT_REACHED();
+      return NO;
+    }
+    self.tmpPath = path;
+  } else {
+    _partData = [[NSMutableData alloc] init];
+  }
+  return YES;
+}
+
+- (BOOL)_appendPartBytes:(const UInt8*)bytes length:(NSUInteger)length {
+  if (self.tmpPath) {
+    while (length > 0) {
+      ssize_t result = write(self.tmpFile, bytes, (size_t)length);
+      if (result <= 0) {
+        DNOT_REACHED();
+        return NO;
+      }
+      bytes += result;
+      length -= result;
+    }
+  } else {
+    DCHECK(_partData != nil);
+    [_partData appendBytes:bytes length:length];
+  }
+  return YES;
+}
+
+- (BOOL)_finishPart {
+  if (self.tmpPath) {
+    BOOL success = (close(self.tmpFile) == 0);
+    self.tmpFile = 0;
+    if (success) {
+      OCFWebServerMultiPartFile *file = [[OCFWebServerMultiPartFile alloc] initWithContentType:self.partContentType fileName:self.fileName temporaryPath:self.tmpPath];
+      _files[self.controlName] = file;
+    } else {
+      DNOT_REACHED();
+      unlink([self.tmpPath fileSystemRepresentation]);
+    }
+    self.tmpPath = nil;
+    return success;
+  }
+  OCFWebServerMultiPartArgument *argument = [[OCFWebServerMultiPartArgument alloc] initWithContentType:self.partContentType data:_partData];
+  _arguments[self.controlName] = argument;
+  _partData = nil;
+  return YES;
+}
+
 // http://www.w3.org/TR/html401/interact/forms.html#h-17.13.4
+// Consumes as much of the buffered bytes as possible: part contents are handed to their sink as soon as they cannot be
+// the start of a delimiter anymore, so only a partial delimiter or the headers of a part are ever kept around.
 - (BOOL)_parseData {
+  const UInt8* bytes = _parserData.bytes;
+  NSUInteger length = _parserData.length;
+  NSUInteger offset = 0;
+  const UInt8* boundaryBytes = self.boundary.bytes;
+  NSUInteger boundaryLength = self.boundary.length;
   BOOL success = YES;
+  BOOL needsData = NO;
   
-  if (self.parserState == OCFWebServerParserStateHeaders) {
-    NSRange range = [_parserData rangeOfData:_newlinesData options:0 range:NSMakeRange(0, _parserData.length)];
-    if (range.location != NSNotFound) {
+  while (success && !needsData) {
+    switch (self.parserState) {
       
-      self.controlName = nil;
-      self.fileName = nil;
-      self.contentType = nil;
-      self.tmpPath = nil;
-      CFHTTPMessageRef message = CFHTTPMessageCreateEmpty(kCFAllocatorDefault, true);
-      const char* temp = "GET / HTTP/1.0\r\n";
-      CFHTTPMessageAppendBytes(message, (const UInt8*)temp, strlen(temp));
-      CFHTTPMessageAppendBytes(message, _parserData.bytes, range.location + range.length);
-      if (CFHTTPMessageIsHeaderComplete(message)) {
-        NSString* controlName = nil;
-        NSString* fileName = nil;
-        NSDictionary* headers = (id)CFBridgingRelease(CFHTTPMessageCopyAllHeaderFields(message));
-        NSString* contentDisposition = headers[@"Content-Disposition"];
-        if ([[contentDisposition lowercaseString] hasPrefix:@"form-data;"]) {
-          controlName = _ExtractHeaderParameter(contentDisposition, @"name");
-          fileName = _ExtractHeaderParameter(contentDisposition, @"filename");
-        }
-        self.controlName = controlName;
-        self.fileName = fileName;
-        self.contentType = headers[@"Content-Type"];
-      }
-      CFRelease(message);
-      if (self.controlName) {
-        if (self.fileName) {
-          NSString* path = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSProcessInfo processInfo] globallyUniqueString]];
-          self.tmpFile = open([path fileSystemRepresentation], O_CREAT | O_TRUNC | O_WRONLY, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
-          if (self.tmpFile > 0) {
-            self.tmpPath = path;
+      case OCFWebServerParserStateStart:
+      case OCFWebServerParserStateContent: {
+        BOOL inContent = (self.parserState == OCFWebServerParserStateContent);  // Otherwise skipping the preamble
+        NSUInteger available = length - offset;
+        NSUInteger location = _FindDelimiter(bytes + offset, available, boundaryBytes, boundaryLength, _boundarySkipTable);
+        if (location == NSNotFound) {
+          NSUInteger safeLength = (available >= boundaryLength ? available - boundaryLength + 1 : 0);  // The tail may be a partial delimiter
+          if (inContent && safeLength) {
+            success = [self _appendPartBytes:(bytes + offset) length:safeLength];
+          }
+          offset += safeLength;
+          needsData = YES;
+        } else if (location + boundaryLength + 2 > available) {  // Need the 2 bytes following the delimiter to know what comes next
+          if (inContent && location) {
+            success = [self _appendPartBytes:(bytes + offset) length:location];
+          }
+          offset += location;
+          needsData = YES;
+        } else {
+          if (inContent) {
+            success = [self _appendPartBytes:(bytes + offset) length:location] && [self _finishPart];
+          }
+          offset += location + boundaryLength;
+          if ((bytes[offset] == '-') && (bytes[offset + 1] == '-')) {
+            self.parserState = OCFWebServerParserStateEnd;
+          } else if ((bytes[offset] == '\r') && (bytes[offset + 1] == '\n')) {  // Left in place so empty headers end with "\r\n\r\n" too
+            self.parserState = OCFWebServerParserStateHeaders;
+            _searchOffset = 0;
           } else {
             DNOT_REACHED();
             success = NO;
           }
         }
-      } else {
-        DNOT_REACHED();
-        success = NO;
+        break;
       }
       
-      [_parserData replaceBytesInRange:NSMakeRange(0, range.location + range.length) withBytes:NULL length:0];
-      self.parserState = OCFWebServerParserStateContent;
-    }
-  }
-  
-  if ((self.parserState == OCFWebServerParserStateStart) || (self.parserState == OCFWebServerParserStateContent)) {
-    NSRange range = [_parserData rangeOfData:_boundary options:0 range:NSMakeRange(0, _parserData.length)];
-    if (range.location != NSNotFound) {
-      NSRange subRange = NSMakeRange(range.location + range.length, _parserData.length - range.location - range.length);
-      NSRange subRange1 = [_parserData rangeOfData:_newlineData options:NSDataSearchAnchored range:subRange];
-      NSRange subRange2 = [_parserData rangeOfData:_dashNewlineData options:NSDataSearchAnchored range:subRange];
-      if ((subRange1.location != NSNotFound) || (subRange2.location != NSNotFound)) {
-        
-        if (self.parserState == OCFWebServerParserStateContent) {
-          const void* dataBytes = _parserData.bytes;
-          NSUInteger dataLength = range.location - 2;
-          if (self.tmpPath) {
-            ssize_t result = write(self.tmpFile, dataBytes, (size_t)dataLength);
-            if (result == dataLength) {
-              if (close(self.tmpFile) == 0) {
-                self.tmpFile = 0;
-                OCFWebServerMultiPartFile *file = [[OCFWebServerMultiPartFile alloc] initWithContentType:self.contentType fileName:self.fileName temporaryPath:self.tmpPath];
-                _files[self.controlName] = file;
-              } else {
-                DNOT_REACHED();
-                success = NO;
-              }
-            } else {
-              DNOT_REACHED();
-              success = NO;
-            }
-            self.tmpPath = nil;
-          } else {
-            NSData *data = [[NSData alloc] initWithBytesNoCopy:(void*)dataBytes length:dataLength freeWhenDone:NO];
-            OCFWebServerMultiPartArgument *argument = [[OCFWebServerMultiPartArgument alloc] initWithContentType:self.contentType data:data];
-            _arguments[self.controlName] = argument;
+      case OCFWebServerParserStateHeaders: {
+        NSUInteger available = length - offset;
+        NSUInteger location = _FindHeadersEnd(bytes + offset, available, _searchOffset);
+        if (location == NSNotFound) {
+          if (available > kMultiPartMaxHeaderSize) {
+            DNOT_REACHED();
+            success = NO;
           }
-        }
-        
-        if (subRange1.location != NSNotFound) {
-          [_parserData replaceBytesInRange:NSMakeRange(0, subRange1.location + subRange1.length) withBytes:NULL length:0];
-          self.parserState = OCFWebServerParserStateHeaders;
-          success = [self _parseData];
+          _searchOffset = (available > 3 ? available - 3 : 0);
+          needsData = YES;
         } else {
-          self.parserState = OCFWebServerParserStateEnd;
-        }
-      }
-    } else {
-      NSUInteger margin = 2 * self.boundary.length;
-      if (self.tmpPath && (_parserData.length > margin)) {
-        NSUInteger length = _parserData.length - margin;
-        ssize_t result = write(self.tmpFile, _parserData.bytes, length);
-        if (result == length) {
-          [_parserData replaceBytesInRange:NSMakeRange(0, length) withBytes:NULL length:0];
-        } else {
-          DNOT_REACHED();
-          success = NO;
+          success = [self _beginPartWithHeaderBytes:(bytes + offset + 2) length:(location + 2)];
+          offset += location + 4;
+          self.parserState = OCFWebServerParserStateContent;
         }
+        break;
       }
+      
+      case OCFWebServerParserStateEnd:  // Ignore the epilogue
+        offset = length;
+        needsData = YES;
+        break;
+      
+      default:
+        DNOT_REACHED();
+        success = NO;
+        break;
+      
     }
   }
+  
+  if (offset) {
+    [_parserData replaceBytesInRange:NSMakeRange(0, offset) withBytes:NULL length:0];
+  }
   return success;
 }
 
 - (BOOL)close {
   DCHECK(_parserData != nil);
-  self.parserData = nil;
+  _parserData = nil;
+  _partData = nil;
   if (self.tmpFile > 0) {
     close(self.tmpFile);
     unlink([self.tmpPath fileSystemRepresentation]);
@@ -573,21 +756,6 @@ static NSStringEncoding _StringEncodingFromCharset(NSString* charset) {
 }
 
 #pragma mark - Global Stuff
-+ (void)initialize {
-  if (_newlineData == nil) {
-    _newlineData = [[NSData alloc] initWithBytes:"\r\n" length:2];
-    DCHECK(_newlineData);
-  }
-  if (_newlinesData == nil) {
-    _newlinesData = [[NSData alloc] initWithBytes:"\r\n\r\n" length:4];
-    DCHECK(_newlinesData);
-  }
-  if (_dashNewlineData == nil) {
-    _dashNewlineData = [[NSData alloc] initWithBytes:"--\r\n" length:4];
-    DCHECK(_dashNewlineData);
-  }
-}
-
 + (NSString *)mimeType {
   return @"multipart/form-data";
 }
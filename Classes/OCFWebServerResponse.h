@@ -35,11 +35,13 @@
 
 #import <Foundation/Foundation.h>
 
+#define kOCFWebServerUnknownContentLength NSUIntegerMax  // Pass as content length to send the body with chunked transfer encoding
+
 @interface OCFWebServerResponse : NSObject
 
 #pragma mark - Properties
 @property(nonatomic, copy, readonly) NSString *contentType;
-@property(nonatomic, readonly) NSUInteger contentLength;
+@property(nonatomic, readonly) NSUInteger contentLength;  // kOCFWebServerUnknownContentLength if the length is not known up front
 @property(nonatomic, assign, readwrite) NSInteger statusCode;  // Default is 200
 @property(nonatomic) NSUInteger cacheControlMaxAge;  // Default is 0 seconds i.e. "no-cache"
 @property(nonatomic, readonly, copy) NSDictionary *additionalHeaders;
@@ -53,6 +55,7 @@
 #pragma mark - Working with the Response
 - (void)setValue:(NSString*)value forAdditionalHeader:(NSString*)header;
 - (BOOL)hasBody;  // Convenience method
+- (BOOL)usesChunkedTransferEncoding;  // Convenience method
 @end
 
 @interface OCFWebServerResponse (Subclassing)
@@ -88,7 +91,19 @@
 + (instancetype)responseWithHTMLTemplate:(NSString*)path variables:(NSDictionary*)variables;
 - (instancetype)initWithText:(NSString*)text;  // Encodes using UTF-8
 - (instancetype)initWithHTML:(NSString*)html;  // Encodes using UTF-8
-- (instancetype)initWithHTMLTemplate:(NSString*)path variables:(NSDictionary*)variables;  // Simple template system that replaces all occurences of "%variable%" with corresponding value (encodes using UTF-8)
+- (instancetype)initWithHTMLTemplate:(NSString*)path variables:(NSDictionary*)variables;  // Replaces "%variable%" placeholders with the corresponding values (see OCFWebServerTemplate)
+
+@end
+
+typedef NSData*(^OCFWebServerStreamBlock)(NSError** error);  // Return empty data when done or nil on error
+
+@interface OCFWebServerStreamingResponse : OCFWebServerResponse
+
+#pragma mark - Creating
++ (instancetype)responseWithContentType:(NSString*)type streamBlock:(OCFWebServerStreamBlock)block;
+- (instancetype)initWithContentType:(NSString*)type streamBlock:(OCFWebServerStreamBlock)block;  // Block is called on the connection's queue whenever more data can be sent
++ (instancetype)responseWithHTMLTemplate:(NSString*)path variables:(NSDictionary*)variables;
+- (instancetype)initWithHTMLTemplate:(NSString*)path variables:(NSDictionary*)variables;  // Renders the template as the body is sent
 
 @end
 
@@ -97,6 +112,7 @@
 #pragma mark - Creating
 + (instancetype)responseWithFile:(NSString*)path;
 + (instancetype)responseWithFile:(NSString*)path isAttachment:(BOOL)attachment;
++ (OCFWebServerResponse*)responseWithFile:(NSString*)path isAttachment:(BOOL)attachment requestHeaders:(NSDictionary*)headers;  // Honors If-None-Match, If-Modified-Since and Range (may return a 304, 206 or 416 response)
 - (instancetype)initWithFile:(NSString*)path;
 - (instancetype)initWithFile:(NSString*)path isAttachment:(BOOL)attachment;
 @end
@@ -34,9 +34,15 @@
  */
 
 #import <sys/stat.h>
+#import <time.h>
 
 #import "OCFWebServerPrivate.h"
+#import "OCFWebServerCompressor.h"
+#import "OCFWebServerFileCache.h"
 #import "OCFWebServerResponse.h"
+#import "OCFWebServerTemplate.h"
+
+#define kMaxByteRanges 16
 
 
 @interface OCFWebServerResponse ()
@@ -95,6 +101,10 @@
   return self.contentType ? YES : NO;
 }
 
+- (BOOL)usesChunkedTransferEncoding {
+  return (self.contentLength == kOCFWebServerUnknownContentLength ? YES : NO);
+}
+
 @end
 
 @implementation OCFWebServerResponse (Subclassing)
@@ -193,6 +203,15 @@
   return size;
 }
 
+- (NSData*)_getZeroCopyData {
+  DCHECK(self.offset == 0);
+  // Subclasses which transform the data in -read:maxLength: must not bypass it
+  if ([self methodForSelector:@selector(read:maxLength:)] != [OCFWebServerDataResponse instanceMethodForSelector:@selector(read:maxLength:)]) {
+    return nil;
+  }
+  return self.data;
+}
+
 - (BOOL)close {
   DCHECK(_offset >= 0);
   _offset = -1;
@@ -234,12 +253,97 @@
 }
 
 - (instancetype)initWithHTMLTemplate:(NSString*)path variables:(NSDictionary*)variables {
-  NSMutableString* html = [[NSMutableString alloc] initWithContentsOfFile:path encoding:NSUTF8StringEncoding error:NULL];
-  [variables enumerateKeysAndObjectsUsingBlock:^(NSString* key, NSString* value, BOOL* stop) {
-    [html replaceOccurrencesOfString:[NSString stringWithFormat:@"%%%@%%", key] withString:value options:0 range:NSMakeRange(0, html.length)];
-  }];
-  id response = [self initWithHTML:html];
-  return response;
+  NSData* data = [[OCFWebServerTemplate templateWithContentsOfFile:path] dataWithVariables:variables];
+  if (data == nil) {
+    DNOT_REACHED();
+    return nil;
+  }
+  return [self initWithData:data contentType:@"text/html; charset=utf-8"];
+}
+
+@end
+
+@interface OCFWebServerStreamingResponse ()
+
+#pragma mark - Properties
+@property (nonatomic, copy) OCFWebServerStreamBlock streamBlock;
+@property (nonatomic, copy) NSData *pendingData;  // Data returned by the stream block that did not fit into the last read
+@property (nonatomic, assign) NSUInteger pendingOffset;
+@property (nonatomic, assign) BOOL opened;
+
+@end
+
+@implementation OCFWebServerStreamingResponse
+
+#pragma mark - Creating
++ (instancetype)responseWithContentType:(NSString*)type streamBlock:(OCFWebServerStreamBlock)block {
+  return [[[self class] alloc] initWithContentType:type streamBlock:block];
+}
+
+- (instancetype)initWithContentType:(NSString*)type streamBlock:(OCFWebServerStreamBlock)block {
+  if(block == nil) {
+    DNOT_REACHED();
+    return nil;
+  }
+  
+  if((self = [super initWithContentType:(type ? type : kOCFWebServerDefaultMimeType) contentLength:kOCFWebServerUnknownContentLength])) {
+    self.streamBlock = block;
+    self.opened = NO;
+  }
+  return self;
+}
+
++ (instancetype)responseWithHTMLTemplate:(NSString*)path variables:(NSDictionary*)variables {
+  return [[[self class] alloc] initWithHTMLTemplate:path variables:variables];
+}
+
+- (instancetype)initWithHTMLTemplate:(NSString*)path variables:(NSDictionary*)variables {
+  OCFWebServerStreamBlock block = [[OCFWebServerTemplate templateWithContentsOfFile:path] streamBlockWithVariables:variables];
+  if (block == nil) {
+    DNOT_REACHED();
+    return nil;
+  }
+  return [self initWithContentType:@"text/html; charset=utf-8" streamBlock:block];
+}
+
+- (void)dealloc {
+  DCHECK(!self.opened);
+}
+
+- (BOOL)open {
+  DCHECK(!self.opened);
+  self.opened = YES;
+  self.pendingData = nil;
+  self.pendingOffset = 0;
+  return YES;
+}
+
+- (NSInteger)read:(void *)buffer maxLength:(NSUInteger)length {
+  DCHECK(self.opened);
+  if (self.pendingData == nil) {
+    NSError* error = nil;
+    NSData* data = self.streamBlock(&error);
+    if (data == nil) {
+      LOG_ERROR(@"Failed producing streamed response body: %@", error);
+      return -1;
+    }
+    self.pendingData = data;
+    self.pendingOffset = 0;
+  }
+  NSUInteger size = MIN(self.pendingData.length - self.pendingOffset, length);
+  [self.pendingData getBytes:buffer range:NSMakeRange(self.pendingOffset, size)];
+  self.pendingOffset = self.pendingOffset + size;
+  if (self.pendingOffset >= self.pendingData.length) {
+    self.pendingData = nil;
+  }
+  return size;
+}
+
+- (BOOL)close {
+  DCHECK(self.opened);
+  self.opened = NO;
+  self.pendingData = nil;
+  return YES;
 }
 
 @end
@@ -249,9 +353,142 @@
 #pragma mark - Properties
 @property (nonatomic, copy) NSString *path;
 @property (nonatomic, assign) int file;
+@property (nonatomic, assign) unsigned long long fileSize;
+@property (nonatomic, copy) NSString *fileContentType;
+@property (nonatomic, copy) NSArray *byteRanges;  // NSValue wrapped NSRange (nil to send the whole file)
+@property (nonatomic, copy) NSString *byteRangesBoundary;  // Only used for multiple ranges
+@property (nonatomic, assign) NSUInteger rangeIndex;
+@property (nonatomic, assign) NSRange remainingRange;  // Part of the current range not read yet
+@property (nonatomic, copy) NSData *pendingPartData;  // Multipart framing not read yet
+@property (nonatomic, assign) NSUInteger pendingPartOffset;
 
 @end
 
+static BOOL _ScanUnsigned(const char** cursor, unsigned long long* value) {
+  const char* p = *cursor;
+  if ((*p < '0') || (*p > '9')) {
+    return NO;
+  }
+  unsigned long long result = 0;
+  while ((*p >= '0') && (*p <= '9')) {
+    if (result > (ULLONG_MAX - 9) / 10) {
+      return NO;
+    }
+    result = 10 * result + (*p - '0');
+    ++p;
+  }
+  *cursor = p;
+  *value = result;
+  return YES;
+}
+
+// http://tools.ietf.org/html/rfc7233#section-2.1
+// Returns nil if the header must be ignored or an empty array if none of the ranges can be satisfied
+static NSArray* _ParseByteRanges(NSString* header, unsigned long long size) {
+  const char* p = [header UTF8String];
+  if ((p == NULL) || (strncasecmp(p, "bytes=", 6) != 0)) {
+    return nil;
+  }
+  p += 6;
+  NSMutableArray* ranges = [NSMutableArray array];
+  NSUInteger count = 0;
+  while (1) {
+    while ((*p == ' ') || (*p == '\t')) {
+      ++p;
+    }
+    unsigned long long first = 0;
+    unsigned long long last = 0;
+    BOOL hasFirst = _ScanUnsigned(&p, &first);
+    if (*p != '-') {
+      return nil;
+    }
+    ++p;
+    BOOL hasLast = _ScanUnsigned(&p, &last);
+    while ((*p == ' ') || (*p == '\t')) {
+      ++p;
+    }
+    if (hasFirst) {
+      if (hasLast && (last < first)) {
+        return nil;
+      }
+      if (first < size) {
+        if (!hasLast || (last >= size)) {
+          last = size - 1;
+        }
+        [ranges addObject:[NSValue valueWithRange:NSMakeRange((NSUInteger)first, (NSUInteger)(last - first + 1))]];
+      }
+    } else if (hasLast) {  // Suffix range i.e. the last N bytes
+      if ((last > 0) && (size > 0)) {
+        first = (last >= size ? 0 : size - last);
+        [ranges addObject:[NSValue valueWithRange:NSMakeRange((NSUInteger)first, (NSUInteger)(size - first))]];
+      }
+    } else {
+      return nil;
+    }
+    if (++count > kMaxByteRanges) {  // Not worth serving piecemeal
+      return nil;
+    }
+    if (*p == 0) {
+      break;
+    }
+    if (*p != ',') {
+      return nil;
+    }
+    ++p;
+  }
+  return ranges;
+}
+
+static BOOL _ETagListMatches(NSString* header, NSString* eTag) {
+  NSCharacterSet* whitespace = [NSCharacterSet whitespaceCharacterSet];
+  for (NSString* component in [header componentsSeparatedByString:@","]) {
+    NSString* tag = [component stringByTrimmingCharactersInSet:whitespace];
+    if ([tag hasPrefix:@"W/"]) {  // If-None-Match uses the weak comparison
+      tag = [tag substringFromIndex:2];
+    }
+    if ([tag isEqualToString:@"*"] || [tag isEqualToString:eTag]) {
+      return YES;
+    }
+  }
+  return NO;
+}
+
+// Returns -1 if the date cannot be parsed
+static time_t _ParseHTTPDate(NSString* string) {
+  const char* cString = [string UTF8String];
+  struct tm tm;
+  memset(&tm, 0, sizeof(tm));
+  if ((cString == NULL) || (strptime(cString, "%a, %d %b %Y %H:%M:%S GMT", &tm) == NULL)) {
+    return -1;
+  }
+  return timegm(&tm);
+}
+
+static NSData* _PartHeaderData(NSString* boundary, NSString* contentType, NSRange range, unsigned long long size) {
+  NSString* header = [NSString stringWithFormat:@"\r\n--%@\r\nContent-Type: %@\r\nContent-Range: bytes %lu-%lu/%llu\r\n\r\n", boundary, contentType, (unsigned long)range.location, (unsigned long)NSMaxRange(range) - 1, size];
+  return [header dataUsingEncoding:NSUTF8StringEncoding];
+}
+
+static NSData* _ClosingPartData(NSString* boundary) {
+  return [[NSString stringWithFormat:@"\r\n--%@--\r\n", boundary] dataUsingEncoding:NSUTF8StringEncoding];
+}
+
+static void _SetAttachmentHeader(OCFWebServerResponse* response, NSString* path) {
+  // TODO: Use http://tools.ietf.org/html/rfc5987 to encode file names with special characters instead of using lossy conversion to ISO 8859-1
+  NSData* data = [[path lastPathComponent] dataUsingEncoding:NSISOLatin1StringEncoding allowLossyConversion:YES];
+  NSString* fileName = data ? [[NSString alloc] initWithData:data encoding:NSISOLatin1StringEncoding] : nil;
+  if (fileName) {
+    [response setValue:[NSString stringWithFormat:@"attachment; filename=\"%@\"", fileName] forAdditionalHeader:@"Content-Disposition"];
+  } else {
+    DNOT_REACHED();
+  }
+}
+
+static void _SetValidatorHeaders(OCFWebServerResponse* response, OCFWebServerFileCacheEntry* entry) {
+  [response setValue:entry.eTag forAdditionalHeader:@"ETag"];
+  [response setValue:entry.lastModified forAdditionalHeader:@"Last-Modified"];
+}
+
 @implementation OCFWebServerFileResponse
 
 #pragma mark - Creating
@@ -263,32 +500,129 @@
   return [[[self class] alloc] initWithFile:path isAttachment:attachment];
 }
 
++ (OCFWebServerResponse*)responseWithFile:(NSString*)path isAttachment:(BOOL)attachment requestHeaders:(NSDictionary*)headers {
+  OCFWebServerFileCacheEntry* entry = [OCFWebServerFileCacheEntry entryWithPath:path];
+  if ((entry == nil) || entry.directory) {
+    DNOT_REACHED();
+    return nil;
+  }
+  return [self _responseWithCacheEntry:entry gzipEntry:nil isAttachment:attachment requestHeaders:headers];
+}
+
+// The gzip entry is a precompressed sibling of the file which is served instead when the client accepts it
++ (OCFWebServerResponse*)_responseWithCacheEntry:(OCFWebServerFileCacheEntry*)fileEntry gzipEntry:(OCFWebServerFileCacheEntry*)gzipEntry isAttachment:(BOOL)attachment requestHeaders:(NSDictionary*)headers {
+  DCHECK(!fileEntry.directory);
+  OCFWebServerResponse* response = nil;
+  OCFWebServerFileCacheEntry* entry = fileEntry;
+  if (gzipEntry && (headers[@"Range"] == nil) && (OCFWebServerPreferredContentEncoding(headers[@"Accept-Encoding"]) == OCFWebServerContentEncodingGzip)) {
+    entry = gzipEntry;
+  }
+  
+  // http://tools.ietf.org/html/rfc7232#section-6
+  BOOL notModified = NO;
+  NSString* ifNoneMatch = headers[@"If-None-Match"];
+  NSString* ifModifiedSince = headers[@"If-Modified-Since"];
+  if (ifNoneMatch) {
+    notModified = _ETagListMatches(ifNoneMatch, entry.eTag);
+  } else if (ifModifiedSince) {
+    if ([ifModifiedSince isEqualToString:entry.lastModified]) {
+      notModified = YES;
+    } else {
+      time_t date = _ParseHTTPDate(ifModifiedSince);
+      notModified = ((date >= 0) && (entry.modificationTime <= date));
+    }
+  }
+  if (notModified) {
+    response = [OCFWebServerResponse responseWithStatusCode:304];
+    _SetValidatorHeaders(response, entry);
+    if (gzipEntry) {
+      [response setValue:@"Accept-Encoding" forAdditionalHeader:@"Vary"];
+    }
+    return response;
+  }
+  
+  NSArray* ranges = nil;
+  NSString* rangeHeader = headers[@"Range"];
+  NSString* ifRange = headers[@"If-Range"];
+  if (rangeHeader && ((ifRange == nil) || [ifRange isEqualToString:entry.eTag] || [ifRange isEqualToString:entry.lastModified])) {
+    ranges = _ParseByteRanges(rangeHeader, entry.size);
+  }
+  if (ranges && (ranges.count == 0)) {
+    response = [OCFWebServerResponse responseWithStatusCode:416];
+    [response setValue:[NSString stringWithFormat:@"bytes */%llu", entry.size] forAdditionalHeader:@"Content-Range"];
+    return response;
+  }
+  
+  if (entry.data && (ranges == nil)) {  // Small file already in memory
+    response = [OCFWebServerDataResponse responseWithData:entry.data contentType:fileEntry.mimeType];
+    _SetValidatorHeaders(response, entry);
+    [response setValue:@"bytes" forAdditionalHeader:@"Accept-Ranges"];
+    if (attachment) {
+      _SetAttachmentHeader(response, fileEntry.path);
+    }
+  } else {
+    response = [[self alloc] _initWithCacheEntry:entry contentType:fileEntry.mimeType byteRanges:ranges];
+    if (attachment) {
+      _SetAttachmentHeader(response, fileEntry.path);
+    }
+  }
+  if (entry == gzipEntry) {
+    [response setValue:@"gzip" forAdditionalHeader:@"Content-Encoding"];
+  }
+  if (gzipEntry) {
+    [response setValue:@"Accept-Encoding" forAdditionalHeader:@"Vary"];
+  }
+  return response;
+}
+
 - (instancetype)initWithFile:(NSString*)path {
   return [self initWithFile:path isAttachment:NO];
 }
 
 - (instancetype)initWithFile:(NSString*)path isAttachment:(BOOL)attachment {
-  struct stat info;
-  if (lstat([path fileSystemRepresentation], &info) || !(info.st_mode & S_IFREG)) {
+  OCFWebServerFileCacheEntry* entry = [OCFWebServerFileCacheEntry entryWithPath:path];
+  if ((entry == nil) || entry.directory) {
     DNOT_REACHED();
     return nil;
   }
-  NSString* type = OCFWebServerGetMimeTypeForExtension([path pathExtension]);
-  if (type == nil) {
-    type = kOCFWebServerDefaultMimeType;
+  self = [self _initWithCacheEntry:entry contentType:entry.mimeType byteRanges:nil];
+  if (self && attachment) {
+    _SetAttachmentHeader(self, path);
+  }
+  return self;
+}
+
+- (instancetype)_initWithCacheEntry:(OCFWebServerFileCacheEntry*)entry contentType:(NSString*)fileContentType byteRanges:(NSArray*)ranges {
+  NSString* contentType = fileContentType;
+  NSUInteger contentLength = (NSUInteger)entry.size;
+  NSString* boundary = nil;
+  if (ranges.count > 1) {  // http://tools.ietf.org/html/rfc7233#appendix-A
+    boundary = [[NSProcessInfo processInfo] globallyUniqueString];
+    contentLength = _ClosingPartData(boundary).length;
+    for (NSValue* value in ranges) {
+      NSRange range = [value rangeValue];
+      contentLength += _PartHeaderData(boundary, fileContentType, range, entry.size).length + range.length;
+    }
+    contentType = [NSString stringWithFormat:@"multipart/byteranges; boundary=%@", boundary];
+  } else if (ranges.count == 1) {
+    contentLength = [ranges[0] rangeValue].length;
   }
   
-  if((self = [super initWithContentType:type contentLength:info.st_size])) {
-    self.path = path;
-    if (attachment) {  // TODO: Use http://tools.ietf.org/html/rfc5987 to encode file names with special characters instead of using lossy conversion to ISO 8859-1
-      NSData* data = [[path lastPathComponent] dataUsingEncoding:NSISOLatin1StringEncoding allowLossyConversion:YES];
-      NSString* fileName = data ? [[NSString alloc] initWithData:data encoding:NSISOLatin1StringEncoding] : nil;
-      if (fileName) {
-        [self setValue:[NSString stringWithFormat:@"attachment; filename=\"%@\"", fileName] forAdditionalHeader:@"Content-Disposition"];
-      } else {
-        DNOT_REACHED();
-      }
+  if((self = [super initWithContentType:contentType contentLength:contentLength])) {
+    self.path = entry.path;
+    self.fileSize = entry.size;
+    self.fileContentType = fileContentType;
+    self.byteRanges = ranges;
+    self.byteRangesBoundary = boundary;
+    if (ranges.count) {
+      self.statusCode = 206;
+    }
+    if (ranges.count == 1) {
+      NSRange range = [ranges[0] rangeValue];
+      [self setValue:[NSString stringWithFormat:@"bytes %lu-%lu/%llu", (unsigned long)range.location, (unsigned long)NSMaxRange(range) - 1, entry.size] forAdditionalHeader:@"Content-Range"];
     }
+    _SetValidatorHeaders(self, entry);
+    [self setValue:@"bytes" forAdditionalHeader:@"Accept-Ranges"];
     self.file = 0;
   }
   return self;
@@ -298,15 +632,94 @@
   DCHECK(self.file <= 0);
 }
 
+- (void)_startPartAtIndex:(NSUInteger)index {
+  self.rangeIndex = index;
+  self.pendingPartOffset = 0;
+  if (index < self.byteRanges.count) {
+    NSRange range = [self.byteRanges[index] rangeValue];
+    self.pendingPartData = _PartHeaderData(self.byteRangesBoundary, self.fileContentType, range, self.fileSize);
+    self.remainingRange = range;
+  } else {
+    self.pendingPartData = _ClosingPartData(self.byteRangesBoundary);
+    self.remainingRange = NSMakeRange(0, 0);
+  }
+}
+
 - (BOOL)open {
   DCHECK(self.file <= 0);
   self.file = open([self.path fileSystemRepresentation], O_NOFOLLOW | O_RDONLY);
-  return (self.file > 0 ? YES : NO);
+  if (self.file <= 0) {
+    return NO;
+  }
+  if (self.byteRanges.count == 1) {
+    self.remainingRange = [self.byteRanges[0] rangeValue];
+    if (lseek(self.file, self.remainingRange.location, SEEK_SET) < 0) {
+      close(self.file);
+      self.file = 0;
+      return NO;
+    }
+  } else if (self.byteRanges.count > 1) {
+    [self _startPartAtIndex:0];
+  }
+  return YES;
 }
 
 - (NSInteger)read:(void*)buffer maxLength:(NSUInteger)length {
   DCHECK(self.file > 0);
-  return read(self.file, buffer, length);
+  if (self.byteRanges == nil) {
+    return read(self.file, buffer, length);
+  }
+  
+  if (self.byteRanges.count == 1) {
+    NSRange remainingRange = self.remainingRange;
+    ssize_t result = read(self.file, buffer, MIN(length, remainingRange.length));
+    if (result > 0) {
+      self.remainingRange = NSMakeRange(remainingRange.location + result, remainingRange.length - result);
+    }
+    return result;
+  }
+  
+  NSUInteger total = 0;
+  while (total < length) {
+    NSData* pendingPartData = self.pendingPartData;
+    NSRange remainingRange = self.remainingRange;
+    if (pendingPartData) {
+      NSUInteger size = MIN(pendingPartData.length - self.pendingPartOffset, length - total);
+      [pendingPartData getBytes:((char*)buffer + total) range:NSMakeRange(self.pendingPartOffset, size)];
+      self.pendingPartOffset = self.pendingPartOffset + size;
+      total += size;
+      if (self.pendingPartOffset == pendingPartData.length) {
+        self.pendingPartData = nil;
+      }
+    } else if (remainingRange.length) {
+      ssize_t result = pread(self.file, ((char*)buffer + total), MIN(length - total, remainingRange.length), remainingRange.location);
+      if (result <= 0) {  // The file was truncated after the response was created
+        return -1;
+      }
+      self.remainingRange = NSMakeRange(remainingRange.location + result, remainingRange.length - result);
+      total += result;
+    } else if (self.rangeIndex < self.byteRanges.count) {
+      [self _startPartAtIndex:(self.rangeIndex + 1)];
+    } else {
+      break;
+    }
+  }
+  return total;
+}
+
+- (BOOL)_getZeroCopyFile:(int*)file offset:(off_t*)offset length:(off_t*)length {
+  DCHECK(self.file > 0);
+  // Subclasses which transform the file contents in -read:maxLength: must not bypass it
+  if ([self methodForSelector:@selector(read:maxLength:)] != [OCFWebServerFileResponse instanceMethodForSelector:@selector(read:maxLength:)]) {
+    return NO;
+  }
+  if (self.byteRanges.count > 1) {  // Multipart framing is generated by -read:maxLength:
+    return NO;
+  }
+  *file = self.file;
+  *offset = (self.byteRanges.count ? (off_t)[self.byteRanges[0] rangeValue].location : 0);
+  *length = self.contentLength;
+  return YES;
 }
 
 - (BOOL)close {
@@ -0,0 +1,374 @@
+/*
+ This file belongs to the OCFWebServer project. OCFWebServer is a fork of GCDWebServer (originally developed by
+ Pierre-Olivier Latour). We have forked GCDWebServer because we made extensive and incompatible changes to it.
+ To find out more have a look at README.md.
+ 
+ Copyright (c) 2013, Christian Kienle / chris@objective-cloud.com
+ All rights reserved.
+ 
+ Original Copyright Statement:
+ Copyright (c) 2012-2013, Pierre-Olivier Latour
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ * Neither the name of the <organization> nor the
+ names of its contributors may be used to endorse or promote products
+ derived from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import "OCFWebServerPrivate.h"
+#import "OCFWebServerRouter.h"
+
+#define kMaxRouteCandidates 64
+
+typedef struct {
+  NSUInteger indexes[kMaxRouteCandidates];
+  NSUInteger count;
+  BOOL overflow;
+} OCFWebServerRouteCandidates;
+
+typedef struct OCFWebServerRouteNode {
+  char* label;
+  size_t labelLength;
+  struct OCFWebServerRouteNode** children;
+  size_t childCount;
+  NSUInteger* handlerIndexes;  // Handlers whose route ends at this node
+  size_t handlerCount;
+} OCFWebServerRouteNode;
+
+static OCFWebServerRouteNode* _RouteNodeCreate(const char* label, size_t length) {
+  OCFWebServerRouteNode* node = calloc(1, sizeof(OCFWebServerRouteNode));
+  if (length) {
+    node->label = malloc(length);
+    memcpy(node->label, label, length);
+    node->labelLength = length;
+  }
+  return node;
+}
+
+static void _RouteNodeFree(OCFWebServerRouteNode* node) {
+  for (size_t i = 0; i < node->childCount; ++i) {
+    _RouteNodeFree(node->children[i]);
+  }
+  free(node->children);
+  free(node->handlerIndexes);
+  free(node->label);
+  free(node);
+}
+
+static void _RouteNodeAddChild(OCFWebServerRouteNode* node, OCFWebServerRouteNode* child) {
+  node->children = realloc(node->children, (node->childCount + 1) * sizeof(OCFWebServerRouteNode*));
+  node->children[node->childCount++] = child;
+}
+
+static void _RouteNodeAddHandlerIndex(OCFWebServerRouteNode* node, NSUInteger index) {
+  node->handlerIndexes = realloc(node->handlerIndexes, (node->handlerCount + 1) * sizeof(NSUInteger));
+  node->handlerIndexes[node->handlerCount++] = index;
+}
+
+static void _RouteNodeInsert(OCFWebServerRouteNode* root, const char* key, size_t length, NSUInteger index) {
+  OCFWebServerRouteNode* node = root;
+  while (length) {
+    size_t position = 0;
+    while ((position < node->childCount) && (node->children[position]->label[0] != key[0])) {
+      ++position;
+    }
+    if (position == node->childCount) {
+      OCFWebServerRouteNode* child = _RouteNodeCreate(key, length);
+      _RouteNodeAddChild(node, child);
+      node = child;
+      break;
+    }
+    OCFWebServerRouteNode* child = node->children[position];
+    size_t common = 0;
+    while ((common < child->labelLength) && (common < length) && (child->label[common] == key[common])) {
+      ++common;
+    }
+    if (common < child->labelLength) {  // Split the edge so the common part gets its own node
+      OCFWebServerRouteNode* middle = _RouteNodeCreate(child->label, common);
+      memmove(child->label, child->label + common, child->labelLength - common);
+      child->labelLength -= common;
+      _RouteNodeAddChild(middle, child);
+      node->children[position] = middle;
+      child = middle;
+    }
+    node = child;
+    key += common;
+    length -= common;
+  }
+  _RouteNodeAddHandlerIndex(node, index);
+}
+
+static void _AddCandidates(OCFWebServerRouteCandidates* candidates, const NSUInteger* indexes, NSUInteger count) {
+  if (candidates->count + count > kMaxRouteCandidates) {
+    candidates->overflow = YES;
+    return;
+  }
+  memcpy(&candidates->indexes[candidates->count], indexes, count * sizeof(NSUInteger));
+  candidates->count += count;
+}
+
+static inline char _FoldCase(char c) {
+  return ((c >= 'A') && (c <= 'Z') ? c + ('a' - 'A') : c);
+}
+
+// Walks the trie along the key and collects the handlers of the node the key ends at or, if prefixes is YES, of every node on the way
+static void _RouteNodeLookup(OCFWebServerRouteNode* root, const char* key, size_t length, BOOL prefixes, OCFWebServerRouteCandidates* candidates) {
+  BOOL foldCase = !prefixes;  // Paths are case-insensitive, base paths are not
+  OCFWebServerRouteNode* node = root;
+  while (1) {
+    if (node->handlerCount && (prefixes || (length == 0))) {
+      _AddCandidates(candidates, node->handlerIndexes, node->handlerCount);
+    }
+    if (length == 0) {
+      return;
+    }
+    char first = (foldCase ? _FoldCase(key[0]) : key[0]);
+    OCFWebServerRouteNode* next = NULL;
+    for (size_t i = 0; i < node->childCount; ++i) {
+      if (node->children[i]->label[0] == first) {
+        next = node->children[i];
+        break;
+      }
+    }
+    if ((next == NULL) || (next->labelLength > length)) {
+      return;
+    }
+    for (size_t i = 1; i < next->labelLength; ++i) {
+      char c = (foldCase ? _FoldCase(key[i]) : key[i]);
+      if (next->label[i] != c) {
+        return;
+      }
+    }
+    key += next->labelLength;
+    length -= next->labelLength;
+    node = next;
+  }
+}
+
+// Returns the (lowercase) literal text every match of the pattern must start with (if anchored) or contain
+static NSString* _LiteralPrefixForPattern(NSString* pattern, BOOL* anchored) {
+  *anchored = NO;
+  if ([pattern rangeOfString:@"|"].location != NSNotFound) {
+    return nil;
+  }
+  NSMutableString* literal = [NSMutableString string];
+  NSUInteger length = pattern.length;
+  NSUInteger index = 0;
+  if ([pattern hasPrefix:@"^"]) {
+    *anchored = YES;
+    index = 1;
+  }
+  while (index < length) {
+    unichar character = [pattern characterAtIndex:index];
+    NSUInteger step = 1;
+    if (character == '\\') {
+      if (index + 1 >= length) {
+        break;
+      }
+      character = [pattern characterAtIndex:(index + 1)];
+      if ((character > 127) || isalnum(character)) {  // Character classes, back references, quoting...
+        break;
+      }
+      step = 2;
+    } else if ((character < 128) && strchr(".[]()*+?{}^$#", character)) {
+      break;
+    }
+    if (index + step < length) {
+      unichar quantifier = [pattern characterAtIndex:(index + step)];
+      if ((quantifier == '?') || (quantifier == '*') || (quantifier == '{')) {  // The character is optional
+        break;
+      }
+    }
+    [literal appendFormat:@"%C", character];
+    index += step;
+  }
+  return [literal lowercaseString];
+}
+
+@interface OCFWebServerRegexRoute : NSObject
+@property(nonatomic, assign) NSUInteger index;
+@property(nonatomic, copy) NSString* literal;
+@property(nonatomic, assign) BOOL anchored;
+@end
+
+@implementation OCFWebServerRegexRoute
+@end
+
+@interface OCFWebServerRouteTable : NSObject
+@property(nonatomic, assign) OCFWebServerRouteNode* pathRoot;  // Case-insensitive (keys are lowercase)
+@property(nonatomic, assign) OCFWebServerRouteNode* basePathRoot;  // Case-sensitive
+@property(nonatomic, strong) NSMutableArray* regexRoutes;
+@end
+
+@implementation OCFWebServerRouteTable
+
+- (instancetype)init {
+  if((self = [super init])) {
+    self.pathRoot = _RouteNodeCreate(NULL, 0);
+    self.basePathRoot = _RouteNodeCreate(NULL, 0);
+    self.regexRoutes = [NSMutableArray array];
+  }
+  return self;
+}
+
+- (void)dealloc {
+  _RouteNodeFree(_pathRoot);
+  _RouteNodeFree(_basePathRoot);
+}
+
+@end
+
+@interface OCFWebServerRouter ()
+
+#pragma mark - Properties
+@property(nonatomic, copy) NSArray *handlers;
+@property(nonatomic, copy) NSDictionary *tables;  // Method -> OCFWebServerRouteTable
+
+@end
+
+@implementation OCFWebServerRouter {
+  NSUInteger* _customIndexes;
+  NSUInteger _customCount;
+}
+
+#pragma mark - Creating
+- (instancetype)initWithHandlers:(NSArray*)handlers {
+  if((self = [super init])) {
+    self.handlers = handlers;
+    _customIndexes = malloc(MAX(handlers.count, 1) * sizeof(NSUInteger));
+    _customCount = 0;
+    NSMutableDictionary* tables = [NSMutableDictionary dictionary];
+    [handlers enumerateObjectsUsingBlock:^(OCFWebServerHandler* handler, NSUInteger index, BOOL* stop) {
+      if (handler.routeType == OCFWebServerRouteTypeCustom) {
+        _customIndexes[_customCount++] = index;
+        return;
+      }
+      OCFWebServerRouteTable* table = tables[handler.method];
+      if (table == nil) {
+        table = [[OCFWebServerRouteTable alloc] init];
+        tables[handler.method] = table;
+      }
+      switch (handler.routeType) {
+        case OCFWebServerRouteTypePath: {
+          const char* key = [[handler.pattern lowercaseString] UTF8String];
+          _RouteNodeInsert(table.pathRoot, key, strlen(key), index);
+          break;
+        }
+          
+        case OCFWebServerRouteTypeBasePath: {
+          const char* key = [handler.pattern UTF8String];
+          _RouteNodeInsert(table.basePathRoot, key, strlen(key), index);
+          break;
+        }
+          
+        case OCFWebServerRouteTypePathRegex: {
+          OCFWebServerRegexRoute* route = [[OCFWebServerRegexRoute alloc] init];
+          BOOL anchored;
+          route.index = index;
+          route.literal = _LiteralPrefixForPattern(handler.pattern, &anchored);
+          route.anchored = anchored;
+          [table.regexRoutes addObject:route];
+          break;
+        }
+          
+        default:
+          DNOT_REACHED();
+          break;
+      }
+    }];
+    self.tables = tables;
+  }
+  return self;
+}
+
+- (void)dealloc {
+  free(_customIndexes);
+}
+
+#pragma mark - Routing
+- (OCFWebServerRequest*)_linearRequestWithMethod:(NSString*)method URL:(NSURL*)URL headers:(NSDictionary*)headers path:(NSString*)path query:(NSDictionary*)query handler:(OCFWebServerHandler* __autoreleasing*)handler {
+  for (OCFWebServerHandler* candidate in self.handlers) {
+    OCFWebServerRequest* request = candidate.matchBlock(method, URL, headers, path, query);
+    if (request) {
+      *handler = candidate;
+      return request;
+    }
+  }
+  return nil;
+}
+
+- (OCFWebServerRequest*)requestWithMethod:(NSString*)method URL:(NSURL*)URL headers:(NSDictionary*)headers path:(NSString*)path query:(NSDictionary*)query handler:(OCFWebServerHandler* __autoreleasing*)handler {
+  OCFWebServerRouteCandidates candidates;
+  candidates.count = 0;
+  candidates.overflow = NO;
+  _AddCandidates(&candidates, _customIndexes, _customCount);
+  OCFWebServerRouteTable* table = self.tables[method];
+  if (table) {
+    const char* key = [path UTF8String];
+    size_t length = strlen(key);
+    _RouteNodeLookup(table.basePathRoot, key, length, YES, &candidates);
+    const char* foldedKey = key;
+    for (size_t i = 0; i < length; ++i) {
+      if (key[i] & 0x80) {  // Only ASCII is folded while walking the trie
+        foldedKey = [[path lowercaseString] UTF8String];
+        break;
+      }
+    }
+    _RouteNodeLookup(table.pathRoot, foldedKey, strlen(foldedKey), NO, &candidates);
+    for (OCFWebServerRegexRoute* route in table.regexRoutes) {
+      if (route.literal.length) {
+        NSStringCompareOptions options = NSCaseInsensitiveSearch | (route.anchored ? NSAnchoredSearch : 0);
+        if ([path rangeOfString:route.literal options:options].location == NSNotFound) {
+          continue;
+        }
+      }
+      NSUInteger index = route.index;
+      _AddCandidates(&candidates, &index, 1);
+    }
+  }
+  if (candidates.overflow) {
+    LOG_DEBUG(@"Too many route candidates for '%@': falling back to linear matching", path);
+    return [self _linearRequestWithMethod:method URL:URL headers:headers path:path query:query handler:handler];
+  }
+  
+  NSUInteger count = candidates.count;
+  NSUInteger* indexes = candidates.indexes;
+  for (NSUInteger i = 1; i < count; ++i) {  // Restore the priority order of the handlers array
+    NSUInteger value = indexes[i];
+    NSUInteger j = i;
+    while ((j > 0) && (indexes[j - 1] > value)) {
+      indexes[j] = indexes[j - 1];
+      --j;
+    }
+    indexes[j] = value;
+  }
+  for (NSUInteger i = 0; i < count; ++i) {
+    OCFWebServerHandler* candidate = self.handlers[indexes[i]];
+    OCFWebServerRequest* request = candidate.matchBlock(method, URL, headers, path, query);
+    if (request) {
+      *handler = candidate;
+      return request;
+    }
+  }
+  return nil;
+}
+
+@end
@@ -0,0 +1,57 @@
+/*
+ This file belongs to the OCFWebServer project. OCFWebServer is a fork of GCDWebServer (originally developed by
+ Pierre-Olivier Latour). We have forked GCDWebServer because we made extensive and incompatible changes to it.
+ To find out more have a look at README.md.
+ 
+ Copyright (c) 2013, Christian Kienle / chris@objective-cloud.com
+ All rights reserved.
+ 
+ Original Copyright Statement:
+ Copyright (c) 2012-2013, Pierre-Olivier Latour
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ * Neither the name of the <organization> nor the
+ names of its contributors may be used to endorse or promote products
+ derived from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import <Foundation/Foundation.h>
+#import "OCFWebServerResponse.h"
+
+// UTF-8 template where "%name%" placeholders are replaced by variables. The text is parsed once into literal and
+// placeholder segments which are then rendered in a single pass. Unlike the string substitution used before, names are
+// limited to ASCII letters, digits, "_", "-" and ".", so a "%" followed by anything else is literal text: placeholders
+// for variables named with spaces, ":", "/" or non-ASCII characters are no longer replaced (debug builds log them).
+@interface OCFWebServerTemplate : NSObject
+
+#pragma mark - Properties
+@property(nonatomic, copy, readonly) NSData *data;  // Template source
+@property(nonatomic, copy, readonly) NSArray *variableNames;  // Names of the placeholders in order of first appearance
+
+#pragma mark - Creating
++ (instancetype)templateWithContentsOfFile:(NSString*)path;  // Cached per path and reparsed once the file changes (checked at most once per second)
+- (instancetype)initWithData:(NSData*)data;
+
+#pragma mark - Rendering
+- (NSData*)dataWithVariables:(NSDictionary*)variables;  // Placeholders without a variable are kept as is (values which are not strings use -description)
+- (OCFWebServerStreamBlock)streamBlockWithVariables:(NSDictionary*)variables;  // Renders on demand in pieces of up to 32 KB
+
+@end
@@ -0,0 +1,272 @@
+/*
+ This file belongs to the OCFWebServer project. OCFWebServer is a fork of GCDWebServer (originally developed by
+ Pierre-Olivier Latour). We have forked GCDWebServer because we made extensive and incompatible changes to it.
+ To find out more have a look at README.md.
+ 
+ Copyright (c) 2013, Christian Kienle / chris@objective-cloud.com
+ All rights reserved.
+ 
+ Original Copyright Statement:
+ Copyright (c) 2012-2013, Pierre-Olivier Latour
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ * Neither the name of the <organization> nor the
+ names of its contributors may be used to endorse or promote products
+ derived from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import <sys/stat.h>
+
+#import "OCFWebServerPrivate.h"
+#import "OCFWebServerTemplate.h"
+
+#if defined(__APPLE__)
+#define _ModificationTimeSpec(info) ((info).st_mtimespec)
+#else
+#define _ModificationTimeSpec(info) ((info).st_mtim)
+#endif
+
+#define kTemplateCacheCountLimit 128
+#define kTemplateStreamChunkSize (32 * 1024)
+
+typedef struct {
+  NSUInteger location;  // Literal text or whole placeholder in the template data
+  NSUInteger length;
+  NSUInteger variableIndex;  // NSNotFound for literal text
+} OCFWebServerTemplateSegment;
+
+static inline BOOL _IsPlaceholderCharacter(UInt8 byte) {
+  return (((byte >= 'a') && (byte <= 'z')) || ((byte >= 'A') && (byte <= 'Z')) || ((byte >= '0') && (byte <= '9')) || (byte == '_') || (byte == '-') || (byte == '.'));
+}
+
+#ifndef NDEBUG
+
+// Variables named otherwise were replaced by the string substitution templates used before but never match a placeholder now
+static BOOL _IsPlaceholderName(NSString* name) {
+  static NSCharacterSet* invalidCharacters = nil;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    invalidCharacters = [[NSCharacterSet characterSetWithCharactersInString:@"abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_-."] invertedSet];
+  });
+  return (name.length && ([name rangeOfCharacterFromSet:invalidCharacters].location == NSNotFound));
+}
+
+#endif
+
+@interface OCFWebServerTemplate ()
+
+#pragma mark - Properties
+@property(nonatomic, copy, readwrite) NSData *data;
+@property(nonatomic, copy, readwrite) NSArray *variableNames;
+@property(nonatomic, assign) struct stat info;  // Of the file the template was read from
+@property(nonatomic, assign) time_t validationTime;  // Guarded by the template
+
+@end
+
+@implementation OCFWebServerTemplate {
+  OCFWebServerTemplateSegment* _segments;
+  NSUInteger _segmentCount;
+}
+
+#pragma mark - Creating
++ (NSCache*)_cache {
+  static NSCache* cache = nil;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    cache = [[NSCache alloc] init];
+    cache.countLimit = kTemplateCacheCountLimit;
+  });
+  return cache;
+}
+
++ (instancetype)templateWithContentsOfFile:(NSString*)path {
+  NSCache* cache = [self _cache];
+  time_t now = time(NULL);
+  OCFWebServerTemplate* template = [cache objectForKey:path];
+  if (template) {
+    @synchronized(template) {
+      if (template.validationTime == now) {
+        return template;
+      }
+    }
+    struct stat info;
+    struct stat templateInfo = template.info;
+    if ((stat([path fileSystemRepresentation], &info) == 0) && (info.st_ino == templateInfo.st_ino) && (info.st_dev == templateInfo.st_dev) && (info.st_size == templateInfo.st_size)
+        && (_ModificationTimeSpec(info).tv_sec == _ModificationTimeSpec(templateInfo).tv_sec) && (_ModificationTimeSpec(info).tv_nsec == _ModificationTimeSpec(templateInfo).tv_nsec)) {
+      @synchronized(template) {
+        template.validationTime = now;
+      }
+      return template;
+    }
+  }
+  
+  struct stat info;
+  NSData* data = nil;
+  if (stat([path fileSystemRepresentation], &info) == 0) {
+    data = [NSData dataWithContentsOfFile:path];
+  }
+  template = (data ? [[self alloc] initWithData:data] : nil);
+  if (template) {
+    template.info = info;
+    template.validationTime = now;
+    [cache setObject:template forKey:path];
+  } else {
+    LOG_ERROR(@"Failed reading template from \"%@\"", path);
+    [cache removeObjectForKey:path];
+  }
+  return template;
+}
+
+- (instancetype)initWithData:(NSData*)data {
+  if((self = [super init])) {
+    self.data = data;
+    [self _parse];
+  }
+  return self;
+}
+
+- (void)dealloc {
+  free(_segments);
+}
+
+- (void)_addSegmentWithLocation:(NSUInteger)location length:(NSUInteger)length variableIndex:(NSUInteger)index capacity:(NSUInteger*)capacity {
+  if (length == 0) {
+    return;
+  }
+  if (_segmentCount == *capacity) {
+    *capacity = MAX(2 * *capacity, 16);
+    _segments = realloc(_segments, *capacity * sizeof(OCFWebServerTemplateSegment));
+  }
+  _segments[_segmentCount++] = (OCFWebServerTemplateSegment){location, length, index};
+}
+
+- (void)_parse {
+  const UInt8* bytes = self.data.bytes;
+  NSUInteger length = self.data.length;
+  NSMutableArray* names = [[NSMutableArray alloc] init];
+  NSMutableDictionary* indexes = [[NSMutableDictionary alloc] init];
+  NSUInteger capacity = 0;
+  NSUInteger literalStart = 0;
+  NSUInteger offset = 0;
+  while (offset < length) {
+    const UInt8* percent = memchr(bytes + offset, '%', length - offset);
+    if (percent == NULL) {
+      break;
+    }
+    NSUInteger start = percent - bytes;
+    NSUInteger end = start + 1;
+    while ((end < length) && _IsPlaceholderCharacter(bytes[end])) {
+      ++end;
+    }
+    if ((end == start + 1) || (end == length) || (bytes[end] != '%')) {
+      offset = start + 1;  // Not a placeholder but the next "%" may start one
+      continue;
+    }
+    NSString* name = [[NSString alloc] initWithBytes:(bytes + start + 1) length:(end - start - 1) encoding:NSASCIIStringEncoding];
+    NSNumber* index = indexes[name];
+    if (index == nil) {
+      index = @(names.count);
+      indexes[name] = index;
+      [names addObject:name];
+    }
+    [self _addSegmentWithLocation:literalStart length:(start - literalStart) variableIndex:NSNotFound capacity:&capacity];
+    [self _addSegmentWithLocation:start length:(end + 1 - start) variableIndex:index.unsignedIntegerValue capacity:&capacity];
+    literalStart = end + 1;
+    offset = end + 1;
+  }
+  [self _addSegmentWithLocation:literalStart length:(length - literalStart) variableIndex:NSNotFound capacity:&capacity];
+  self.variableNames = names;
+}
+
+#pragma mark - Rendering
+// Values are encoded once per render however often their placeholder appears
+- (NSArray*)_valuesWithVariables:(NSDictionary*)variables {
+#ifndef NDEBUG
+  for (id name in variables) {
+    if (![name isKindOfClass:[NSString class]] || !_IsPlaceholderName(name)) {
+      LOG_WARNING(@"Template variable \"%@\" can never match a placeholder (names are limited to letters, digits, \"_\", \"-\" and \".\")", name);
+    }
+  }
+#endif
+  NSMutableArray* values = [[NSMutableArray alloc] initWithCapacity:self.variableNames.count];
+  for (NSString* name in self.variableNames) {
+    id value = variables[name];
+    NSString* string = ([value isKindOfClass:[NSString class]] ? value : [value description]);
+    NSData* data = [string dataUsingEncoding:NSUTF8StringEncoding];
+    [values addObject:(data ? data : [NSNull null])];
+  }
+  return values;
+}
+
+- (void)_getSegment:(NSUInteger)index values:(NSArray*)values bytes:(const void**)bytes length:(NSUInteger*)length {
+  OCFWebServerTemplateSegment segment = _segments[index];
+  NSData* value = (segment.variableIndex != NSNotFound ? values[segment.variableIndex] : nil);
+  if ([value isKindOfClass:[NSData class]]) {
+    *bytes = value.bytes;
+    *length = value.length;
+  } else {
+    *bytes = (const UInt8*)self.data.bytes + segment.location;
+    *length = segment.length;
+  }
+}
+
+- (NSData*)dataWithVariables:(NSDictionary*)variables {
+  NSArray* values = [self _valuesWithVariables:variables];
+  NSUInteger totalLength = 0;
+  for (NSUInteger i = 0; i < _segmentCount; ++i) {
+    const void* bytes;
+    NSUInteger length;
+    [self _getSegment:i values:values bytes:&bytes length:&length];
+    totalLength += length;
+  }
+  NSMutableData* data = [[NSMutableData alloc] initWithCapacity:totalLength];  // Exact size so appending never reallocates
+  for (NSUInteger i = 0; i < _segmentCount; ++i) {
+    const void* bytes;
+    NSUInteger length;
+    [self _getSegment:i values:values bytes:&bytes length:&length];
+    [data appendBytes:bytes length:length];
+  }
+  return data;
+}
+
+- (OCFWebServerStreamBlock)streamBlockWithVariables:(NSDictionary*)variables {
+  NSArray* values = [self _valuesWithVariables:variables];
+  __block NSUInteger segmentIndex = 0;
+  __block NSUInteger segmentOffset = 0;  // Part of the current segment already returned
+  return ^NSData*(NSError** error) {
+    NSMutableData* data = [[NSMutableData alloc] initWithCapacity:kTemplateStreamChunkSize];
+    while ((segmentIndex < _segmentCount) && (data.length < kTemplateStreamChunkSize)) {
+      const void* bytes;
+      NSUInteger length;
+      [self _getSegment:segmentIndex values:values bytes:&bytes length:&length];
+      NSUInteger size = MIN(length - segmentOffset, kTemplateStreamChunkSize - data.length);
+      [data appendBytes:((const UInt8*)bytes + segmentOffset) length:size];
+      segmentOffset += size;
+      if (segmentOffset == length) {
+        segmentIndex += 1;
+        segmentOffset = 0;
+      }
+    }
+    return data;
+  };
+}
+
+@end
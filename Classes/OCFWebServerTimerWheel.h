@@ -0,0 +1,58 @@
+/*
+ This file belongs to the OCFWebServer project. OCFWebServer is a fork of GCDWebServer (originally developed by
+ Pierre-Olivier Latour). We have forked GCDWebServer because we made extensive and incompatible changes to it.
+ To find out more have a look at README.md.
+ 
+ Copyright (c) 2013, Christian Kienle / chris@objective-cloud.com
+ All rights reserved.
+ 
+ Original Copyright Statement:
+ Copyright (c) 2012-2013, Pierre-Olivier Latour
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ * Neither the name of the <organization> nor the
+ names of its contributors may be used to endorse or promote products
+ derived from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import <Foundation/Foundation.h>
+
+@protocol OCFWebServerTimerWheelTarget <NSObject>
+- (void)timerWheelDidExpireAtDeadline:(uint64_t)deadline;  // Called on a global queue with the deadline -setTimeout:forTarget: returned, which tells a stale expiration from the timeout armed since
+@end
+
+// Hashed timer wheel driving the timeouts of all the connections of a server from a single dispatch timer. Arming,
+// re-arming and cancelling a timeout is O(1) and allocates nothing besides the bookkeeping of the target, which is what
+// connections do every time they switch between reading and writing. Targets are held weakly.
+@interface OCFWebServerTimerWheel : NSObject
+
+#pragma mark - Properties
+@property(nonatomic, readonly) NSTimeInterval resolution;  // Timeouts fire up to one resolution late
+
+#pragma mark - Creating
+- (instancetype)initWithResolution:(NSTimeInterval)resolution;
+
+#pragma mark - Scheduling
+- (uint64_t)setTimeout:(NSTimeInterval)timeout forTarget:(id<OCFWebServerTimerWheelTarget>)target;  // Replaces any pending timeout (a timeout <= 0 cancels it) and returns its deadline, which grows with every call (0 if cancelled)
+- (void)cancelTimeoutForTarget:(id<OCFWebServerTimerWheelTarget>)target;
+- (void)invalidate;  // Stops the timer - must be called before releasing the wheel
+
+@end
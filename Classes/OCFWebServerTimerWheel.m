@@ -0,0 +1,140 @@
+/*
+ This file belongs to the OCFWebServer project. OCFWebServer is a fork of GCDWebServer (originally developed by
+ Pierre-Olivier Latour). We have forked GCDWebServer because we made extensive and incompatible changes to it.
+ To find out more have a look at README.md.
+ 
+ Copyright (c) 2013, Christian Kienle / chris@objective-cloud.com
+ All rights reserved.
+ 
+ Original Copyright Statement:
+ Copyright (c) 2012-2013, Pierre-Olivier Latour
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ * Neither the name of the <organization> nor the
+ names of its contributors may be used to endorse or promote products
+ derived from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import "OCFWebServerPrivate.h"
+#import "OCFWebServerTimerWheel.h"
+
+#define kSlotCount 512  // Timeouts longer than kSlotCount ticks just stay in their slot for more rounds
+
+@implementation OCFWebServerTimerWheel {
+  NSHashTable* _slots[kSlotCount];
+  NSMapTable* _deadlines;  // Target -> tick
+  uint64_t _tick;
+  dispatch_source_t _timer;
+}
+
+#pragma mark - Creating
+- (instancetype)initWithResolution:(NSTimeInterval)resolution {
+  if((self = [super init])) {
+    DCHECK(resolution > 0.0);
+    _resolution = resolution;
+    for (NSUInteger i = 0; i < kSlotCount; ++i) {
+      _slots[i] = [NSHashTable weakObjectsHashTable];
+    }
+    _deadlines = [NSMapTable weakToStrongObjectsMapTable];
+    _timer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, kOCFWebServerGCDQueue);
+    uint64_t interval = (uint64_t)(resolution * NSEC_PER_SEC);
+    dispatch_source_set_timer(_timer, dispatch_time(DISPATCH_TIME_NOW, interval), interval, interval / 10);
+    __typeof__(self) __weak weakSelf = self;
+    dispatch_source_set_event_handler(_timer, ^{
+      @autoreleasepool {
+        [weakSelf _advance];
+      }
+    });
+    dispatch_resume(_timer);
+  }
+  return self;
+}
+
+#pragma mark - Scheduling
+- (void)_removeTarget:(id)target {
+  NSNumber* deadline = [_deadlines objectForKey:target];
+  if (deadline) {
+    [_slots[[deadline unsignedLongLongValue] % kSlotCount] removeObject:target];
+    [_deadlines removeObjectForKey:target];
+  }
+}
+
+- (uint64_t)setTimeout:(NSTimeInterval)timeout forTarget:(id<OCFWebServerTimerWheelTarget>)target {
+  if (timeout <= 0.0) {
+    [self cancelTimeoutForTarget:target];
+    return 0;
+  }
+  uint64_t ticks = MAX((uint64_t)ceil(timeout / _resolution), 1);
+  uint64_t deadline;
+  @synchronized(self) {
+    [self _removeTarget:target];
+    deadline = _tick + ticks;  // Past any deadline already expired
+    [_slots[deadline % kSlotCount] addObject:target];
+    [_deadlines setObject:@(deadline) forKey:target];
+  }
+  return deadline;
+}
+
+- (void)cancelTimeoutForTarget:(id<OCFWebServerTimerWheelTarget>)target {
+  @synchronized(self) {
+    [self _removeTarget:target];
+  }
+}
+
+- (void)_advance {
+  NSMutableArray* expiredTargets = nil;
+  NSMutableArray* expiredDeadlines = nil;
+  @synchronized(self) {
+    _tick += 1;
+    NSHashTable* slot = _slots[_tick % kSlotCount];
+    for (id target in slot) {
+      NSNumber* deadline = [_deadlines objectForKey:target];
+      if ([deadline unsignedLongLongValue] <= _tick) {
+        if (expiredTargets == nil) {
+          expiredTargets = [[NSMutableArray alloc] init];
+          expiredDeadlines = [[NSMutableArray alloc] init];
+        }
+        [expiredTargets addObject:target];
+        [expiredDeadlines addObject:deadline];
+      }
+    }
+    for (id target in expiredTargets) {
+      [self _removeTarget:target];
+    }
+  }
+  for (NSUInteger i = 0; i < expiredTargets.count; ++i) {
+    [(id<OCFWebServerTimerWheelTarget>)expiredTargets[i] timerWheelDidExpireAtDeadline:[expiredDeadlines[i] unsignedLongLongValue]];
+  }
+}
+
+- (void)invalidate {
+  if (_timer) {
+    dispatch_source_cancel(_timer);
+    _timer = nil;
+  }
+}
+
+#pragma mark - NSObject
+- (void)dealloc {
+  [self invalidate];
+}
+
+@end
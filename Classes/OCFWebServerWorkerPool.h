@@ -0,0 +1,58 @@
+/*
+ This file belongs to the OCFWebServer project. OCFWebServer is a fork of GCDWebServer (originally developed by
+ Pierre-Olivier Latour). We have forked GCDWebServer because we made extensive and incompatible changes to it.
+ To find out more have a look at README.md.
+ 
+ Copyright (c) 2013, Christian Kienle / chris@objective-cloud.com
+ All rights reserved.
+ 
+ Original Copyright Statement:
+ Copyright (c) 2012-2013, Pierre-Olivier Latour
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ * Neither the name of the <organization> nor the
+ names of its contributors may be used to endorse or promote products
+ derived from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import <Foundation/Foundation.h>
+
+// Bounded pool running handler process blocks. At most maxConcurrentHandlers blocks run at once at the dispatch priority
+// of the pool and the others wait in FIFO order. Giving slow handlers their own low priority pool keeps them from
+// starving the threads needed by the other handlers and by the connections I/O.
+@interface OCFWebServerWorkerPool : NSObject
+
+#pragma mark - Properties
+@property(nonatomic, copy, readonly) NSString *name;
+@property(nonatomic, readonly) NSUInteger maxConcurrentHandlers;
+@property(nonatomic, readonly) NSUInteger maxPendingHandlers;  // Blocks submitted over this are refused (0 means unlimited)
+@property(nonatomic, readonly) long priority;  // DISPATCH_QUEUE_PRIORITY_*
+@property(nonatomic, readonly) NSUInteger runningCount;
+@property(nonatomic, readonly) NSUInteger pendingCount;
+
+#pragma mark - Creating
++ (instancetype)workerPoolWithName:(NSString*)name maxConcurrentHandlers:(NSUInteger)maxConcurrentHandlers maxPendingHandlers:(NSUInteger)maxPendingHandlers priority:(long)priority;
+- (instancetype)initWithName:(NSString*)name maxConcurrentHandlers:(NSUInteger)maxConcurrentHandlers maxPendingHandlers:(NSUInteger)maxPendingHandlers priority:(long)priority;
+
+#pragma mark - Running
+- (BOOL)submitBlock:(dispatch_block_t)block;  // Returns NO if the pool is saturated
+
+@end
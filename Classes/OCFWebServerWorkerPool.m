@@ -0,0 +1,117 @@
+/*
+ This file belongs to the OCFWebServer project. OCFWebServer is a fork of GCDWebServer (originally developed by
+ Pierre-Olivier Latour). We have forked GCDWebServer because we made extensive and incompatible changes to it.
+ To find out more have a look at README.md.
+ 
+ Copyright (c) 2013, Christian Kienle / chris@objective-cloud.com
+ All rights reserved.
+ 
+ Original Copyright Statement:
+ Copyright (c) 2012-2013, Pierre-Olivier Latour
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ * Neither the name of the <organization> nor the
+ names of its contributors may be used to endorse or promote products
+ derived from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import "OCFWebServerPrivate.h"
+#import "OCFWebServerWorkerPool.h"
+
+@interface OCFWebServerWorkerPool ()
+
+#pragma mark - Properties
+@property(nonatomic, copy, readwrite) NSString *name;
+@property(nonatomic, readwrite) NSUInteger maxConcurrentHandlers;
+@property(nonatomic, readwrite) NSUInteger maxPendingHandlers;
+@property(nonatomic, readwrite) long priority;
+@property(nonatomic, readwrite) NSUInteger runningCount;
+@property(nonatomic, strong) dispatch_queue_t queue;
+@property(nonatomic, strong) NSMutableArray *pendingBlocks;
+
+@end
+
+@implementation OCFWebServerWorkerPool
+
+#pragma mark - Creating
++ (instancetype)workerPoolWithName:(NSString*)name maxConcurrentHandlers:(NSUInteger)maxConcurrentHandlers maxPendingHandlers:(NSUInteger)maxPendingHandlers priority:(long)priority {
+  return [[self alloc] initWithName:name maxConcurrentHandlers:maxConcurrentHandlers maxPendingHandlers:maxPendingHandlers priority:priority];
+}
+
+- (instancetype)initWithName:(NSString*)name maxConcurrentHandlers:(NSUInteger)maxConcurrentHandlers maxPendingHandlers:(NSUInteger)maxPendingHandlers priority:(long)priority {
+  if((self = [super init])) {
+    DCHECK(maxConcurrentHandlers > 0);
+    self.name = name;
+    self.maxConcurrentHandlers = MAX(maxConcurrentHandlers, 1);
+    self.maxPendingHandlers = maxPendingHandlers;
+    self.priority = priority;
+    self.queue = dispatch_queue_create([name UTF8String], DISPATCH_QUEUE_CONCURRENT);
+    dispatch_set_target_queue(self.queue, dispatch_get_global_queue(priority, 0));
+    self.pendingBlocks = [[NSMutableArray alloc] init];
+  }
+  return self;
+}
+
+#pragma mark - Properties
+- (NSUInteger)pendingCount {
+  @synchronized(self) {
+    return self.pendingBlocks.count;
+  }
+}
+
+#pragma mark - Running
+- (void)_runBlock:(dispatch_block_t)block {
+  dispatch_async(self.queue, ^{
+    @autoreleasepool {
+      block();
+    }
+    dispatch_block_t nextBlock = nil;
+    @synchronized(self) {
+      if (self.pendingBlocks.count) {
+        nextBlock = self.pendingBlocks[0];
+        [self.pendingBlocks removeObjectAtIndex:0];
+      } else {
+        self.runningCount = self.runningCount - 1;
+      }
+    }
+    if (nextBlock) {  // Hands the slot over without releasing it
+      [self _runBlock:nextBlock];
+    }
+  });
+}
+
+- (BOOL)submitBlock:(dispatch_block_t)block {
+  @synchronized(self) {
+    if (self.runningCount >= self.maxConcurrentHandlers) {
+      if (self.maxPendingHandlers && (self.pendingBlocks.count >= self.maxPendingHandlers)) {
+        LOG_WARNING(@"Worker pool \"%@\" is saturated", self.name);
+        return NO;
+      }
+      [self.pendingBlocks addObject:[block copy]];
+      return YES;
+    }
+    self.runningCount = self.runningCount + 1;
+  }
+  [self _runBlock:block];
+  return YES;
+}
+
+@end
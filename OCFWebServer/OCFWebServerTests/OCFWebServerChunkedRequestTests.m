@@ -0,0 +1,73 @@
+//
+//  OCFWebServerChunkedRequestTests.m
+//  OCFWebServerTests
+//
+
+#import <XCTest/XCTest.h>
+#import "OCFWebServer.h"
+#import "OCFWebServerRequest.h"
+#import "OCFWebServerResponse.h"
+#import "OCFWebServerTestClient.h"
+
+@interface OCFWebServerChunkedRequestTests : XCTestCase
+@property(nonatomic, strong) OCFWebServer* server;
+@end
+
+@implementation OCFWebServerChunkedRequestTests
+
+- (void)setUp {
+  [super setUp];
+  self.server = [[OCFWebServer alloc] init];
+  [self.server addHandlerForMethod:@"POST" path:@"/echo" requestClass:[OCFWebServerDataRequest class] processBlock:^(OCFWebServerRequest* request) {
+    NSData* data = [(OCFWebServerDataRequest*)request data];
+    [request respondWith:[OCFWebServerDataResponse responseWithData:(data ? data : [NSData data]) contentType:@"text/plain"]];
+  }];
+  XCTAssertTrue([self.server startWithListenAddresses:@[@"127.0.0.1:0"] bonjourName:nil maxPendingConnections:16]);
+}
+
+- (void)tearDown {
+  [self.server stop];
+  self.server = nil;
+  [super tearDown];
+}
+
+// Sends the request in pieces of the given length (0 for all at once) and returns the response or nil
+- (OCFWebServerTestResponse*)_sendRequest:(NSString*)request pieceLength:(NSUInteger)pieceLength {
+  OCFWebServerTestClient* client = [[OCFWebServerTestClient alloc] initWithPort:self.server.port];
+  return ([client sendString:request pieceLength:pieceLength] ? [client readResponse] : nil);
+}
+
+- (NSString*)_chunkedRequestWithBody:(NSString*)body {
+  return [@"POST /echo HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\nTransfer-Encoding: chunked\r\n\r\n" stringByAppendingString:body];
+}
+
+- (void)testChunkExtensions {
+  NSString* request = [self _chunkedRequestWithBody:@"5;name=value\r\nhello\r\n6 ; ext\r\n world\r\n0\r\n\r\n"];
+  OCFWebServerTestResponse* response = [self _sendRequest:request pieceLength:0];
+  XCTAssertEqual(response.statusCode, (NSInteger)200);
+  XCTAssertEqualObjects(response.bodyString, @"hello world");
+}
+
+- (void)testTrailersAreIgnored {
+  NSString* request = [self _chunkedRequestWithBody:@"B\r\nhello world\r\n0;last\r\nTrailer-One: x\r\nTrailer-Two: y\r\n\r\n"];
+  OCFWebServerTestResponse* response = [self _sendRequest:request pieceLength:0];
+  XCTAssertEqual(response.statusCode, (NSInteger)200);
+  XCTAssertEqualObjects(response.bodyString, @"hello world");
+}
+
+- (void)testChunkLinesAcrossReads {
+  NSString* request = [self _chunkedRequestWithBody:@"1a;some=extension\r\nabcdefghijklmnopqrstuvwxyz\r\n3\r\n012\r\n0\r\nTrailer: x\r\n\r\n"];
+  for (NSUInteger pieceLength = 1; pieceLength <= 5; ++pieceLength) {
+    OCFWebServerTestResponse* response = [self _sendRequest:request pieceLength:pieceLength];
+    XCTAssertEqual(response.statusCode, (NSInteger)200, @"Pieces of %lu bytes", (unsigned long)pieceLength);
+    XCTAssertEqualObjects(response.bodyString, @"abcdefghijklmnopqrstuvwxyz012");
+  }
+}
+
+- (void)testEmptyBody {
+  OCFWebServerTestResponse* response = [self _sendRequest:[self _chunkedRequestWithBody:@"0\r\n\r\n"] pieceLength:0];
+  XCTAssertEqual(response.statusCode, (NSInteger)200);
+  XCTAssertEqualObjects(response.bodyString, @"");
+}
+
+@end
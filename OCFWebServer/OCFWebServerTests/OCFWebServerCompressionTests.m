@@ -0,0 +1,219 @@
+//
+//  OCFWebServerCompressionTests.m
+//  OCFWebServerTests
+//
+
+#import <XCTest/XCTest.h>
+#import <zlib.h>
+#import "OCFWebServer.h"
+#import "OCFWebServerRequest.h"
+#import "OCFWebServerResponse.h"
+#import "OCFWebServerTestClient.h"
+
+@interface OCFWebServerCompressionTests : XCTestCase
+@property(nonatomic, strong) OCFWebServer* server;
+@property(nonatomic, copy) NSString* directory;
+@property(nonatomic, copy) NSString* text;  // Large enough to be compressed
+@end
+
+@implementation OCFWebServerCompressionTests
+
+// Handles both gzip and zlib wrappers
+- (NSData*)_inflateData:(NSData*)data {
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  if (inflateInit2(&stream, MAX_WBITS + 32) != Z_OK) {
+    return nil;
+  }
+  NSMutableData* result = [NSMutableData data];
+  unsigned char buffer[4096];
+  stream.next_in = (Bytef*)data.bytes;
+  stream.avail_in = (uInt)data.length;
+  int status;
+  do {
+    stream.next_out = buffer;
+    stream.avail_out = sizeof(buffer);
+    status = inflate(&stream, Z_NO_FLUSH);
+    [result appendBytes:buffer length:(sizeof(buffer) - stream.avail_out)];
+  } while (status == Z_OK);
+  inflateEnd(&stream);
+  return (status == Z_STREAM_END ? result : nil);
+}
+
+- (NSData*)_gzipData:(NSData*)data {
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, MAX_WBITS + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+    return nil;
+  }
+  NSMutableData* result = [NSMutableData dataWithLength:deflateBound(&stream, data.length)];
+  stream.next_in = (Bytef*)data.bytes;
+  stream.avail_in = (uInt)data.length;
+  stream.next_out = result.mutableBytes;
+  stream.avail_out = (uInt)result.length;
+  int status = deflate(&stream, Z_FINISH);
+  result.length = stream.total_out;
+  deflateEnd(&stream);
+  return (status == Z_STREAM_END ? result : nil);
+}
+
+- (NSString*)_textWithLength:(NSUInteger)length {
+  NSMutableString* text = [NSMutableString stringWithCapacity:length];
+  for (NSUInteger i = 0; i < length; ++i) {
+    [text appendFormat:@"%c", (char)('a' + i % 26)];
+  }
+  return text;
+}
+
+- (void)setUp {
+  [super setUp];
+  self.text = [self _textWithLength:4096];
+  self.directory = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSProcessInfo processInfo] globallyUniqueString]];
+  XCTAssertTrue([[NSFileManager defaultManager] createDirectoryAtPath:self.directory withIntermediateDirectories:YES attributes:nil error:NULL]);
+  NSData* pageData = [self.text dataUsingEncoding:NSUTF8StringEncoding];
+  XCTAssertTrue([pageData writeToFile:[self.directory stringByAppendingPathComponent:@"page.txt"] atomically:NO]);
+  XCTAssertTrue([[self _gzipData:pageData] writeToFile:[self.directory stringByAppendingPathComponent:@"page.txt.gz"] atomically:NO]);  // Not older than the file
+  XCTAssertTrue([[self _textWithLength:100000] writeToFile:[self.directory stringByAppendingPathComponent:@"large.txt"] atomically:NO encoding:NSUTF8StringEncoding error:NULL]);
+
+  self.server = [[OCFWebServer alloc] init];
+  NSString* text = self.text;
+  [self.server addHandlerForMethod:@"GET" path:@"/text" requestClass:[OCFWebServerRequest class] processBlock:^(OCFWebServerRequest* request) {
+    NSUInteger length = (request.query[@"length"] ? (NSUInteger)[request.query[@"length"] integerValue] : text.length);
+    [request respondWith:[OCFWebServerDataResponse responseWithText:[text substringToIndex:length]]];
+  }];
+  [self.server addHandlerForMethod:@"GET" path:@"/binary" requestClass:[OCFWebServerRequest class] processBlock:^(OCFWebServerRequest* request) {
+    NSData* data = [text dataUsingEncoding:NSUTF8StringEncoding];
+    [request respondWith:[OCFWebServerDataResponse responseWithData:data contentType:@"application/octet-stream"]];
+  }];
+  [self.server addHandlerForBasePath:@"/files/" localPath:self.directory indexFilename:nil cacheAge:0];
+}
+
+- (void)tearDown {
+  [self.server stop];
+  self.server = nil;
+  [[NSFileManager defaultManager] removeItemAtPath:self.directory error:NULL];
+  [super tearDown];
+}
+
+- (OCFWebServerTestClient*)_startAndConnect {
+  XCTAssertTrue([self.server startWithListenAddresses:@[@"127.0.0.1:0"] bonjourName:nil maxPendingConnections:16]);
+  OCFWebServerTestClient* client = [[OCFWebServerTestClient alloc] initWithPort:self.server.port];
+  XCTAssertNotNil(client);
+  return client;
+}
+
+// Pass nil to send no Accept-Encoding header
+- (OCFWebServerTestResponse*)_getPath:(NSString*)path acceptEncoding:(NSString*)acceptEncoding client:(OCFWebServerTestClient*)client {
+  NSMutableString* request = [NSMutableString stringWithFormat:@"GET %@ HTTP/1.1\r\nHost: localhost\r\n", path];
+  if (acceptEncoding) {
+    [request appendFormat:@"Accept-Encoding: %@\r\n", acceptEncoding];
+  }
+  [request appendString:@"\r\n"];
+  return ([client sendString:request] ? [client readResponse] : nil);
+}
+
+- (void)_assertIdentityResponse:(OCFWebServerTestResponse*)response text:(NSString*)text {
+  XCTAssertEqual(response.statusCode, (NSInteger)200);
+  XCTAssertNil(response.headers[@"Content-Encoding"]);
+  XCTAssertEqualObjects(response.headers[@"Content-Length"], ([NSString stringWithFormat:@"%lu", (unsigned long)text.length]));
+  XCTAssertEqualObjects(response.bodyString, text);
+}
+
+- (void)testGzip {
+  OCFWebServerTestClient* client = [self _startAndConnect];
+  for (NSUInteger i = 0; i < 2; ++i) {  // The connection stays usable after a compressed body
+    OCFWebServerTestResponse* response = [self _getPath:@"/text" acceptEncoding:@"gzip" client:client];
+    XCTAssertEqual(response.statusCode, (NSInteger)200);
+    XCTAssertEqualObjects(response.headers[@"Content-Encoding"], @"gzip");
+    XCTAssertEqualObjects(response.headers[@"Vary"], @"Accept-Encoding");
+    XCTAssertEqualObjects(response.headers[@"Transfer-Encoding"], @"chunked");
+    XCTAssertNil(response.headers[@"Content-Length"]);
+    XCTAssertTrue(response.body.length < self.text.length);
+    const unsigned char* bytes = response.body.bytes;
+    XCTAssertTrue((response.body.length > 2) && (bytes[0] == 0x1f) && (bytes[1] == 0x8b));
+    XCTAssertEqualObjects([[NSString alloc] initWithData:[self _inflateData:response.body] encoding:NSUTF8StringEncoding], self.text);
+  }
+}
+
+- (void)testDeflate {
+  OCFWebServerTestClient* client = [self _startAndConnect];
+  OCFWebServerTestResponse* response = [self _getPath:@"/text" acceptEncoding:@"deflate" client:client];
+  XCTAssertEqual(response.statusCode, (NSInteger)200);
+  XCTAssertEqualObjects(response.headers[@"Content-Encoding"], @"deflate");
+  XCTAssertEqualObjects([[NSString alloc] initWithData:[self _inflateData:response.body] encoding:NSUTF8StringEncoding], self.text);
+}
+
+- (void)testNegotiation {
+  OCFWebServerTestClient* client = [self _startAndConnect];
+  XCTAssertEqualObjects([self _getPath:@"/text" acceptEncoding:@"deflate, gzip" client:client].headers[@"Content-Encoding"], @"gzip");  // Preferred on ties
+  XCTAssertEqualObjects([self _getPath:@"/text" acceptEncoding:@"gzip;q=0.5, deflate" client:client].headers[@"Content-Encoding"], @"deflate");
+  XCTAssertEqualObjects([self _getPath:@"/text" acceptEncoding:@"*" client:client].headers[@"Content-Encoding"], @"gzip");
+  [self _assertIdentityResponse:[self _getPath:@"/text" acceptEncoding:nil client:client] text:self.text];
+  [self _assertIdentityResponse:[self _getPath:@"/text" acceptEncoding:@"gzip;q=0" client:client] text:self.text];
+  [self _assertIdentityResponse:[self _getPath:@"/text" acceptEncoding:@"br" client:client] text:self.text];
+}
+
+- (void)testUncompressedResponses {
+  OCFWebServerTestClient* client = [self _startAndConnect];
+  NSString* smallText = [self.text substringToIndex:100];
+  OCFWebServerTestResponse* response = [self _getPath:@"/text?length=100" acceptEncoding:@"gzip" client:client];
+  [self _assertIdentityResponse:response text:smallText];
+  XCTAssertNil(response.headers[@"Vary"]);  // Below the minimum size whatever the client accepts
+
+  response = [self _getPath:@"/binary" acceptEncoding:@"gzip" client:client];
+  [self _assertIdentityResponse:response text:self.text];
+  XCTAssertNil(response.headers[@"Vary"]);
+}
+
+- (void)testCompressionDisabled {
+  self.server.compressionLevel = 0;
+  OCFWebServerTestClient* client = [self _startAndConnect];
+  [self _assertIdentityResponse:[self _getPath:@"/text" acceptEncoding:@"gzip" client:client] text:self.text];
+}
+
+- (void)testHTTP10 {
+  OCFWebServerTestClient* client = [self _startAndConnect];
+  XCTAssertTrue([client sendString:@"GET /text HTTP/1.0\r\nConnection: keep-alive\r\nAccept-Encoding: gzip\r\n\r\n"]);
+  OCFWebServerTestResponse* response = [client readResponse];  // Delimited by the end of the stream instead of chunked framing
+  XCTAssertEqual(response.statusCode, (NSInteger)200);
+  XCTAssertEqualObjects(response.headers[@"Content-Encoding"], @"gzip");
+  XCTAssertNil(response.headers[@"Transfer-Encoding"]);
+  XCTAssertEqualObjects([response.headers[@"Connection"] lowercaseString], @"close");
+  XCTAssertEqualObjects([[NSString alloc] initWithData:[self _inflateData:response.body] encoding:NSUTF8StringEncoding], self.text);
+}
+
+- (void)testPrecompressedFile {
+  OCFWebServerTestClient* client = [self _startAndConnect];
+  NSData* gzipData = [NSData dataWithContentsOfFile:[self.directory stringByAppendingPathComponent:@"page.txt.gz"]];
+  OCFWebServerTestResponse* response = [self _getPath:@"/files/page.txt" acceptEncoding:@"gzip" client:client];
+  XCTAssertEqual(response.statusCode, (NSInteger)200);
+  XCTAssertEqualObjects(response.headers[@"Content-Encoding"], @"gzip");
+  XCTAssertEqualObjects(response.headers[@"Vary"], @"Accept-Encoding");
+  XCTAssertTrue([response.headers[@"Content-Type"] hasPrefix:@"text/plain"]);  // Of the uncompressed file
+  XCTAssertEqualObjects(response.body, gzipData);  // Sent as is rather than compressed again
+
+  response = [self _getPath:@"/files/page.txt" acceptEncoding:nil client:client];
+  XCTAssertNil(response.headers[@"Content-Encoding"]);
+  XCTAssertEqualObjects(response.headers[@"Vary"], @"Accept-Encoding");
+  XCTAssertEqualObjects(response.bodyString, self.text);
+
+  XCTAssertTrue([client sendString:@"GET /files/page.txt HTTP/1.1\r\nHost: localhost\r\nAccept-Encoding: gzip\r\nRange: bytes=0-9\r\n\r\n"]);
+  response = [client readResponse];  // Ranges apply to the uncompressed file
+  XCTAssertEqual(response.statusCode, (NSInteger)206);
+  XCTAssertNil(response.headers[@"Content-Encoding"]);
+  XCTAssertEqualObjects(response.bodyString, [self.text substringToIndex:10]);
+}
+
+- (void)testWeakETag {
+  OCFWebServerTestClient* client = [self _startAndConnect];
+  NSString* eTag = [self _getPath:@"/files/large.txt" acceptEncoding:nil client:client].headers[@"ETag"];
+  XCTAssertTrue([eTag hasPrefix:@"\""]);
+  OCFWebServerTestResponse* response = [self _getPath:@"/files/large.txt" acceptEncoding:@"gzip" client:client];
+  XCTAssertEqualObjects(response.headers[@"Content-Encoding"], @"gzip");
+  XCTAssertEqualObjects(response.headers[@"ETag"], [@"W/" stringByAppendingString:eTag]);
+
+  XCTAssertTrue([client sendString:[NSString stringWithFormat:@"GET /files/large.txt HTTP/1.1\r\nHost: localhost\r\nAccept-Encoding: gzip\r\nIf-None-Match: W/%@\r\n\r\n", eTag]]);
+  XCTAssertEqual([client readResponse].statusCode, (NSInteger)304);
+}
+
+@end
@@ -0,0 +1,168 @@
+//
+//  OCFWebServerConditionalRangeTests.m
+//  OCFWebServerTests
+//
+
+#import <XCTest/XCTest.h>
+#import "OCFWebServer.h"
+#import "OCFWebServerResponse.h"
+#import "OCFWebServerTestClient.h"
+
+@interface OCFWebServerConditionalRangeTests : XCTestCase
+@property(nonatomic, strong) OCFWebServer* server;
+@property(nonatomic, copy) NSString* directory;
+@property(nonatomic, strong) OCFWebServerTestClient* client;
+@end
+
+@implementation OCFWebServerConditionalRangeTests
+
+- (NSString*)_textWithLength:(NSUInteger)length {
+  NSMutableString* text = [NSMutableString stringWithCapacity:length];
+  for (NSUInteger i = 0; i < length; ++i) {
+    [text appendFormat:@"%c", (char)('a' + i % 26)];
+  }
+  return text;
+}
+
+- (void)setUp {
+  [super setUp];
+  self.directory = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSProcessInfo processInfo] globallyUniqueString]];
+  XCTAssertTrue([[NSFileManager defaultManager] createDirectoryAtPath:self.directory withIntermediateDirectories:YES attributes:nil error:NULL]);
+  XCTAssertTrue([[self _textWithLength:100] writeToFile:[self.directory stringByAppendingPathComponent:@"small.txt"] atomically:NO encoding:NSUTF8StringEncoding error:NULL]);
+  XCTAssertTrue([[self _textWithLength:200000] writeToFile:[self.directory stringByAppendingPathComponent:@"large.txt"] atomically:NO encoding:NSUTF8StringEncoding error:NULL]);
+
+  self.server = [[OCFWebServer alloc] init];
+  [self.server addHandlerForBasePath:@"/files/" localPath:self.directory indexFilename:nil cacheAge:0];
+  XCTAssertTrue([self.server startWithListenAddresses:@[@"127.0.0.1:0"] bonjourName:nil maxPendingConnections:16]);
+  self.client = [[OCFWebServerTestClient alloc] initWithPort:self.server.port];  // Every test also checks the framing keeps the connection usable
+}
+
+- (void)tearDown {
+  self.client = nil;
+  [self.server stop];
+  self.server = nil;
+  [[NSFileManager defaultManager] removeItemAtPath:self.directory error:NULL];
+  [super tearDown];
+}
+
+- (OCFWebServerTestResponse*)_getPath:(NSString*)path headers:(NSDictionary*)headers {
+  NSMutableString* request = [NSMutableString stringWithFormat:@"GET %@ HTTP/1.1\r\nHost: localhost\r\n", path];
+  [headers enumerateKeysAndObjectsUsingBlock:^(NSString* name, NSString* value, BOOL* stop) {
+    [request appendFormat:@"%@: %@\r\n", name, value];
+  }];
+  [request appendString:@"\r\n"];
+  return ([self.client sendString:request] ? [self.client readResponse] : nil);
+}
+
+- (void)_assertRangeResponse:(OCFWebServerTestResponse*)response location:(NSUInteger)location length:(NSUInteger)length size:(NSUInteger)size {
+  XCTAssertEqual(response.statusCode, (NSInteger)206);
+  NSString* contentRange = [NSString stringWithFormat:@"bytes %lu-%lu/%lu", (unsigned long)location, (unsigned long)(location + length - 1), (unsigned long)size];
+  XCTAssertEqualObjects(response.headers[@"Content-Range"], contentRange);
+  XCTAssertEqualObjects(response.bodyString, [[self _textWithLength:size] substringWithRange:NSMakeRange(location, length)]);
+}
+
+- (void)testValidators {
+  for (NSString* name in @[@"small.txt", @"large.txt"]) {
+    OCFWebServerTestResponse* response = [self _getPath:[@"/files/" stringByAppendingString:name] headers:nil];
+    XCTAssertEqual(response.statusCode, (NSInteger)200);
+    XCTAssertTrue([response.headers[@"ETag"] hasPrefix:@"\""]);
+    XCTAssertNotNil(response.headers[@"Last-Modified"]);
+    XCTAssertEqualObjects(response.headers[@"Accept-Ranges"], @"bytes");
+  }
+}
+
+- (void)testIfNoneMatch {
+  for (NSString* path in @[@"/files/small.txt", @"/files/large.txt"]) {
+    NSString* eTag = [self _getPath:path headers:nil].headers[@"ETag"];
+    for (NSString* header in @[eTag, [@"W/" stringByAppendingString:eTag], @"*", [@"\"other\", " stringByAppendingString:eTag]]) {
+      OCFWebServerTestResponse* response = [self _getPath:path headers:@{@"If-None-Match": header}];
+      XCTAssertEqual(response.statusCode, (NSInteger)304, @"%@", header);
+      XCTAssertEqualObjects(response.headers[@"ETag"], eTag);
+    }
+    OCFWebServerTestResponse* response = [self _getPath:path headers:@{@"If-None-Match": @"\"other\""}];
+    XCTAssertEqual(response.statusCode, (NSInteger)200);
+  }
+}
+
+- (void)testIfModifiedSince {
+  NSString* lastModified = [self _getPath:@"/files/small.txt" headers:nil].headers[@"Last-Modified"];
+  XCTAssertEqual([self _getPath:@"/files/small.txt" headers:@{@"If-Modified-Since": lastModified}].statusCode, (NSInteger)304);
+  XCTAssertEqual([self _getPath:@"/files/small.txt" headers:@{@"If-Modified-Since": @"Thu, 01 Jan 1970 00:00:00 GMT"}].statusCode, (NSInteger)200);
+  XCTAssertEqual([self _getPath:@"/files/small.txt" headers:@{@"If-Modified-Since": @"not a date"}].statusCode, (NSInteger)200);
+  NSDictionary* headers = @{@"If-None-Match": @"\"other\"", @"If-Modified-Since": lastModified};  // If-None-Match takes precedence
+  XCTAssertEqual([self _getPath:@"/files/small.txt" headers:headers].statusCode, (NSInteger)200);
+}
+
+- (void)testSingleRanges {
+  for (NSNumber* size in @[@100, @200000]) {
+    NSUInteger length = size.unsignedIntegerValue;
+    NSString* path = (length == 100 ? @"/files/small.txt" : @"/files/large.txt");
+    [self _assertRangeResponse:[self _getPath:path headers:@{@"Range": @"bytes=0-9"}] location:0 length:10 size:length];
+    [self _assertRangeResponse:[self _getPath:path headers:@{@"Range": @"bytes=10-"}] location:10 length:(length - 10) size:length];
+    [self _assertRangeResponse:[self _getPath:path headers:@{@"Range": @"bytes=-5"}] location:(length - 5) length:5 size:length];
+    [self _assertRangeResponse:[self _getPath:path headers:@{@"Range": @"bytes=-1000000"}] location:0 length:length size:length];
+    [self _assertRangeResponse:[self _getPath:path headers:@{@"Range": @"bytes=50-99999999"}] location:50 length:(length - 50) size:length];
+    [self _assertRangeResponse:[self _getPath:path headers:@{@"Range": @"bytes= 3-4 "}] location:3 length:2 size:length];
+    [self _assertRangeResponse:[self _getPath:path headers:@{@"Range": @"BYTES=7-7"}] location:7 length:1 size:length];
+  }
+}
+
+- (void)testUnsatisfiableRanges {
+  for (NSString* range in @[@"bytes=100-", @"bytes=100-200", @"bytes=-0", @"bytes=500-600,700-"]) {
+    OCFWebServerTestResponse* response = [self _getPath:@"/files/small.txt" headers:@{@"Range": range}];
+    XCTAssertEqual(response.statusCode, (NSInteger)416, @"%@", range);
+    XCTAssertEqualObjects(response.headers[@"Content-Range"], @"bytes */100");
+  }
+}
+
+- (void)testIgnoredRanges {
+  NSMutableString* tooManyRanges = [NSMutableString stringWithString:@"bytes=0-0"];
+  for (NSUInteger i = 1; i <= 16; ++i) {
+    [tooManyRanges appendFormat:@",%lu-%lu", (unsigned long)(2 * i), (unsigned long)(2 * i)];
+  }
+  NSArray* ranges = @[@"bytes=5-1", @"items=0-1", @"bytes=abc", @"bytes=-", @"bytes=0-1;", @"bytes=0-1,,2-3", @"bytes=99999999999999999999999-", tooManyRanges];
+  for (NSString* range in ranges) {
+    OCFWebServerTestResponse* response = [self _getPath:@"/files/small.txt" headers:@{@"Range": range}];
+    XCTAssertEqual(response.statusCode, (NSInteger)200, @"%@", range);
+    XCTAssertEqualObjects(response.bodyString, [self _textWithLength:100]);
+  }
+}
+
+- (void)testMultipleRanges {
+  for (NSNumber* size in @[@100, @200000]) {
+    NSUInteger length = size.unsignedIntegerValue;
+    NSString* path = (length == 100 ? @"/files/small.txt" : @"/files/large.txt");
+    NSString* text = [self _textWithLength:length];
+    NSString* fileContentType = [self _getPath:path headers:nil].headers[@"Content-Type"];
+    OCFWebServerTestResponse* response = [self _getPath:path headers:@{@"Range": @"bytes=0-1, 4-5,-3"}];
+    XCTAssertEqual(response.statusCode, (NSInteger)206);
+    NSString* contentType = response.headers[@"Content-Type"];
+    XCTAssertTrue([contentType hasPrefix:@"multipart/byteranges; boundary="]);
+    NSString* boundary = [contentType substringFromIndex:@"multipart/byteranges; boundary=".length];
+
+    NSMutableString* expected = [NSMutableString string];
+    NSRange parts[] = {NSMakeRange(0, 2), NSMakeRange(4, 2), NSMakeRange(length - 3, 3)};
+    for (NSUInteger i = 0; i < 3; ++i) {
+      [expected appendFormat:@"\r\n--%@\r\nContent-Type: %@\r\nContent-Range: bytes %lu-%lu/%lu\r\n\r\n%@", boundary, fileContentType,
+                             (unsigned long)parts[i].location, (unsigned long)NSMaxRange(parts[i]) - 1, (unsigned long)length, [text substringWithRange:parts[i]]];
+    }
+    [expected appendFormat:@"\r\n--%@--\r\n", boundary];
+    XCTAssertEqualObjects(response.bodyString, expected);
+  }
+
+  // Unsatisfiable ranges are dropped so a single one left is not sent as multipart
+  [self _assertRangeResponse:[self _getPath:@"/files/small.txt" headers:@{@"Range": @"bytes=1000-2000,2-3"}] location:2 length:2 size:100];
+}
+
+- (void)testIfRange {
+  OCFWebServerTestResponse* response = [self _getPath:@"/files/large.txt" headers:nil];
+  NSString* eTag = response.headers[@"ETag"];
+  NSString* lastModified = response.headers[@"Last-Modified"];
+  [self _assertRangeResponse:[self _getPath:@"/files/large.txt" headers:@{@"Range": @"bytes=0-9", @"If-Range": eTag}] location:0 length:10 size:200000];
+  [self _assertRangeResponse:[self _getPath:@"/files/large.txt" headers:@{@"Range": @"bytes=0-9", @"If-Range": lastModified}] location:0 length:10 size:200000];
+  response = [self _getPath:@"/files/large.txt" headers:@{@"Range": @"bytes=0-9", @"If-Range": @"\"stale\""}];
+  XCTAssertEqual(response.statusCode, (NSInteger)200);
+  XCTAssertEqual(response.body.length, (NSUInteger)200000);
+}
+
+@end
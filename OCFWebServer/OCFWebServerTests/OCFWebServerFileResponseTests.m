@@ -0,0 +1,107 @@
+//
+//  OCFWebServerFileResponseTests.m
+//  OCFWebServerTests
+//
+
+#import <XCTest/XCTest.h>
+#import "OCFWebServer.h"
+#import "OCFWebServerRequest.h"
+#import "OCFWebServerResponse.h"
+#import "OCFWebServerTestClient.h"
+
+@interface OCFWebServerFileResponseTests : XCTestCase
+@property(nonatomic, strong) OCFWebServer* server;
+@property(nonatomic, copy) NSString* directory;
+@property(nonatomic, strong) NSData* largeData;  // Larger than the contents the file cache keeps in memory
+@end
+
+@implementation OCFWebServerFileResponseTests
+
+- (NSData*)_dataWithLength:(NSUInteger)length {
+  NSMutableData* data = [NSMutableData dataWithLength:length];
+  unsigned char* bytes = data.mutableBytes;
+  for (NSUInteger i = 0; i < length; ++i) {
+    bytes[i] = (unsigned char)(i % 251);  // Misaligned with any buffer size
+  }
+  return data;
+}
+
+- (void)setUp {
+  [super setUp];
+  self.directory = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSProcessInfo processInfo] globallyUniqueString]];
+  XCTAssertTrue([[NSFileManager defaultManager] createDirectoryAtPath:self.directory withIntermediateDirectories:YES attributes:nil error:NULL]);
+  self.largeData = [self _dataWithLength:(3 * 1024 * 1024 + 17)];
+  XCTAssertTrue([self.largeData writeToFile:[self.directory stringByAppendingPathComponent:@"large.bin"] atomically:NO]);
+  XCTAssertTrue([[self _dataWithLength:100] writeToFile:[self.directory stringByAppendingPathComponent:@"small.bin"] atomically:NO]);
+  XCTAssertTrue([[NSData data] writeToFile:[self.directory stringByAppendingPathComponent:@"empty.bin"] atomically:NO]);
+
+  self.server = [[OCFWebServer alloc] init];
+  [self.server addHandlerForBasePath:@"/files/" localPath:self.directory indexFilename:nil cacheAge:0];
+  NSString* largePath = [self.directory stringByAppendingPathComponent:@"large.bin"];
+  OCFWebServerProcessBlock downloadBlock = ^(OCFWebServerRequest* request) {
+    [request respondWith:[OCFWebServerFileResponse responseWithFile:largePath isAttachment:YES]];
+  };
+  [self.server addHandlerForMethod:@"GET" path:@"/download" requestClass:[OCFWebServerRequest class] processBlock:downloadBlock];
+  [self.server addHandlerForMethod:@"HEAD" path:@"/download" requestClass:[OCFWebServerRequest class] processBlock:downloadBlock];
+  XCTAssertTrue([self.server startWithListenAddresses:@[@"127.0.0.1:0"] bonjourName:nil maxPendingConnections:16]);
+}
+
+- (void)tearDown {
+  [self.server stop];
+  self.server = nil;
+  [[NSFileManager defaultManager] removeItemAtPath:self.directory error:NULL];
+  [super tearDown];
+}
+
+- (OCFWebServerTestResponse*)_getPath:(NSString*)path client:(OCFWebServerTestClient*)client {
+  NSString* request = [NSString stringWithFormat:@"GET %@ HTTP/1.1\r\nHost: localhost\r\n\r\n", path];
+  return ([client sendString:request] ? [client readResponse] : nil);
+}
+
+- (void)testLargeFiles {
+  OCFWebServerTestClient* client = [[OCFWebServerTestClient alloc] initWithPort:self.server.port];
+  for (NSUInteger i = 0; i < 3; ++i) {  // The connection stays usable once a body has been sent from the file
+    OCFWebServerTestResponse* response = [self _getPath:@"/files/large.bin" client:client];
+    XCTAssertEqual(response.statusCode, (NSInteger)200);
+    XCTAssertEqualObjects(response.headers[@"Content-Length"], ([NSString stringWithFormat:@"%lu", (unsigned long)self.largeData.length]));
+    XCTAssertTrue([response.body isEqualToData:self.largeData]);
+  }
+}
+
+- (void)testSmallAndEmptyFiles {
+  OCFWebServerTestClient* client = [[OCFWebServerTestClient alloc] initWithPort:self.server.port];
+  OCFWebServerTestResponse* response = [self _getPath:@"/files/small.bin" client:client];
+  XCTAssertEqual(response.statusCode, (NSInteger)200);
+  XCTAssertEqualObjects(response.body, [self _dataWithLength:100]);
+
+  response = [self _getPath:@"/files/empty.bin" client:client];
+  XCTAssertEqual(response.statusCode, (NSInteger)200);
+  XCTAssertEqualObjects(response.headers[@"Content-Length"], @"0");
+  XCTAssertEqual(response.body.length, (NSUInteger)0);
+
+  response = [self _getPath:@"/files/small.bin" client:client];
+  XCTAssertEqualObjects(response.body, [self _dataWithLength:100]);
+}
+
+- (void)testFileResponse {
+  OCFWebServerTestClient* client = [[OCFWebServerTestClient alloc] initWithPort:self.server.port];
+  OCFWebServerTestResponse* response = [self _getPath:@"/download" client:client];
+  XCTAssertEqual(response.statusCode, (NSInteger)200);
+  XCTAssertEqualObjects(response.headers[@"Content-Disposition"], @"attachment; filename=\"large.bin\"");
+  XCTAssertTrue([response.body isEqualToData:self.largeData]);
+
+  XCTAssertTrue([client sendString:@"HEAD /download HTTP/1.1\r\nHost: localhost\r\n\r\n"]);
+  response = [client readResponseWithoutBody];
+  XCTAssertEqual(response.statusCode, (NSInteger)200);
+  XCTAssertEqualObjects(response.headers[@"Content-Length"], ([NSString stringWithFormat:@"%lu", (unsigned long)self.largeData.length]));
+  response = [self _getPath:@"/files/small.bin" client:client];  // Would read the file if it had been sent for the HEAD request
+  XCTAssertEqualObjects(response.body, [self _dataWithLength:100]);
+}
+
+- (void)testMissingFile {
+  OCFWebServerTestClient* client = [[OCFWebServerTestClient alloc] initWithPort:self.server.port];
+  OCFWebServerTestResponse* response = [self _getPath:@"/files/missing.bin" client:client];
+  XCTAssertEqual(response.statusCode, (NSInteger)404);
+}
+
+@end
@@ -0,0 +1,93 @@
+//
+//  OCFWebServerFormDecoderTests.m
+//  OCFWebServerTests
+//
+
+#import <XCTest/XCTest.h>
+#import "OCFWebServerFormDecoder.h"
+
+@interface OCFWebServerFormDecoderTests : XCTestCase
+@end
+
+@implementation OCFWebServerFormDecoderTests
+
+- (NSDictionary*)_decodeString:(NSString*)string {
+  return [self _decodeString:string encoding:NSUTF8StringEncoding];
+}
+
+- (NSDictionary*)_decodeString:(NSString*)string encoding:(NSStringEncoding)encoding {
+  NSData* data = [string dataUsingEncoding:NSASCIIStringEncoding];
+  return OCFWebServerDecodeURLEncodedForm(data.bytes, data.length, encoding);
+}
+
+- (void)testPairs {
+  XCTAssertEqualObjects([self _decodeString:@"a=1&b=2&c=3"], (@{@"a": @"1", @"b": @"2", @"c": @"3"}));
+  XCTAssertEqualObjects([self _decodeString:@""], @{});
+  XCTAssertEqualObjects([self _decodeString:@"&&"], @{});
+  XCTAssertEqualObjects([self _decodeString:@"a=b=c"], @{@"a": @"b=c"});  // Only the first "=" separates the key from the value
+  XCTAssertEqualObjects([self _decodeString:@"a=1&a=2"], @{@"a": @"2"});  // Last of duplicate keys wins
+  XCTAssertEqualObjects([self _decodeString:@"=b"], @{@"": @"b"});
+}
+
+- (void)testEmptyValues {
+  XCTAssertEqualObjects([self _decodeString:@"a="], @{@"a": @""});
+  XCTAssertEqualObjects([self _decodeString:@"a"], @{@"a": @""});
+  XCTAssertEqualObjects([self _decodeString:@"a=&b&c=3"], (@{@"a": @"", @"b": @"", @"c": @"3"}));
+}
+
+- (void)testEscapes {
+  XCTAssertEqualObjects([self _decodeString:@"q=a+b"], @{@"q": @"a b"});
+  XCTAssertEqualObjects([self _decodeString:@"q=a%2Bb"], @{@"q": @"a+b"});
+  XCTAssertEqualObjects([self _decodeString:@"q=%26%3d%25"], @{@"q": @"&=%"});
+  XCTAssertEqualObjects([self _decodeString:@"caf%C3%A9=%E2%82%AC"], @{@"café": @"€"});
+}
+
+- (void)testMalformedEscapes {
+  XCTAssertEqualObjects([self _decodeString:@"q=%zz"], @{@"q": @"%zz"});
+  XCTAssertEqualObjects([self _decodeString:@"q=%4"], @{@"q": @"%4"});
+  XCTAssertEqualObjects([self _decodeString:@"q=%"], @{@"q": @"%"});
+  XCTAssertEqualObjects([self _decodeString:@"q=%4g%41"], @{@"q": @"%4gA"});
+  XCTAssertEqualObjects([self _decodeString:@"%=1"], @{@"%": @"1"});
+}
+
+- (void)testInvalidStringsAreSkipped {
+  XCTAssertEqualObjects([self _decodeString:@"a=%E9&b=2"], @{@"b": @"2"});
+  XCTAssertEqualObjects([self _decodeString:@"%E9=1&b=2"], @{@"b": @"2"});
+  XCTAssertEqualObjects([self _decodeString:@"a=%E9" encoding:NSISOLatin1StringEncoding], @{@"a": @"é"});
+}
+
+- (void)testLongInputs {
+  NSString* longKey = [@"" stringByPaddingToLength:100 withString:@"k" startingAtIndex:0];
+  NSString* longValue = [@"" stringByPaddingToLength:1000 withString:@"v" startingAtIndex:0];
+  NSString* string = [NSString stringWithFormat:@"%@=%@&%@+x=a%%20b&tail", longKey, longValue, longValue];
+  NSDictionary* arguments = [self _decodeString:string];
+  XCTAssertEqualObjects(arguments[longKey], longValue);
+  XCTAssertEqualObjects(arguments[[longValue stringByAppendingString:@" x"]], @"a b");
+  XCTAssertEqualObjects(arguments[@"tail"], @"");
+  XCTAssertEqual(arguments.count, (NSUInteger)3);
+
+  // Special bytes at every position of a 16 bytes block
+  for (NSUInteger i = 0; i < 40; ++i) {
+    NSString* key = [@"" stringByPaddingToLength:i withString:@"x" startingAtIndex:0];
+    XCTAssertEqualObjects([self _decodeString:[key stringByAppendingString:@"=%41+"]], @{key: @"A "}, @"Key of %lu bytes", (unsigned long)i);
+  }
+}
+
+- (void)testFormDictionary {
+  OCFWebServerFormDictionary* dictionary = [[OCFWebServerFormDictionary alloc] initWithString:@"a=1&b=%C3%A9"];
+  XCTAssertEqual(dictionary.count, (NSUInteger)2);
+  XCTAssertEqualObjects(dictionary[@"b"], @"é");
+  XCTAssertEqualObjects(dictionary, (@{@"a": @"1", @"b": @"é"}));
+  XCTAssertEqual([dictionary copy], dictionary);
+
+  NSData* data = [@"name=Fran%E7ois" dataUsingEncoding:NSASCIIStringEncoding];
+  dictionary = [[OCFWebServerFormDictionary alloc] initWithData:data encoding:NSISOLatin1StringEncoding];
+  XCTAssertEqualObjects(dictionary[@"name"], @"François");
+  NSMutableArray* keys = [NSMutableArray array];
+  for (NSString* key in dictionary) {
+    [keys addObject:key];
+  }
+  XCTAssertEqualObjects(keys, @[@"name"]);
+}
+
+@end
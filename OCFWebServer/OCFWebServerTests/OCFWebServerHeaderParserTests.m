@@ -0,0 +1,160 @@
+//
+//  OCFWebServerHeaderParserTests.m
+//  OCFWebServerTests
+//
+
+#import <XCTest/XCTest.h>
+#import "OCFWebServerHeaderParser.h"
+
+@interface OCFWebServerHeaderParserTests : XCTestCase
+@end
+
+@implementation OCFWebServerHeaderParserTests
+
+- (OCFWebServerHeaderParserResult)_parseString:(NSString*)string parser:(OCFWebServerHeaderParser*)parser {
+  NSData* data = [string dataUsingEncoding:NSUTF8StringEncoding];
+  NSUInteger consumedLength = 0;
+  return [parser parseBytes:data.bytes length:data.length consumedLength:&consumedLength];
+}
+
+- (OCFWebServerHeaderParser*)_parserWithString:(NSString*)string result:(OCFWebServerHeaderParserResult*)result {
+  OCFWebServerHeaderParser* parser = [[OCFWebServerHeaderParser alloc] initWithMaximumHeaderSize:16 * 1024];
+  *result = [self _parseString:string parser:parser];
+  return parser;
+}
+
+- (void)testRequestLine {
+  OCFWebServerHeaderParserResult result;
+  OCFWebServerHeaderParser* parser = [self _parserWithString:@"GET /a%20b?x=1&y=2 HTTP/1.1\r\nHost: localhost\r\n\r\n" result:&result];
+  XCTAssertEqual(result, OCFWebServerHeaderParserResultComplete);
+  XCTAssertEqualObjects(parser.method, @"GET");
+  XCTAssertEqualObjects(parser.target, @"/a%20b?x=1&y=2");
+  XCTAssertEqualObjects(parser.path, @"/a b");
+  XCTAssertEqualObjects(parser.query, @"x=1&y=2");
+  XCTAssertEqual(parser.majorVersion, (NSUInteger)1);
+  XCTAssertEqual(parser.minorVersion, (NSUInteger)1);
+  XCTAssertEqualObjects(parser.headers[@"Host"], @"localhost");
+}
+
+- (void)testSplitBuffers {
+  NSData* data = [@"POST /upload HTTP/1.1\r\nHost: localhost\r\nContent-Length: 3\r\n\r\nabc" dataUsingEncoding:NSUTF8StringEncoding];
+  NSUInteger headerLength = data.length - 3;
+  for (NSUInteger pieceLength = 1; pieceLength <= 7; ++pieceLength) {
+    OCFWebServerHeaderParser* parser = [[OCFWebServerHeaderParser alloc] initWithMaximumHeaderSize:16 * 1024];
+    OCFWebServerHeaderParserResult result = OCFWebServerHeaderParserResultIncomplete;
+    NSUInteger offset = 0;
+    while ((result == OCFWebServerHeaderParserResultIncomplete) && (offset < data.length)) {
+      NSUInteger length = MIN(pieceLength, data.length - offset);
+      NSUInteger consumedLength = 0;
+      result = [parser parseBytes:((const char*)data.bytes + offset) length:length consumedLength:&consumedLength];
+      XCTAssertTrue(consumedLength <= length);
+      offset += consumedLength;
+    }
+    XCTAssertEqual(result, OCFWebServerHeaderParserResultComplete);
+    XCTAssertEqual(offset, headerLength, @"The body must not be consumed (pieces of %lu bytes)", (unsigned long)pieceLength);
+    XCTAssertEqualObjects(parser.path, @"/upload");
+    XCTAssertEqualObjects(parser.headers[@"Content-Length"], @"3");
+  }
+}
+
+- (void)testStringsOutliveTheParsedBytes {
+  const char* request = "GET /in/place?q=1 HTTP/1.1\r\nHost: localhost\r\nX-Custom: value\r\n\r\n";
+  NSUInteger length = strlen(request);
+  for (NSUInteger split = 0; split < length; split += (length - 1)) {  // In a single piece then split before the last byte
+    char* bytes = malloc(length);
+    memcpy(bytes, request, length);
+    OCFWebServerHeaderParser* parser = [[OCFWebServerHeaderParser alloc] initWithMaximumHeaderSize:16 * 1024];
+    NSUInteger consumedLength = 0;
+    if (split) {
+      XCTAssertEqual([parser parseBytes:bytes length:split consumedLength:&consumedLength], OCFWebServerHeaderParserResultIncomplete);
+    }
+    XCTAssertEqual([parser parseBytes:(bytes + split) length:(length - split) consumedLength:&consumedLength], OCFWebServerHeaderParserResultComplete);
+    memset(bytes, 'x', length);
+    free(bytes);
+    XCTAssertEqualObjects(parser.target, @"/in/place?q=1");
+    XCTAssertEqualObjects(parser.query, @"q=1");
+    XCTAssertEqualObjects(parser.headers[@"Host"], @"localhost");
+    XCTAssertEqualObjects(parser.headers[@"X-Custom"], @"value");
+  }
+}
+
+- (void)testPipelinedRequestIsNotConsumed {
+  OCFWebServerHeaderParser* parser = [[OCFWebServerHeaderParser alloc] initWithMaximumHeaderSize:16 * 1024];
+  const char* bytes = "GET /first HTTP/1.1\r\n\r\nGET /second HTTP/1.1\r\n\r\n";
+  NSUInteger consumedLength = 0;
+  XCTAssertEqual([parser parseBytes:bytes length:strlen(bytes) consumedLength:&consumedLength], OCFWebServerHeaderParserResultComplete);
+  XCTAssertEqual(consumedLength, strlen("GET /first HTTP/1.1\r\n\r\n"));
+  XCTAssertEqualObjects(parser.path, @"/first");
+
+  [parser reset];
+  XCTAssertEqual([parser parseBytes:(bytes + consumedLength) length:(strlen(bytes) - consumedLength) consumedLength:&consumedLength], OCFWebServerHeaderParserResultComplete);
+  XCTAssertEqualObjects(parser.path, @"/second");
+}
+
+- (void)testDuplicateHeadersAreJoined {
+  OCFWebServerHeaderParserResult result;
+  OCFWebServerHeaderParser* parser = [self _parserWithString:@"GET / HTTP/1.1\r\nAccept: text/html\r\naccept: text/plain\r\n\r\n" result:&result];
+  XCTAssertEqual(result, OCFWebServerHeaderParserResultComplete);
+  XCTAssertEqualObjects(parser.headers[@"Accept"], @"text/html, text/plain");
+}
+
+- (void)testHeaderNamesAreCanonicalized {
+  OCFWebServerHeaderParserResult result;
+  OCFWebServerHeaderParser* parser = [self _parserWithString:@"GET / HTTP/1.1\r\ncontent-TYPE: text/plain\r\nx-my-HEADER:\t value \t\r\nHOST:localhost\r\n\r\n" result:&result];
+  XCTAssertEqual(result, OCFWebServerHeaderParserResultComplete);
+  XCTAssertEqualObjects(parser.headers[@"Content-Type"], @"text/plain");
+  XCTAssertEqualObjects(parser.headers[@"X-My-Header"], @"value");
+  XCTAssertEqualObjects(parser.headers[@"Host"], @"localhost");
+  XCTAssertEqual(parser.headers.count, (NSUInteger)3);
+}
+
+- (void)testContentLengthValidation {
+  OCFWebServerHeaderParserResult result;
+  [self _parserWithString:@"POST / HTTP/1.1\r\nContent-Length: 12abc\r\n\r\n" result:&result];
+  XCTAssertEqual(result, OCFWebServerHeaderParserResultInvalid);
+  [self _parserWithString:@"POST / HTTP/1.1\r\nContent-Length: -1\r\n\r\n" result:&result];
+  XCTAssertEqual(result, OCFWebServerHeaderParserResultInvalid);
+  [self _parserWithString:@"POST / HTTP/1.1\r\nContent-Length: 5\r\nContent-Length: 100\r\n\r\n" result:&result];
+  XCTAssertEqual(result, OCFWebServerHeaderParserResultInvalid);
+  [self _parserWithString:@"POST / HTTP/1.1\r\nContent-Length: 5\r\nTransfer-Encoding: chunked\r\n\r\n" result:&result];
+  XCTAssertEqual(result, OCFWebServerHeaderParserResultInvalid);
+
+  OCFWebServerHeaderParser* parser = [self _parserWithString:@"POST / HTTP/1.1\r\nContent-Length: 5\r\nContent-Length: 5\r\n\r\n" result:&result];
+  XCTAssertEqual(result, OCFWebServerHeaderParserResultComplete);
+  XCTAssertEqualObjects(parser.headers[@"Content-Length"], @"5");
+}
+
+- (void)testInvalidRequests {
+  OCFWebServerHeaderParserResult result;
+  [self _parserWithString:@"GET / HTTP/1.1\r\n folded: value\r\n\r\n" result:&result];
+  XCTAssertEqual(result, OCFWebServerHeaderParserResultInvalid);
+  [self _parserWithString:@"GET /\r\n\r\n" result:&result];
+  XCTAssertEqual(result, OCFWebServerHeaderParserResultInvalid);
+  [self _parserWithString:@"G(T / HTTP/1.1\r\n\r\n" result:&result];
+  XCTAssertEqual(result, OCFWebServerHeaderParserResultInvalid);
+  [self _parserWithString:@"GET / HTTP/1.1\r\nBad Name: value\r\n\r\n" result:&result];
+  XCTAssertEqual(result, OCFWebServerHeaderParserResultInvalid);
+}
+
+- (void)testMaximumHeaderSize {
+  OCFWebServerHeaderParser* parser = [[OCFWebServerHeaderParser alloc] initWithMaximumHeaderSize:32];
+  XCTAssertEqual([self _parseString:@"GET / HTTP/1.1\r\nUser-Agent: some long user agent\r\n\r\n" parser:parser], OCFWebServerHeaderParserResultTooLarge);
+}
+
+- (void)testHeaderFieldsOnly {
+  OCFWebServerHeaderParser* parser = [[OCFWebServerHeaderParser alloc] initWithMaximumHeaderSize:16 * 1024];
+  const char* bytes = "content-disposition: form-data; name=\"field\"\r\nContent-Type: text/plain\r\n\r\n";
+  XCTAssertEqual([parser parseHeaderFieldBytes:bytes length:strlen(bytes)], OCFWebServerHeaderParserResultComplete);
+  XCTAssertEqualObjects(parser.headers[@"Content-Disposition"], @"form-data; name=\"field\"");
+  XCTAssertEqualObjects(parser.headers[@"Content-Type"], @"text/plain");
+
+  XCTAssertEqual([parser parseHeaderFieldBytes:"\r\n" length:2], OCFWebServerHeaderParserResultComplete);
+  XCTAssertEqual(parser.headers.count, (NSUInteger)0);
+
+  const char* truncated = "Content-Type: text/plain\r\n";
+  XCTAssertEqual([parser parseHeaderFieldBytes:truncated length:strlen(truncated)], OCFWebServerHeaderParserResultIncomplete);
+  const char* trailing = "Content-Type: text/plain\r\n\r\nextra";
+  XCTAssertEqual([parser parseHeaderFieldBytes:trailing length:strlen(trailing)], OCFWebServerHeaderParserResultInvalid);
+}
+
+@end
@@ -0,0 +1,130 @@
+//
+//  OCFWebServerMultiPartFormRequestTests.m
+//  OCFWebServerTests
+//
+
+#import <XCTest/XCTest.h>
+#import "OCFWebServer.h"
+#import "OCFWebServerRequest.h"
+#import "OCFWebServerResponse.h"
+#import "OCFWebServerTestClient.h"
+
+@interface OCFWebServerMultiPartFormRequestTests : XCTestCase
+@end
+
+@implementation OCFWebServerMultiPartFormRequestTests
+
+- (OCFWebServerMultiPartFormRequest*)_requestWithBody:(NSData*)body boundary:(NSString*)boundary {
+  NSDictionary* headers = @{@"Content-Type": [NSString stringWithFormat:@"multipart/form-data; boundary=%@", boundary],
+                            @"Content-Length": [NSString stringWithFormat:@"%lu", (unsigned long)body.length]};
+  return [[OCFWebServerMultiPartFormRequest alloc] initWithMethod:@"POST" URL:[NSURL URLWithString:@"http://localhost/upload"] headers:headers path:@"/upload" query:nil];
+}
+
+// Writes the body in pieces of the given length and returns whether the request closed successfully
+- (BOOL)_writeBody:(NSData*)body toRequest:(OCFWebServerMultiPartFormRequest*)request pieceLength:(NSUInteger)pieceLength {
+  if (![request open]) {
+    return NO;
+  }
+  BOOL success = YES;
+  for (NSUInteger offset = 0; success && (offset < body.length); offset += pieceLength) {
+    NSUInteger length = MIN(pieceLength, body.length - offset);
+    success = ([request write:((const char*)body.bytes + offset) maxLength:length] == (NSInteger)length);
+  }
+  return ([request close] && success);
+}
+
+- (NSData*)_body {
+  NSString* body = @"This is the preamble\r\n"
+                   @"--XyZ-boundary\r\n"
+                   @"Content-Disposition: form-data; name=\"text\"\r\n"
+                   @"\r\n"
+                   @"Looks like a delimiter: \r\n--XyZ-bound but is not\r\n"
+                   @"--XyZ-boundary\r\n"
+                   @"content-disposition: form-data; name=\"empty\"\r\n"
+                   @"\r\n"
+                   @"\r\n"
+                   @"--XyZ-boundary\r\n"
+                   @"Content-Disposition: form-data; name=\"file\"; filename=\"hello.txt\"\r\n"
+                   @"Content-Type: text/plain\r\n"
+                   @"\r\n"
+                   @"Hello\r\nWorld\r\n"
+                   @"\r\n"
+                   @"--XyZ-boundary--\r\n"
+                   @"This is the epilogue\r\n";
+  return [body dataUsingEncoding:NSUTF8StringEncoding];
+}
+
+- (void)testBoundariesAcrossReads {
+  NSData* body = [self _body];
+  for (NSUInteger pieceLength = 1; pieceLength <= body.length; pieceLength = (pieceLength < 32 ? pieceLength + 1 : pieceLength * 2)) {
+    OCFWebServerMultiPartFormRequest* request = [self _requestWithBody:body boundary:@"XyZ-boundary"];
+    XCTAssertTrue([self _writeBody:body toRequest:request pieceLength:pieceLength], @"Pieces of %lu bytes", (unsigned long)pieceLength);
+
+    OCFWebServerMultiPartArgument* text = request.arguments[@"text"];
+    XCTAssertEqualObjects(text.string, @"Looks like a delimiter: \r\n--XyZ-bound but is not");
+    XCTAssertEqualObjects(text.mimeType, @"text/plain");
+    OCFWebServerMultiPartArgument* empty = request.arguments[@"empty"];
+    XCTAssertEqual(empty.data.length, (NSUInteger)0);
+    XCTAssertEqual(request.arguments.count, (NSUInteger)2);
+
+    OCFWebServerMultiPartFile* file = request.files[@"file"];
+    XCTAssertEqualObjects(file.fileName, @"hello.txt");
+    XCTAssertEqualObjects(file.contentType, @"text/plain");
+    XCTAssertEqualObjects([NSData dataWithContentsOfFile:file.temporaryPath], [@"Hello\r\nWorld\r\n" dataUsingEncoding:NSUTF8StringEncoding]);
+    XCTAssertEqual(request.files.count, (NSUInteger)1);
+    [[NSFileManager defaultManager] removeItemAtPath:file.temporaryPath error:NULL];
+
+    XCTAssertEqualObjects(request.data, body);  // Kept by default
+  }
+}
+
+- (void)testWithoutKeepingData {
+  NSData* body = [self _body];
+  OCFWebServerMultiPartFormRequest* request = [self _requestWithBody:body boundary:@"XyZ-boundary"];
+  request.keepsData = NO;
+  XCTAssertTrue([self _writeBody:body toRequest:request pieceLength:body.length]);
+  XCTAssertNil(request.data);
+  XCTAssertNotNil(request.arguments[@"text"]);
+  [[NSFileManager defaultManager] removeItemAtPath:[request.files[@"file"] temporaryPath] error:NULL];
+}
+
+// Uploads the body and returns the handler's description of the request it received
+- (NSString*)_uploadBody:(NSData*)body keepsMultiPartData:(BOOL)keepsMultiPartData {
+  OCFWebServer* server = [[OCFWebServer alloc] init];
+  server.keepsMultiPartData = keepsMultiPartData;
+  [server addHandlerForMethod:@"POST" path:@"/upload" requestClass:[OCFWebServerMultiPartFormRequest class] processBlock:^(OCFWebServerRequest* request) {
+    OCFWebServerMultiPartFormRequest* formRequest = (OCFWebServerMultiPartFormRequest*)request;
+    NSString* text = [NSString stringWithFormat:@"%@ %lu %@", (formRequest.data ? @"kept" : @"none"), (unsigned long)formRequest.data.length, [formRequest.arguments[@"text"] string]];
+    [request respondWith:[OCFWebServerDataResponse responseWithText:text]];
+  }];
+  XCTAssertTrue([server startWithListenAddresses:@[@"127.0.0.1:0"] bonjourName:nil maxPendingConnections:16]);
+  OCFWebServerTestClient* client = [[OCFWebServerTestClient alloc] initWithPort:server.port];
+  NSString* headers = [NSString stringWithFormat:@"POST /upload HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\nContent-Type: multipart/form-data; boundary=XyZ-boundary\r\nContent-Length: %lu\r\n\r\n", (unsigned long)body.length];
+  OCFWebServerTestResponse* response = nil;
+  if ([client sendString:[headers stringByAppendingString:[[NSString alloc] initWithData:body encoding:NSUTF8StringEncoding]]]) {
+    response = [client readResponse];
+  }
+  [server stop];
+  XCTAssertEqual(response.statusCode, (NSInteger)200);
+  return response.bodyString;
+}
+
+- (void)testServerKeepingData {
+  XCTAssertTrue([[OCFWebServer alloc] init].keepsMultiPartData);  // Default
+  NSData* body = [self _body];
+  NSString* expected = [NSString stringWithFormat:@"kept %lu Looks like a delimiter: \r\n--XyZ-bound but is not", (unsigned long)body.length];
+  XCTAssertEqualObjects([self _uploadBody:body keepsMultiPartData:YES], expected);
+}
+
+- (void)testServerWithoutKeepingData {
+  XCTAssertEqualObjects([self _uploadBody:[self _body] keepsMultiPartData:NO], @"none 0 Looks like a delimiter: \r\n--XyZ-bound but is not");
+}
+
+- (void)testTruncatedBody {
+  NSData* body = [self _body];
+  NSData* truncatedBody = [body subdataWithRange:NSMakeRange(0, body.length - 30)];  // Before the closing delimiter
+  OCFWebServerMultiPartFormRequest* request = [self _requestWithBody:truncatedBody boundary:@"XyZ-boundary"];
+  XCTAssertFalse([self _writeBody:truncatedBody toRequest:request pieceLength:7]);
+}
+
+@end
@@ -0,0 +1,170 @@
+//
+//  OCFWebServerPersistentConnectionTests.m
+//  OCFWebServerTests
+//
+
+#import <XCTest/XCTest.h>
+#import "OCFWebServer.h"
+#import "OCFWebServerRequest.h"
+#import "OCFWebServerResponse.h"
+#import "OCFWebServerTestClient.h"
+
+#define kHelloText @"Hello World"
+
+@interface OCFWebServerPersistentConnectionTests : XCTestCase
+@property(nonatomic, strong) OCFWebServer* server;
+@end
+
+@implementation OCFWebServerPersistentConnectionTests
+
+- (void)setUp {
+  [super setUp];
+  self.server = [[OCFWebServer alloc] init];
+  OCFWebServerProcessBlock helloBlock = ^(OCFWebServerRequest* request) {
+    [request respondWith:[OCFWebServerDataResponse responseWithText:kHelloText]];
+  };
+  [self.server addHandlerForMethod:@"GET" path:@"/hello" requestClass:[OCFWebServerRequest class] processBlock:helloBlock];
+  [self.server addHandlerForMethod:@"HEAD" path:@"/hello" requestClass:[OCFWebServerRequest class] processBlock:helloBlock];
+  [self.server addHandlerForMethod:@"POST" path:@"/echo" requestClass:[OCFWebServerDataRequest class] processBlock:^(OCFWebServerRequest* request) {
+    NSData* data = [(OCFWebServerDataRequest*)request data];
+    [request respondWith:[OCFWebServerDataResponse responseWithData:(data ? data : [NSData data]) contentType:@"text/plain"]];
+  }];
+  [self.server addHandlerForMethod:@"GET" path:@"/status" requestClass:[OCFWebServerRequest class] processBlock:^(OCFWebServerRequest* request) {
+    OCFWebServerResponse* response = [OCFWebServerDataResponse responseWithText:@"This body must never be sent"];
+    response.statusCode = [request.query[@"code"] integerValue];
+    [request respondWith:response];
+  }];
+}
+
+- (void)tearDown {
+  [self.server stop];
+  self.server = nil;
+  [super tearDown];
+}
+
+- (OCFWebServerTestClient*)_startAndConnect {
+  XCTAssertTrue([self.server startWithListenAddresses:@[@"127.0.0.1:0"] bonjourName:nil maxPendingConnections:16]);
+  OCFWebServerTestClient* client = [[OCFWebServerTestClient alloc] initWithPort:self.server.port];
+  XCTAssertNotNil(client);
+  return client;
+}
+
+- (void)_assertHelloResponse:(OCFWebServerTestResponse*)response {
+  XCTAssertEqual(response.statusCode, (NSInteger)200);
+  XCTAssertEqualObjects(response.bodyString, kHelloText);
+}
+
+- (void)testKeepAlive {
+  OCFWebServerTestClient* client = [self _startAndConnect];
+  for (NSUInteger i = 0; i < 3; ++i) {
+    XCTAssertTrue([client sendString:@"GET /hello HTTP/1.1\r\nHost: localhost\r\n\r\n"]);
+    OCFWebServerTestResponse* response = [client readResponse];
+    [self _assertHelloResponse:response];
+    XCTAssertEqualObjects(response.headers[@"Connection"], @"keep-alive");
+  }
+}
+
+- (void)testConnectionClose {
+  OCFWebServerTestClient* client = [self _startAndConnect];
+  XCTAssertTrue([client sendString:@"GET /hello HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n"]);
+  OCFWebServerTestResponse* response = [client readResponse];
+  [self _assertHelloResponse:response];
+  XCTAssertEqualObjects([response.headers[@"Connection"] lowercaseString], @"close");
+  XCTAssertTrue([client readEndOfStream]);
+}
+
+- (void)testHTTP10 {
+  OCFWebServerTestClient* client = [self _startAndConnect];
+  XCTAssertTrue([client sendString:@"GET /hello HTTP/1.0\r\n\r\n"]);  // Not persistent unless asked for
+  [self _assertHelloResponse:[client readResponse]];
+  XCTAssertTrue([client readEndOfStream]);
+
+  client = [[OCFWebServerTestClient alloc] initWithPort:self.server.port];
+  XCTAssertTrue([client sendString:@"GET /hello HTTP/1.0\r\nConnection: keep-alive\r\n\r\n"]);
+  OCFWebServerTestResponse* response = [client readResponse];
+  [self _assertHelloResponse:response];
+  XCTAssertEqualObjects(response.headers[@"Connection"], @"keep-alive");
+  XCTAssertTrue([client sendString:@"GET /hello HTTP/1.0\r\n\r\n"]);
+  [self _assertHelloResponse:[client readResponse]];
+}
+
+- (void)testPipelining {
+  OCFWebServerTestClient* client = [self _startAndConnect];
+  NSString* requests = @"GET /hello HTTP/1.1\r\nHost: localhost\r\n\r\n"
+                       @"POST /echo HTTP/1.1\r\nHost: localhost\r\nContent-Length: 5\r\n\r\nfirst"
+                       @"POST /echo HTTP/1.1\r\nHost: localhost\r\nTransfer-Encoding: chunked\r\n\r\n6\r\nsecond\r\n0\r\n\r\n"
+                       @"GET /hello HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n";
+  XCTAssertTrue([client sendString:requests]);  // Everything past each request is carried over to the next one
+  [self _assertHelloResponse:[client readResponse]];
+  XCTAssertEqualObjects([client readResponse].bodyString, @"first");
+  XCTAssertEqualObjects([client readResponse].bodyString, @"second");
+  [self _assertHelloResponse:[client readResponse]];
+  XCTAssertTrue([client readEndOfStream]);
+}
+
+- (void)testPipeliningAcrossReads {
+  OCFWebServerTestClient* client = [self _startAndConnect];
+  NSString* requests = @"POST /echo HTTP/1.1\r\nHost: localhost\r\nContent-Length: 3\r\n\r\nabc"
+                       @"GET /hello HTTP/1.1\r\nHost: localhost\r\n\r\n"
+                       @"POST /echo HTTP/1.1\r\nHost: localhost\r\nContent-Length: 3\r\nConnection: close\r\n\r\nxyz";
+  XCTAssertTrue([client sendString:requests pieceLength:7]);
+  XCTAssertEqualObjects([client readResponse].bodyString, @"abc");
+  [self _assertHelloResponse:[client readResponse]];
+  XCTAssertEqualObjects([client readResponse].bodyString, @"xyz");
+  XCTAssertTrue([client readEndOfStream]);
+}
+
+- (void)testMaxRequestsPerConnection {
+  self.server.maxRequestsPerConnection = 2;
+  OCFWebServerTestClient* client = [self _startAndConnect];
+  XCTAssertTrue([client sendString:@"GET /hello HTTP/1.1\r\nHost: localhost\r\n\r\n"]);
+  OCFWebServerTestResponse* response = [client readResponse];
+  [self _assertHelloResponse:response];
+  XCTAssertEqualObjects(response.headers[@"Connection"], @"keep-alive");
+  XCTAssertTrue([client sendString:@"GET /hello HTTP/1.1\r\nHost: localhost\r\n\r\n"]);
+  response = [client readResponse];
+  [self _assertHelloResponse:response];
+  XCTAssertEqualObjects([response.headers[@"Connection"] lowercaseString], @"close");
+  XCTAssertTrue([client readEndOfStream]);
+}
+
+- (void)testKeepAliveTimeout {
+  self.server.keepAliveTimeout = 1.0;
+  OCFWebServerTestClient* client = [self _startAndConnect];
+  XCTAssertTrue([client sendString:@"GET /hello HTTP/1.1\r\nHost: localhost\r\n\r\n"]);
+  [self _assertHelloResponse:[client readResponse]];
+  XCTAssertTrue([client readEndOfStream]);  // Closed without a response once idle for too long (well before the client times out)
+}
+
+- (void)testKeepAliveDisabled {
+  self.server.keepAliveTimeout = 0.0;
+  OCFWebServerTestClient* client = [self _startAndConnect];
+  XCTAssertTrue([client sendString:@"GET /hello HTTP/1.1\r\nHost: localhost\r\n\r\n"]);
+  OCFWebServerTestResponse* response = [client readResponse];
+  [self _assertHelloResponse:response];
+  XCTAssertEqualObjects([response.headers[@"Connection"] lowercaseString], @"close");
+  XCTAssertTrue([client readEndOfStream]);
+}
+
+- (void)testHeadResponseFraming {
+  OCFWebServerTestClient* client = [self _startAndConnect];
+  XCTAssertTrue([client sendString:@"HEAD /hello HTTP/1.1\r\nHost: localhost\r\n\r\nGET /hello HTTP/1.1\r\nHost: localhost\r\n\r\n"]);
+  OCFWebServerTestResponse* response = [client readResponseWithoutBody];
+  XCTAssertEqual(response.statusCode, (NSInteger)200);
+  XCTAssertEqualObjects(response.headers[@"Content-Length"], ([NSString stringWithFormat:@"%lu", (unsigned long)kHelloText.length]));  // Of the body a GET returns
+  [self _assertHelloResponse:[client readResponse]];  // Would read the HEAD body if it had been sent
+}
+
+- (void)testBodylessStatusFraming {
+  OCFWebServerTestClient* client = [self _startAndConnect];
+  for (NSString* code in @[@"204", @"304"]) {
+    XCTAssertTrue([client sendString:[NSString stringWithFormat:@"GET /status?code=%@ HTTP/1.1\r\nHost: localhost\r\n\r\nGET /hello HTTP/1.1\r\nHost: localhost\r\n\r\n", code]]);
+    OCFWebServerTestResponse* response = [client readResponse];
+    XCTAssertEqual(response.statusCode, [code integerValue]);
+    XCTAssertNil(response.headers[@"Content-Length"]);
+    XCTAssertNil(response.headers[@"Transfer-Encoding"]);
+    [self _assertHelloResponse:[client readResponse]];
+  }
+}
+
+@end
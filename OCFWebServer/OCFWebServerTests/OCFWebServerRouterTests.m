@@ -0,0 +1,115 @@
+//
+//  OCFWebServerRouterTests.m
+//  OCFWebServerTests
+//
+
+#import <XCTest/XCTest.h>
+#import "OCFWebServerPrivate.h"
+#import "OCFWebServerRouter.h"
+
+@interface OCFWebServerRouterTests : XCTestCase
+@property(nonatomic, strong) OCFWebServer* server;
+@end
+
+@implementation OCFWebServerRouterTests
+
+- (void)setUp {
+  [super setUp];
+  self.server = [[OCFWebServer alloc] init];
+}
+
+- (void)tearDown {
+  self.server = nil;
+  [super tearDown];
+}
+
+- (void)_addPath:(NSString*)path method:(NSString*)method {
+  [self.server addHandlerForMethod:method path:path requestClass:[OCFWebServerRequest class] processBlock:^(OCFWebServerRequest* request) {}];
+}
+
+- (void)_addPathRegex:(NSString*)regex method:(NSString*)method {
+  [self.server addHandlerForMethod:method pathRegex:regex requestClass:[OCFWebServerRequest class] processBlock:^(OCFWebServerRequest* request) {}];
+}
+
+// Returns the handler the request is routed to and checks the router agrees with trying every handler in turn
+- (OCFWebServerHandler*)_routeMethod:(NSString*)method path:(NSString*)path {
+  OCFWebServerRouter* router = [[OCFWebServerRouter alloc] initWithHandlers:self.server.handlers];
+  NSURL* url = [NSURL URLWithString:[@"http://localhost" stringByAppendingString:[path stringByAddingPercentEscapesUsingEncoding:NSUTF8StringEncoding]]];
+  OCFWebServerHandler* handler = nil;
+  OCFWebServerRequest* request = [router requestWithMethod:method URL:url headers:@{} path:path query:nil handler:&handler];
+  XCTAssertEqual((request != nil), (handler != nil));
+
+  OCFWebServerHandler* expectedHandler = nil;
+  for (OCFWebServerHandler* candidate in self.server.handlers) {
+    if (candidate.matchBlock(method, url, @{}, path, nil)) {
+      expectedHandler = candidate;
+      break;
+    }
+  }
+  XCTAssertEqual(handler, expectedHandler, @"%@ %@", method, path);
+  return handler;
+}
+
+- (void)testPaths {
+  [self _addPath:@"/hello" method:@"GET"];
+  [self _addPath:@"/hello" method:@"POST"];
+  [self _addPath:@"/hello/world" method:@"GET"];
+
+  OCFWebServerHandler* handler = [self _routeMethod:@"GET" path:@"/hello"];
+  XCTAssertEqualObjects(handler.method, @"GET");
+  XCTAssertEqualObjects(handler.pattern, @"/hello");
+  XCTAssertEqualObjects([self _routeMethod:@"GET" path:@"/HeLLo"].pattern, @"/hello");  // Paths are case-insensitive
+  XCTAssertEqualObjects([self _routeMethod:@"POST" path:@"/hello"].method, @"POST");
+  XCTAssertEqualObjects([self _routeMethod:@"GET" path:@"/hello/world"].pattern, @"/hello/world");
+  XCTAssertNil([self _routeMethod:@"PUT" path:@"/hello"]);
+  XCTAssertNil([self _routeMethod:@"GET" path:@"/hell"]);
+  XCTAssertNil([self _routeMethod:@"GET" path:@"/hello/"]);
+  XCTAssertNil([self _routeMethod:@"GET" path:@"/hello/world/again"]);
+}
+
+- (void)testBasePaths {
+  [self.server addHandlerForBasePath:@"/static/" localPath:NSTemporaryDirectory() indexFilename:nil cacheAge:0];
+  [self.server addHandlerForBasePath:@"/static/images/" localPath:NSTemporaryDirectory() indexFilename:nil cacheAge:0];
+
+  XCTAssertEqualObjects([self _routeMethod:@"GET" path:@"/static/app.js"].pattern, @"/static/");
+  XCTAssertEqualObjects([self _routeMethod:@"GET" path:@"/static/images/logo.png"].pattern, @"/static/images/");  // Registered last
+  XCTAssertNil([self _routeMethod:@"GET" path:@"/Static/app.js"]);  // Base paths are case-sensitive
+  XCTAssertNil([self _routeMethod:@"GET" path:@"/static"]);
+  XCTAssertNil([self _routeMethod:@"POST" path:@"/static/app.js"]);
+}
+
+- (void)testPathRegexes {
+  [self _addPathRegex:@"^/items/[0-9]+$" method:@"GET"];
+  [self _addPathRegex:@"\\.json$" method:@"GET"];
+  [self _addPathRegex:@"^/(users|groups)/" method:@"GET"];
+
+  XCTAssertEqualObjects([self _routeMethod:@"GET" path:@"/items/42"].pattern, @"^/items/[0-9]+$");
+  XCTAssertEqualObjects([self _routeMethod:@"GET" path:@"/ITEMS/42"].pattern, @"^/items/[0-9]+$");  // Regexes are case-insensitive
+  XCTAssertEqualObjects([self _routeMethod:@"GET" path:@"/data/items.JSON"].pattern, @"\\.json$");
+  XCTAssertEqualObjects([self _routeMethod:@"GET" path:@"/groups/admin"].pattern, @"^/(users|groups)/");
+  XCTAssertNil([self _routeMethod:@"GET" path:@"/items/abc"]);
+  XCTAssertNil([self _routeMethod:@"GET" path:@"/prefix/items/42"]);
+  XCTAssertNil([self _routeMethod:@"DELETE" path:@"/items/42"]);
+}
+
+- (void)testLastRegisteredHandlerWins {
+  [self _addPathRegex:@"^/files/" method:@"GET"];
+  [self _addPath:@"/files/readme" method:@"GET"];
+  XCTAssertEqual([self _routeMethod:@"GET" path:@"/files/readme"], self.server.handlers[0]);
+  XCTAssertEqual([self _routeMethod:@"GET" path:@"/files/other"], self.server.handlers[1]);
+
+  [self.server addHandlerWithMatchBlock:^OCFWebServerRequest *(NSString* requestMethod, NSURL* requestURL, NSDictionary* requestHeaders, NSString* urlPath, NSDictionary* urlQuery) {
+    return [[OCFWebServerRequest alloc] initWithMethod:requestMethod URL:requestURL headers:requestHeaders path:urlPath query:urlQuery];
+  } processBlock:^(OCFWebServerRequest* request) {}];
+  XCTAssertEqual([self _routeMethod:@"GET" path:@"/files/readme"], self.server.handlers[0]);  // Custom handlers match anything
+  XCTAssertEqual([self _routeMethod:@"PATCH" path:@"/anything"], self.server.handlers[0]);
+}
+
+- (void)testNonASCIIPaths {
+  [self _addPath:@"/café" method:@"GET"];
+  XCTAssertNotNil([self _routeMethod:@"GET" path:@"/café"]);
+  XCTAssertNotNil([self _routeMethod:@"GET" path:@"/CAFÉ"]);
+  XCTAssertNil([self _routeMethod:@"GET" path:@"/cafe"]);
+}
+
+@end
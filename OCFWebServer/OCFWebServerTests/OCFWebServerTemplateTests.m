@@ -0,0 +1,82 @@
+//
+//  OCFWebServerTemplateTests.m
+//  OCFWebServerTests
+//
+
+#import <XCTest/XCTest.h>
+#import "OCFWebServerTemplate.h"
+
+@interface OCFWebServerTemplateTests : XCTestCase
+@end
+
+@implementation OCFWebServerTemplateTests
+
+- (OCFWebServerTemplate*)_templateWithString:(NSString*)string {
+  return [[OCFWebServerTemplate alloc] initWithData:[string dataUsingEncoding:NSUTF8StringEncoding]];
+}
+
+- (NSString*)_renderString:(NSString*)string variables:(NSDictionary*)variables {
+  NSData* data = [[self _templateWithString:string] dataWithVariables:variables];
+  return [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding];
+}
+
+- (NSData*)_streamTemplate:(OCFWebServerTemplate*)template variables:(NSDictionary*)variables {
+  OCFWebServerStreamBlock block = [template streamBlockWithVariables:variables];
+  NSMutableData* result = [NSMutableData data];
+  NSData* data;
+  while ((data = block(NULL)).length) {
+    [result appendData:data];
+  }
+  return result;
+}
+
+- (void)testPlaceholders {
+  XCTAssertEqualObjects([self _renderString:@"Hello %name%!" variables:@{@"name": @"World"}], @"Hello World!");
+  XCTAssertEqualObjects([self _renderString:@"%a%%b%" variables:(@{@"a": @"1", @"b": @"2"})], @"12");
+  XCTAssertEqualObjects([self _renderString:@"%a%b%" variables:(@{@"a": @"1", @"b": @"2"})], @"1b%");
+  XCTAssertEqualObjects([self _renderString:@"%x% and %x%" variables:@{@"x": @"é"}], @"é and é");
+  XCTAssertEqualObjects([self _renderString:@"[%empty%]" variables:@{@"empty": @""}], @"[]");
+}
+
+// Names are limited to [A-Za-z0-9_.-] which is a documented break from the string substitution templates used before
+- (void)testPlaceholderCharacters {
+  XCTAssertEqualObjects([self _renderString:@"%a.b-c_1%" variables:@{@"a.b-c_1": @"ok"}], @"ok");
+  XCTAssertEqualObjects([self _renderString:@"%ABCxyz0189%" variables:@{@"ABCxyz0189": @"ok"}], @"ok");
+  XCTAssertEqualObjects([self _renderString:@"%not valid%" variables:@{@"not valid": @"no"}], @"%not valid%");
+  XCTAssertEqualObjects([self _renderString:@"%a/b%" variables:@{@"a/b": @"no"}], @"%a/b%");
+  XCTAssertEqualObjects([self _renderString:@"%café%" variables:@{@"café": @"no"}], @"%café%");
+  XCTAssertEqualObjects([self _renderString:@"50% off" variables:@{}], @"50% off");
+  XCTAssertEqualObjects([self _renderString:@"%%" variables:@{}], @"%%");
+  XCTAssertEqualObjects([self _renderString:@"100%" variables:@{}], @"100%");
+  XCTAssertEqualObjects([self _renderString:@"%%x%" variables:@{@"x": @"1"}], @"%1");  // The next "%" may start a placeholder
+  XCTAssertEqualObjects([self _renderString:@"width: 50% %x%" variables:@{@"x": @"1"}], @"width: 50% 1");
+}
+
+- (void)testValues {
+  XCTAssertEqualObjects([self _renderString:@"%missing% %x%" variables:@{@"x": @"1"}], @"%missing% 1");  // Kept as is
+  XCTAssertEqualObjects([self _renderString:@"%count%" variables:@{@"count": @42}], @"42");
+  XCTAssertEqualObjects([self _renderString:@"%x%" variables:nil], @"%x%");
+}
+
+- (void)testVariableNames {
+  OCFWebServerTemplate* template = [self _templateWithString:@"%b% %a% %b% %not valid% %c.d%"];
+  XCTAssertEqualObjects(template.variableNames, (@[@"b", @"a", @"c.d"]));
+  XCTAssertEqualObjects([self _templateWithString:@"no placeholders"].variableNames, @[]);
+  XCTAssertEqualObjects([self _templateWithString:@""].variableNames, @[]);
+}
+
+- (void)testStreaming {
+  NSMutableString* string = [NSMutableString string];
+  for (NSUInteger i = 0; i < 10000; ++i) {
+    [string appendFormat:@"<li>%%item%% %lu %%missing%%</li>\n", (unsigned long)i];
+  }
+  OCFWebServerTemplate* template = [self _templateWithString:string];
+  NSDictionary* variables = @{@"item": [@"" stringByPaddingToLength:10 withString:@"x" startingAtIndex:0]};
+  NSData* data = [template dataWithVariables:variables];
+  XCTAssertTrue(data.length > 2 * 32 * 1024);
+  XCTAssertEqualObjects([self _streamTemplate:template variables:variables], data);
+
+  XCTAssertEqualObjects([self _streamTemplate:[self _templateWithString:@""] variables:@{}], [NSData data]);
+}
+
+@end
@@ -0,0 +1,32 @@
+//
+//  OCFWebServerTestClient.h
+//  OCFWebServerTests
+//
+
+#import <Foundation/Foundation.h>
+
+@interface OCFWebServerTestResponse : NSObject
+
+#pragma mark - Properties
+@property (nonatomic, assign, readonly) NSInteger statusCode;
+@property (nonatomic, copy, readonly) NSDictionary *headers;  // Names as sent by the server
+@property (nonatomic, copy, readonly) NSData *body;  // Decoded from chunked framing if needed
+@property (nonatomic, copy, readonly) NSString *bodyString;  // UTF-8
+
+@end
+
+// Blocking HTTP/1.1 client over a single loopback connection, reads time out after 5 seconds
+@interface OCFWebServerTestClient : NSObject
+
+#pragma mark - Creating
+- (instancetype)initWithPort:(NSUInteger)port;  // Returns nil if the connection fails
+
+#pragma mark - Exchanging
+- (BOOL)sendString:(NSString*)string;
+- (BOOL)sendString:(NSString*)string pieceLength:(NSUInteger)pieceLength;  // Pieces are written separately with TCP_NODELAY (0 for all at once)
+- (OCFWebServerTestResponse*)readResponse;  // Returns nil if the connection closed or timed out first
+- (OCFWebServerTestResponse*)readResponseWithoutBody;  // For responses to HEAD requests
+- (BOOL)readEndOfStream;  // Returns YES if the server closed the connection without sending anything more
+- (void)close;
+
+@end
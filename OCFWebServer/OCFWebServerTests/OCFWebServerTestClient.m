@@ -0,0 +1,213 @@
+//
+//  OCFWebServerTestClient.m
+//  OCFWebServerTests
+//
+
+#import <sys/socket.h>
+#import <netinet/in.h>
+#import <netinet/tcp.h>
+#import <arpa/inet.h>
+#import <unistd.h>
+#import "OCFWebServerTestClient.h"
+
+@interface OCFWebServerTestResponse ()
+@property (nonatomic, assign, readwrite) NSInteger statusCode;
+@property (nonatomic, copy, readwrite) NSDictionary *headers;
+@property (nonatomic, copy, readwrite) NSData *body;
+@end
+
+@implementation OCFWebServerTestResponse
+
+- (NSString*)bodyString {
+  return [[NSString alloc] initWithData:self.body encoding:NSUTF8StringEncoding];
+}
+
+@end
+
+@interface OCFWebServerTestClient ()
+@property (nonatomic, assign) int socket;
+@property (nonatomic, strong) NSMutableData *buffer;  // Received but not consumed yet
+@property (nonatomic, assign) BOOL endOfStream;
+@property (nonatomic, assign) BOOL closedByPeer;  // As opposed to another read error or a timeout
+@end
+
+@implementation OCFWebServerTestClient
+
+#pragma mark - Creating
+- (instancetype)initWithPort:(NSUInteger)port {
+  if((self = [super init])) {
+    self.buffer = [NSMutableData data];
+    self.socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (self.socket < 0) {
+      return nil;
+    }
+    struct timeval timeout = {5, 0};
+    setsockopt(self.socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    int noDelay = 1;
+    setsockopt(self.socket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+    struct sockaddr_in address;
+    bzero(&address, sizeof(address));
+#if defined(__APPLE__)
+    address.sin_len = sizeof(address);
+#endif
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(self.socket, (struct sockaddr*)&address, sizeof(address)) != 0) {
+      [self close];
+      return nil;
+    }
+  }
+  return self;
+}
+
+- (void)dealloc {
+  [self close];
+}
+
+#pragma mark - Exchanging
+- (BOOL)sendString:(NSString*)string {
+  return [self sendString:string pieceLength:0];
+}
+
+- (BOOL)sendString:(NSString*)string pieceLength:(NSUInteger)pieceLength {
+  NSData* data = [string dataUsingEncoding:NSUTF8StringEncoding];
+  for (NSUInteger offset = 0; offset < data.length;) {
+    NSUInteger length = (pieceLength ? MIN(pieceLength, data.length - offset) : data.length - offset);
+    ssize_t result = write(self.socket, (const char*)data.bytes + offset, length);
+    if (result <= 0) {
+      return NO;
+    }
+    offset += result;
+  }
+  return YES;
+}
+
+// Returns NO once the connection closed or timed out
+- (BOOL)_receive {
+  if (self.endOfStream || (self.socket < 0)) {
+    return NO;
+  }
+  char buffer[4096];
+  ssize_t result = read(self.socket, buffer, sizeof(buffer));
+  if (result <= 0) {
+    self.endOfStream = YES;
+    self.closedByPeer = ((result == 0) || (errno == ECONNRESET));
+    return NO;
+  }
+  [self.buffer appendBytes:buffer length:result];
+  return YES;
+}
+
+// Returns the bytes before the next CRLF (consuming it) or nil
+- (NSData*)_readLine {
+  while (1) {
+    NSRange range = [self.buffer rangeOfData:[NSData dataWithBytes:"\r\n" length:2] options:0 range:NSMakeRange(0, self.buffer.length)];
+    if (range.location != NSNotFound) {
+      NSData* line = [self.buffer subdataWithRange:NSMakeRange(0, range.location)];
+      [self.buffer replaceBytesInRange:NSMakeRange(0, NSMaxRange(range)) withBytes:NULL length:0];
+      return line;
+    }
+    if (![self _receive]) {
+      return nil;
+    }
+  }
+}
+
+- (NSData*)_readLength:(NSUInteger)length {
+  while (self.buffer.length < length) {
+    if (![self _receive]) {
+      return nil;
+    }
+  }
+  NSData* data = [self.buffer subdataWithRange:NSMakeRange(0, length)];
+  [self.buffer replaceBytesInRange:NSMakeRange(0, length) withBytes:NULL length:0];
+  return data;
+}
+
+- (OCFWebServerTestResponse*)_readResponseWithBody:(BOOL)withBody {
+  NSData* line = [self _readLine];
+  NSString* statusLine = (line ? [[NSString alloc] initWithData:line encoding:NSASCIIStringEncoding] : nil);
+  NSArray* components = [statusLine componentsSeparatedByString:@" "];
+  if ((components.count < 2) || ![components[0] hasPrefix:@"HTTP/1."]) {
+    return nil;
+  }
+  OCFWebServerTestResponse* response = [[OCFWebServerTestResponse alloc] init];
+  response.statusCode = [components[1] integerValue];
+  NSMutableDictionary* headers = [NSMutableDictionary dictionary];
+  while ((line = [self _readLine]) && line.length) {
+    NSString* header = [[NSString alloc] initWithData:line encoding:NSUTF8StringEncoding];
+    NSRange range = [header rangeOfString:@":"];
+    if (range.location == NSNotFound) {
+      return nil;
+    }
+    NSString* value = [[header substringFromIndex:NSMaxRange(range)] stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]];
+    headers[[header substringToIndex:range.location]] = value;
+  }
+  if (line == nil) {
+    return nil;
+  }
+  response.headers = headers;
+
+  NSInteger status = response.statusCode;
+  if (!withBody || ((status >= 100) && (status < 200)) || (status == 204) || (status == 304)) {
+    response.body = [NSData data];
+  } else if ([headers[@"Transfer-Encoding"] isEqualToString:@"chunked"]) {
+    NSMutableData* body = [NSMutableData data];
+    while (1) {
+      NSData* sizeLine = [self _readLine];
+      if (sizeLine == nil) {
+        return nil;
+      }
+      NSString* size = [[NSString alloc] initWithData:sizeLine encoding:NSASCIIStringEncoding];
+      NSUInteger length = strtoul([size UTF8String], NULL, 16);
+      if (length == 0) {
+        while ((line = [self _readLine]) && line.length) {}  // Trailer
+        if (line == nil) {
+          return nil;
+        }
+        break;
+      }
+      NSData* data = [self _readLength:length];
+      if ((data == nil) || ([self _readLine].length != 0)) {
+        return nil;
+      }
+      [body appendData:data];
+    }
+    response.body = body;
+  } else if (headers[@"Content-Length"]) {
+    response.body = [self _readLength:[headers[@"Content-Length"] integerValue]];
+    if (response.body == nil) {
+      return nil;
+    }
+  } else {
+    while ([self _receive]) {}
+    response.body = self.buffer;
+    self.buffer = [NSMutableData data];
+  }
+  return response;
+}
+
+- (OCFWebServerTestResponse*)readResponse {
+  return [self _readResponseWithBody:YES];
+}
+
+- (OCFWebServerTestResponse*)readResponseWithoutBody {
+  return [self _readResponseWithBody:NO];
+}
+
+- (BOOL)readEndOfStream {
+  if (self.buffer.length) {
+    return NO;
+  }
+  return (![self _receive] && self.closedByPeer);
+}
+
+- (void)close {
+  if (self.socket >= 0) {
+    close(self.socket);
+    self.socket = -1;
+  }
+}
+
+@end